@@ -0,0 +1,451 @@
+// Latency benchmarks for the LSTM kernels and the end-to-end detector.
+//
+// Sweeps hidden size, layer count and lookback over a bundled data file and
+// writes one JSON record per (stage, shape) with latency percentiles in
+// microseconds. Built and run by `make bench`; see --help for the options.
+
+#include "adapad.hpp"
+#include "checkpoint.hpp"
+#include "config.hpp"
+#include "csv_reader.hpp"
+#include "lstm_predictor.hpp"
+#include "normal_data_predictor.hpp"
+#include "simd_kernels.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+typedef std::vector<std::vector<std::vector<float>>> Tensor;
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+    std::string config_path = "config.yaml";
+    std::string data_path = "data/Tide_pressure.validation_stage.csv";
+    std::string out_path = "bench_results.json";
+    std::string work_dir = "build/bench/work";
+    std::vector<int> hidden_sizes = {32, 64, 100};
+    std::vector<int> layer_counts = {1, 2};
+    std::vector<int> lookbacks = {3, 6};
+    int iterations = 300;     // samples per kernel stage
+    int steps = 100;          // samples for update and is_anomalous
+    int checkpoints = 30;     // samples for checkpoint save/load
+    int warmup = 5;           // untimed calls before each stage
+};
+
+// Microsecond samples of one stage at one shape
+struct Result {
+    std::string stage;
+    int hidden_size;
+    int layers;
+    int lookback;
+    std::vector<double> samples;
+};
+
+static std::vector<int> parse_list(const std::string& text) {
+    std::vector<int> values;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        int v = std::atoi(item.c_str());
+        if (v <= 0) {
+            throw std::invalid_argument("expected a comma separated list of positive integers: " + text);
+        }
+        values.push_back(v);
+    }
+    return values;
+}
+
+static void usage() {
+    std::cerr <<
+        "usage: adapad_bench [options]\n"
+        "  --config PATH      config file (default config.yaml)\n"
+        "  --data PATH        CSV file, first sensor column is used\n"
+        "                     (default data/Tide_pressure.validation_stage.csv)\n"
+        "  --out PATH         JSON output (default bench_results.json, - for stdout)\n"
+        "  --hidden LIST      hidden sizes to sweep (default 32,64,100)\n"
+        "  --layers LIST      layer counts to sweep (default 1,2)\n"
+        "  --lookback LIST    lookback lengths to sweep (default 3,6)\n"
+        "  --iterations N     samples per kernel stage (default 300)\n"
+        "  --steps N          samples for update and is_anomalous (default 100)\n"
+        "  --checkpoints N    samples for checkpoint save/load (default 30)\n"
+        "  --quick            small sweep for a smoke run\n";
+}
+
+static Options parse_options(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument(arg + " needs a value");
+            }
+            return argv[++i];
+        };
+        if (arg == "--config") opt.config_path = value();
+        else if (arg == "--data") opt.data_path = value();
+        else if (arg == "--out") opt.out_path = value();
+        else if (arg == "--hidden") opt.hidden_sizes = parse_list(value());
+        else if (arg == "--layers") opt.layer_counts = parse_list(value());
+        else if (arg == "--lookback") opt.lookbacks = parse_list(value());
+        else if (arg == "--iterations") opt.iterations = parse_list(value())[0];
+        else if (arg == "--steps") opt.steps = parse_list(value())[0];
+        else if (arg == "--checkpoints") opt.checkpoints = parse_list(value())[0];
+        else if (arg == "--quick") {
+            opt.hidden_sizes = {32};
+            opt.layer_counts = {1};
+            opt.lookbacks = {3};
+            opt.iterations = 50;
+            opt.steps = 10;
+            opt.checkpoints = 5;
+        } else if (arg == "--help" || arg == "-h") {
+            usage();
+            std::exit(0);
+        } else {
+            throw std::invalid_argument("unknown option " + arg);
+        }
+    }
+    return opt;
+}
+
+static std::vector<float> load_series(const std::string& path, std::string& column) {
+    CSVStreamReader reader(path);
+    if (reader.columns().empty()) {
+        throw std::runtime_error(path + " has no sensor columns");
+    }
+    column = reader.columns()[0];
+    std::vector<float> series;
+    std::vector<float> row;
+    while (reader.next_row(row)) {
+        if (row[0] != CSVStreamReader::MISSING_VALUE) {
+            series.push_back(row[0]);
+        }
+    }
+    return series;
+}
+
+// Nearest-rank percentile of sorted samples
+static double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.5);
+    rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+    return sorted[rank - 1];
+}
+
+static double elapsed_us(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+// Config loading and the detector print progress on stdout; keeps it off the
+// JSON and the terminal while alive
+class QuietStdout {
+public:
+    QuietStdout() : null_out("/dev/null"), saved(std::cout.rdbuf(null_out.rdbuf())) {}
+    ~QuietStdout() { std::cout.rdbuf(saved); }
+
+private:
+    std::ofstream null_out;
+    std::streambuf* saved;
+};
+
+class Bench {
+public:
+    Bench(const Options& opt, const std::vector<float>& series, const std::string& column)
+        : opt(opt), series(series), column(column) {
+        lower = *std::min_element(series.begin(), series.end());
+        upper = *std::max_element(series.begin(), series.end());
+        if (upper <= lower) {
+            upper = lower + 1.0f;
+        }
+    }
+
+    void run_shape(int hidden, int layers, int lookback) {
+        Config& config = Config::getInstance();
+        config.LSTM_size = hidden;
+        config.LSTM_size_layer = layers;
+        config.lookback_len = lookback;
+        config.input_size = lookback;
+        config.train_size = 2 * lookback + config.prediction_len;
+
+        shape_hidden = hidden;
+        shape_layers = layers;
+        shape_lookback = lookback;
+        std::cerr << "hidden " << hidden << " layers " << layers << " lookback " << lookback << std::endl;
+
+        bench_kernels();
+        bench_update();
+        bench_checkpoint();
+        bench_detector();
+    }
+
+    const std::vector<Result>& results() const { return all; }
+
+private:
+    const Options& opt;
+    const std::vector<float>& series;
+    std::string column;
+    float lower, upper;
+    int shape_hidden = 0, shape_layers = 0, shape_lookback = 0;
+    std::vector<Result> all;
+
+    Result& add(const std::string& stage) {
+        all.push_back(Result{stage, shape_hidden, shape_layers, shape_lookback, std::vector<double>()});
+        return all.back();
+    }
+
+    float normalized(size_t i) const {
+        return (series[i % series.size()] - lower) / (upper - lower);
+    }
+
+    // (1, 1, lookback) window starting at i, and the value after it
+    void window(size_t i, Tensor& x, std::vector<float>& target) const {
+        x.assign(1, std::vector<std::vector<float>>(1, std::vector<float>(shape_lookback)));
+        for (int k = 0; k < shape_lookback; ++k) {
+            x[0][0][k] = normalized(i + k);
+        }
+        target.assign(1, normalized(i + shape_lookback));
+    }
+
+    std::unique_ptr<LSTMPredictor> make_lstm() const {
+        const Config& config = Config::getInstance();
+        std::unique_ptr<LSTMPredictor> lstm(new LSTMPredictor(
+            1, shape_lookback, shape_hidden, shape_layers, shape_lookback));
+        lstm->set_activation(config.activation);
+        lstm->set_inference_precision(config.inference_precision);
+        lstm->set_optimizer(config.optimizer);
+        return lstm;
+    }
+
+    void bench_kernels() {
+        const Config& config = Config::getInstance();
+        auto lstm = make_lstm();
+        lstm->train();
+        Tensor x;
+        std::vector<float> target;
+
+        Result& forward = add("forward");
+        for (int i = -opt.warmup; i < opt.iterations; ++i) {
+            window(i + opt.warmup, x, target);
+            Clock::time_point start = Clock::now();
+            auto out = lstm->forward(x);
+            if (i >= 0) forward.samples.push_back(elapsed_us(start));
+        }
+
+        // Backward and weight update given the forward output
+        Result& backward = add("backward");
+        for (int i = -opt.warmup; i < opt.iterations; ++i) {
+            window(i + opt.warmup, x, target);
+            auto out = lstm->forward(x);
+            Clock::time_point start = Clock::now();
+            lstm->train_step(x, target, out, config.lr_update);
+            if (i >= 0) backward.samples.push_back(elapsed_us(start));
+        }
+
+        Result& step = add("train_step");
+        for (int i = -opt.warmup; i < opt.iterations; ++i) {
+            window(i + opt.warmup, x, target);
+            Clock::time_point start = Clock::now();
+            lstm->train_step(x, target, config.lr_update);
+            if (i >= 0) step.samples.push_back(elapsed_us(start));
+        }
+
+        // Single-sample inference as the detector runs it
+        lstm->eval();
+        Result& infer = add("infer");
+        for (int i = -opt.warmup; i < opt.iterations; ++i) {
+            window(i + opt.warmup, x, target);
+            Clock::time_point start = Clock::now();
+            lstm->infer(x[0][0].data(), 1);
+            if (i >= 0) infer.samples.push_back(elapsed_us(start));
+        }
+    }
+
+    void bench_update() {
+        const Config& config = Config::getInstance();
+        NormalDataPredictor predictor(shape_layers, shape_hidden, shape_lookback, config.prediction_len);
+        predictor.set_activation(config.activation);
+        predictor.set_optimizer(config.optimizer);
+        Tensor x;
+        std::vector<float> target;
+
+        Result& update = add("predictor_update");
+        for (int i = -opt.warmup; i < opt.steps; ++i) {
+            window(i + opt.warmup, x, target);
+            Clock::time_point start = Clock::now();
+            predictor.update(config.epoch_update, config.lr_update, x, target);
+            if (i >= 0) update.samples.push_back(elapsed_us(start));
+        }
+    }
+
+    void bench_checkpoint() {
+        auto lstm = make_lstm();
+        const std::string path = opt.work_dir + "/bench_checkpoint.bin";
+
+        Result& save = add("checkpoint_save");
+        for (int i = -opt.warmup; i < opt.checkpoints; ++i) {
+            Clock::time_point start = Clock::now();
+            CheckpointWriter writer;
+            lstm->save_checkpoint(writer, "m.");
+            writer.write(path);
+            if (i >= 0) save.samples.push_back(elapsed_us(start));
+        }
+
+        Result& load = add("checkpoint_load");
+        for (int i = -opt.warmup; i < opt.checkpoints; ++i) {
+            Clock::time_point start = Clock::now();
+            CheckpointReader reader(path);
+            lstm->load_checkpoint(reader, "m.");
+            if (i >= 0) load.samples.push_back(elapsed_us(start));
+        }
+        std::remove(path.c_str());
+    }
+
+    void bench_detector() {
+        const Config& config = Config::getInstance();
+        PredictorConfig predictor_config = init_predictor_config();
+        ValueRangeConfig range;
+        range.lower_bound = lower;
+        range.upper_bound = upper;
+
+        // Minimal threshold of the column if the config has it, else Tide_pressure's
+        float minimal_threshold = 0.0038f;
+        const std::string key = "data.parameters.Tide_pressure." + column;
+        if (config.get_config_map().count(key + ".minimal_threshold")) {
+            init_value_range_config(key, minimal_threshold);
+        }
+
+        AdapAD detector(predictor_config, range, minimal_threshold, column);
+        std::vector<float> training(series.begin(), series.begin() + predictor_config.train_size);
+        detector.set_training_data(training);
+        detector.train();
+
+        Result& detect = add("is_anomalous");
+        size_t pos = predictor_config.train_size;
+        for (int i = -opt.warmup; i < opt.steps; ++i, ++pos) {
+            float value = series[pos % series.size()];
+            Clock::time_point start = Clock::now();
+            detector.is_anomalous(value);
+            if (i >= 0) detect.samples.push_back(elapsed_us(start));
+        }
+    }
+};
+
+// Quoted JSON string; escapes quotes, backslashes and control characters
+static std::string json_string(const std::string& text) {
+    std::string quoted = "\"";
+    for (char ch : text) {
+        if (ch == '"' || ch == '\\') {
+            quoted += '\\';
+            quoted += ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(ch));
+            quoted += escaped;
+        } else {
+            quoted += ch;
+        }
+    }
+    return quoted + "\"";
+}
+
+static void write_json(std::ostream& out, const Options& opt, const std::string& column,
+                       size_t rows, const std::vector<Result>& results) {
+    const Config& config = Config::getInstance();
+    char timestamp[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    out << "{\n";
+    out << "  \"timestamp\": \"" << timestamp << "\",\n";
+    out << "  \"simd_backend\": \"" << simd_backend_name() << "\",\n";
+    out << "  \"activation\": \"" << activation_name(config.activation) << "\",\n";
+    out << "  \"inference_precision\": \"" << inference_precision_name(config.inference_precision) << "\",\n";
+    out << "  \"optimizer\": \"" << optimizer_name(config.optimizer.kind) << "\",\n";
+    out << "  \"epoch_update\": " << config.epoch_update << ",\n";
+    out << "  \"data\": " << json_string(opt.data_path) << ",\n";
+    out << "  \"column\": " << json_string(column) << ",\n";
+    out << "  \"rows\": " << rows << ",\n";
+    out << "  \"unit\": \"us\",\n";
+    out << "  \"results\": [\n";
+    char line[512];
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::vector<double> sorted = r.samples;
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (double s : sorted) sum += s;
+        std::snprintf(line, sizeof(line),
+            "    {\"stage\": \"%s\", \"hidden_size\": %d, \"layers\": %d, \"lookback\": %d, "
+            "\"samples\": %zu, \"mean\": %.3f, \"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, "
+            "\"p99\": %.3f, \"max\": %.3f}%s\n",
+            r.stage.c_str(), r.hidden_size, r.layers, r.lookback, sorted.size(),
+            sum / sorted.size(), sorted.front(), percentile(sorted, 50), percentile(sorted, 90),
+            percentile(sorted, 99), sorted.back(), i + 1 < results.size() ? "," : "");
+        out << line;
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+int main(int argc, char** argv) {
+    try {
+        Options opt = parse_options(argc, argv);
+
+        std::unique_ptr<QuietStdout> quiet(new QuietStdout());
+
+        Config& config = Config::getInstance();
+        if (!std::ifstream(opt.config_path) || !config.load(opt.config_path)) {
+            std::cerr << "Failed to load " << opt.config_path << std::endl;
+            return 1;
+        }
+        // Keep the detector's logs and saves out of the configured directories
+        config.log_file_path = opt.work_dir;
+        config.save_path = opt.work_dir;
+        config.save_enabled = false;
+        mkdir(opt.work_dir.c_str(), 0777);
+
+        std::string column;
+        std::vector<float> series = load_series(opt.data_path, column);
+        const int max_lookback = *std::max_element(opt.lookbacks.begin(), opt.lookbacks.end());
+        if (series.size() < static_cast<size_t>(2 * max_lookback + config.prediction_len + 1)) {
+            std::cerr << opt.data_path << " has too few rows for lookback " << max_lookback << std::endl;
+            return 1;
+        }
+
+        std::vector<Result> results;
+        {
+            Bench bench(opt, series, column);
+            for (int hidden : opt.hidden_sizes)
+                for (int layers : opt.layer_counts)
+                    for (int lookback : opt.lookbacks)
+                        bench.run_shape(hidden, layers, lookback);
+            results = bench.results();
+        }
+        quiet.reset();
+
+        if (opt.out_path == "-") {
+            write_json(std::cout, opt, column, series.size(), results);
+        } else {
+            std::ofstream out(opt.out_path);
+            if (!out) {
+                std::cerr << "Cannot write " << opt.out_path << std::endl;
+                return 1;
+            }
+            write_json(out, opt, column, series.size(), results);
+            std::cerr << "Wrote " << results.size() << " results to " << opt.out_path << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,32 @@
+#ifndef ACTIVATIONS_HPP
+#define ACTIVATIONS_HPP
+
+#include <cstddef>
+#include <string>
+
+// Gate activations for the LSTM, applied to whole arrays so the fast path can
+// use the SIMD backend selected in simd_kernels.hpp.
+//
+// Exact: 1 / (1 + std::exp(-x)) and std::tanh, element by element.
+// Fast:  exp by range reduction (x = n*ln2 + r, |r| <= ln2/2) and a degree-6
+//        polynomial for e^r, scaled by 2^n through the exponent bits; tanh uses
+//        an odd polynomial for |x| < 0.625 and 1 - 2/(e^2|x| + 1) above.
+//        Inputs are clamped so the exp never overflows, ±inf behaves like a
+//        large finite value. NaN inputs give unspecified results.
+enum class Activation { Exact, Fast };
+
+// Max absolute error of the fast path over all finite floats, checked by
+// tests/test_activations.cpp. Measured < 1e-7 on SSE/AVX2/scalar; the margin
+// covers the reciprocal refinement used on armv7 NEON.
+const float FAST_SIGMOID_MAX_ABS_ERROR = 2e-7f;
+const float FAST_TANH_MAX_ABS_ERROR = 2e-7f;
+
+// "exact" or "fast"; throws std::runtime_error for anything else
+Activation parse_activation(const std::string& name);
+const char* activation_name(Activation kind);
+
+// out[i] = f(in[i]) for i < n; in and out may be the same array
+void apply_sigmoid(const float* in, float* out, std::size_t n, Activation kind);
+void apply_tanh(const float* in, float* out, std::size_t n, Activation kind);
+
+#endif // ACTIVATIONS_HPP
@@ -4,6 +4,9 @@
 #include "normal_data_predictor.hpp"
 #include "anomalous_threshold_generator.hpp"
 #include "config.hpp"
+#include "result_logger.hpp"
+#include "ring_buffer.hpp"
+#include "stage_stats.hpp"
 
 #include <vector>
 #include <memory>
@@ -28,22 +31,50 @@ public:
     }
     std::unique_ptr<NormalDataPredictor> data_predictor;
     std::unique_ptr<AnomalousThresholdGenerator> generator;
-    std::vector<std::vector<std::vector<float>>> prepare_data_for_prediction(size_t supposed_anomalous_pos);
+    // Fills and returns the reusable (1, 1, lookback_len) input window
+    const std::vector<std::vector<std::vector<float>>>& prepare_data_for_prediction(size_t supposed_anomalous_pos);
     
     AdapAD(const PredictorConfig& predictor_config, 
            const ValueRangeConfig& value_range_config,
            float minimal_threshold,
            const std::string& parameter_name);
+    ~AdapAD();
     
     void set_training_data(const std::vector<float>& data);
     void train();
+    // train() for a group of models of homogeneous sensors, all with their
+    // training data set, sharing one predictor and one generator backbone
+    // (LSTMPredictor::share_backbone) trained on the pooled series
+    static void train_shared(const std::vector<AdapAD*>& group);
+    // Ties models restored from checkpoints of one train_shared group back to
+    // their owner's backbones. Checkpoints name the group's owner, and models
+    // whose owner is missing or no longer holds the same LSTM weights keep
+    // their own copy.
+    static void retie_shared(const std::vector<AdapAD*>& models);
     bool is_anomalous(float observed_val);
+
+    // is_anomalous() in three steps, so the forward passes of many models can
+    // run together in between (TimestepEngine). begin_sample returns the
+    // predictor input window; end_prediction takes the prediction and returns
+    // the generator input window, or nullptr when this sample gets no
+    // threshold; finish_sample takes the threshold (ignored then) and does the
+    // decision, updates and logging. The _ns arguments are the time the
+    // caller spent on the forward pass, charged to the stage stats.
+    const std::vector<std::vector<std::vector<float>>>& begin_sample(float observed_val);
+    const std::vector<float>* end_prediction(float predicted_val, uint64_t predict_ns);
+    bool finish_sample(float threshold, uint64_t generate_ns);
     void clean();
 
     std::string get_log_filename() const { return f_name; }
+    float get_minimal_threshold() const { return minimal_threshold; }
+
+    // Per-stage timings of is_anomalous since construction
+    const StageStats& get_stage_stats() const { return stage_stats; }
 
     // Add model state methods
     void save_models();
+    // Blocks until every save_models() so far is written (saves run in the background)
+    static void wait_for_saves();
     void load_models(const std::string& timestamp, 
                     const std::vector<float>& initial_data);
 
@@ -55,31 +86,68 @@ public:
 
     void reset_with_initial_data(const std::vector<float>& initial_data);
 
+    #ifdef TESTING
+    // Raw sensor values in and out of the observed window bookkeeping
+    void observe(float val) { push_observed(normalize_data(val)); }
+    bool inside_range(float val) { return is_inside_range(normalize_data(val)); }
+    int get_out_of_range_count() const { return out_of_range_count; }
+    bool default_normal() { return is_default_normal(); }
+    #endif
+
 private:
     // Configuration
     ValueRangeConfig value_range_config;
     PredictorConfig predictor_config;
     float minimal_threshold;
     
-    // Data storage
-    std::vector<float> observed_vals;
-    std::vector<float> predicted_vals;
-    std::vector<float> predictive_errors;
-    std::vector<float> thresholds;
-    std::vector<size_t> anomalies;
+    // Data storage. Online histories are fixed-size rings, so memory does
+    // not grow with uptime
+    std::vector<float> training_vals;      // normalized training set, released after train()
+    std::vector<float> training_errors;    // predictor errors on the training set, for the generator
+    RingBuffer<float> observed_vals;       // last max(train_size, lookback_len + 1) samples
+    RingBuffer<float> predicted_vals;      // last lookback_len predictions
+    RingBuffer<float> predictive_errors;   // last lookback_len errors
+    RingBuffer<float> thresholds;          // last lookback_len thresholds
+    RingBuffer<size_t> anomalies;          // positions of the last train_size anomalies
+    size_t observed_count;                 // position of the newest observed value
+    int out_of_range_count;                // out-of-range values among the last train_size observed
+
+    StageStats stage_stats;
+    StageStats::Lap lap;                   // times the stages of the current sample
+
+    // The sample between begin_sample and finish_sample
+    struct PendingSample {
+        float observed = 0.0f;
+        float normalized = 0.0f;
+        float predicted = 0.0f;
+        float error = 0.0f;
+        bool needs_threshold = false;
+    };
+    PendingSample pending;
+
+    // Preallocated inference buffers
+    std::vector<std::vector<std::vector<float>>> input_window;
+    std::vector<float> past_errors_window;
     
-    // Logging
-    std::ofstream f_log;
+    // Logging, rows go through the shared background writer
+    ResultLogger::Channel* f_log;
     std::string f_name;
+    void log_result(float observed, float predicted, float threshold, bool anomalous, float error);
     
     // Helper methods
+    void train_predictor();    // fits the predictor and fills training_errors
+    void train_generator();    // fits the generator and finishes training
     void learn_error_pattern(const std::vector<std::vector<std::vector<float>>>& trainX,
                            const std::vector<float>& trainY);
-    void update_generator(const std::vector<float>& past_errors, float recent_error);
+    // Returns the number of updates applied before early stopping
+    int update_generator(const std::vector<float>& past_errors, float recent_error);
     void logging(bool is_anomalous_ret);
     float normalize_data(float val);
     float reverse_normalized_data(float val);
-    bool is_inside_range(float val);
+    bool is_inside_range(float val) const;
+    static uint64_t elapsed_ns(std::chrono::steady_clock::time_point start);
+    void push_observed(float normalized);
+    void clear_observed();
     bool is_default_normal();
     float simplify_error(const std::vector<float>& errors, float N_sigma = 0);
 
@@ -89,8 +157,12 @@ private:
     void clean_old_saves(size_t keep_count);
 
     void save_if_needed(size_t data_point_count);
+    void load_legacy_model(const std::string& load_file);
 
     std::string parameter_name;
+    // parameter_name of the model whose backbones this one shares (itself for
+    // the owner), empty if it has its own
+    std::string backbone_owner;
 
     size_t get_current_memory() {
         struct rusage rusage;
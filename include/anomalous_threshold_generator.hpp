@@ -13,11 +13,15 @@ public:
     AnomalousThresholdGenerator(int lstm_layer, int lstm_unit, 
                                int lookback_len, int prediction_len);
     
+    // Trains on sliding windows of data2learn, batch_size windows per update step
     std::pair<std::vector<std::vector<std::vector<float>>>, std::vector<float>>
-    train(int epoch, float lr, const std::vector<float>& data2learn);
+    train(int epoch, float lr, const std::vector<float>& data2learn, int batch_size = 1);
     
     // Make a single prediction
     float generate(const std::vector<float>& prediction_errors, float minimal_threshold);
+    // generate() from the model's raw output, for callers running infer() themselves
+    static float to_threshold(float output, float minimal_threshold);
+    LSTMPredictor& model() { return *generator; }
     
     void update(int epoch_update, float lr_update,
                 const std::vector<float>& past_errors, float recent_error);
@@ -32,21 +36,51 @@ public:
     }
     
     void reset_states() { generator->reset_states(); }
+    void set_activation(Activation kind) { generator->set_activation(kind); }
+    void set_inference_precision(InferencePrecision precision) { generator->set_inference_precision(precision); }
+    void set_optimizer(const OptimizerConfig& config) { generator->set_optimizer(config); }
     void train_step(const std::vector<std::vector<std::vector<float>>>& x,
                    const std::vector<float>& target,
                    const LSTMPredictor::LSTMOutput& lstm_output,
                    float learning_rate) {
         generator->train_step(x, target, lstm_output, learning_rate);
     }
+    float train_step(const std::vector<std::vector<std::vector<float>>>& x,
+                     const std::vector<float>& target,
+                     float learning_rate,
+                     float stop_above = std::numeric_limits<float>::infinity()) {
+        return generator->train_step(x, target, learning_rate, stop_above);
+    }
+    float train_step_unchecked(const std::vector<std::vector<std::vector<float>>>& x,
+                               const std::vector<float>& target,
+                               float learning_rate,
+                               float stop_above = std::numeric_limits<float>::infinity()) {
+        return generator->train_step_unchecked(x, target, learning_rate, stop_above);
+    }
 
     // Model save/load methods
     void save_weights(std::ofstream& file);
     void save_biases(std::ofstream& file);
-    void load_weights(std::ifstream& file);
-    void load_biases(std::ifstream& file);
     void save_layer_cache(std::ofstream& file) const;
-    void load_layer_cache(std::ifstream& file);
     void initialize_layer_cache();
+    void save_checkpoint(CheckpointWriter& ckpt, const std::string& prefix) const {
+        generator->save_checkpoint(ckpt, prefix);
+    }
+    void load_checkpoint(const CheckpointReader& ckpt, const std::string& prefix) {
+        generator->load_checkpoint(ckpt, prefix);
+    }
+
+    // Shared backbone mode: train_backbone fits the model on the pooled windows
+    // of several series, the other models of the group then share_backbone()
+    // with it and train() only fits their own head
+    void train_backbone(int epoch, float lr, const std::vector<std::vector<float>>& series,
+                        int batch_size = 1);
+    void share_backbone(AnomalousThresholdGenerator& owner) { generator->share_backbone(*owner.generator); }
+    bool shares_backbone() const { return generator->shares_backbone(); }
+    void retie_backbone(AnomalousThresholdGenerator& owner) { generator->retie_backbone(*owner.generator); }
+    bool has_backbone_weights_of(const AnomalousThresholdGenerator& owner) const {
+        return generator->has_backbone_weights_of(*owner.generator);
+    }
 
     void clear_temporary_cache() {
         if (generator) {
@@ -66,5 +100,7 @@ private:
     
     std::pair<std::vector<std::vector<float>>, std::vector<float>>
     create_sliding_windows(const std::vector<float>& data);
+    void fit(int epoch, float lr, const std::pair<std::vector<std::vector<float>>, std::vector<float>>& windows,
+             int batch_size);
 };
 #endif // ANOMALOUS_THRESHOLD_GENERATOR_HPP
@@ -0,0 +1,129 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include "matrix_utils.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Model checkpoint container.
+//
+// Layout (native byte order, checked on load through an endianness tag):
+//   header         64 bytes: magic "ADAPADCK", format version, endianness tag,
+//                  section count, file size, CRC32 of the section table and
+//                  of the header itself
+//   section table  64 bytes per section: name, offset, size, CRC32
+//   payloads       each starting on a 64-byte boundary
+//
+// Matrix sections hold a 64-byte shape block followed by the rows in Matrix's
+// padded layout, so a loaded matrix can point straight into the mapped file.
+// Every CRC is verified when the file is opened, a damaged or truncated file
+// is rejected with std::runtime_error before anything is read from it.
+//
+// Versions: 1 also stored the activation tape of the last training step,
+// 2 keeps only what is needed to resume (weights, biases, h/c state). Loaders
+// look sections up by name, so older files still load and their extra
+// sections are skipped.
+const uint32_t CHECKPOINT_VERSION = 2;
+
+class CheckpointWriter {
+public:
+    void add_bytes(const std::string& name, const void* data, size_t bytes);
+    void add_floats(const std::string& name, const float* data, size_t count);
+    void add_floats(const std::string& name, const std::vector<float>& values) {
+        add_floats(name, values.data(), values.size());
+    }
+    void add_matrix(const std::string& name, const Matrix& m);
+    void add_string(const std::string& name, const std::string& value) {
+        add_bytes(name, value.data(), value.size());
+    }
+
+    // Payload bytes held in memory
+    size_t size_bytes() const;
+
+    // Writes to a hidden temp file next to path, syncs it and renames it over
+    // path, so a crash leaves either the previous file or the complete new one.
+    // Throws std::runtime_error if the file cannot be written completely.
+    void write(const std::string& path) const;
+
+private:
+    std::vector<char>& new_section(const std::string& name, size_t bytes);
+
+    struct Section {
+        std::string name;
+        std::vector<char> payload;
+    };
+    std::vector<Section> sections;
+};
+
+class CheckpointReader {
+public:
+    // True if the file starts with the checkpoint magic. Older saves do not,
+    // but neither does a checkpoint with a damaged header, so a file failing
+    // this is not yet known to be a legacy save (see LegacyModelStream)
+    static bool is_checkpoint(const std::string& path);
+
+    // Maps the file copy-on-write and validates header, table and all section CRCs
+    explicit CheckpointReader(const std::string& path);
+
+    uint32_t version() const { return file_version; }
+    bool has(const std::string& name) const;
+
+    // Copies a section that must be exactly `bytes` long
+    void read_bytes(const std::string& name, void* out, size_t bytes) const;
+    std::vector<float> read_floats(const std::string& name) const;
+    std::string read_string(const std::string& name) const;
+    void read_floats(const std::string& name, std::vector<float>& out) const { out = read_floats(name); }
+
+    // Points m at the section in the mapping (no copy). Writes to m stay
+    // private to this process (MAP_PRIVATE) and never reach the file.
+    void view_matrix(const std::string& name, Matrix& m) const;
+    // Copies the section into m's own storage
+    void read_matrix(const std::string& name, Matrix& m) const;
+
+private:
+    struct Mapping;
+    struct Entry {
+        std::string name;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    const Entry& find(const std::string& name) const;
+    void matrix_shape(const Entry& entry, size_t& rows, size_t& cols, char*& data) const;
+
+    std::string path;
+    std::shared_ptr<Mapping> mapping;
+    std::vector<Entry> entries;
+    uint32_t file_version;
+};
+
+// Bounds-checked reads over a save from before the checkpoint container:
+// size_t sizes and raw floats, as LSTMPredictor::save_weights etc. stream
+// them. Reading past the end throws std::runtime_error, so a corrupt size can
+// not make the reader allocate or read more than the file holds.
+class LegacyModelStream {
+public:
+    // Reads the whole file; throws std::runtime_error if it cannot
+    explicit LegacyModelStream(const std::string& path);
+
+    uint64_t read_size();
+    void read_floats(float* out, size_t count);
+    // Checks that a stored size equals the one the model expects
+    void expect_size(const std::string& what, uint64_t expected);
+
+    size_t remaining() const { return bytes.size() - pos; }
+
+private:
+    void read(void* out, size_t count);
+
+    std::string path;
+    std::vector<char> bytes;
+    size_t pos;
+};
+
+uint32_t crc32(const void* data, size_t bytes, uint32_t crc = 0);
+
+#endif // CHECKPOINT_HPP
@@ -0,0 +1,58 @@
+#ifndef CHECKPOINT_SAVER_HPP
+#define CHECKPOINT_SAVER_HPP
+
+#include "checkpoint.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Writes checkpoints from a background thread.
+//
+// The caller builds a CheckpointWriter (which copies the model state into
+// memory) and hands it over; the file itself is written, synced and renamed
+// into place by the saver thread via CheckpointWriter::write. If a job for the
+// same key is still waiting when a newer snapshot arrives, the older one is
+// dropped, only the latest state of a model is worth writing.
+//
+// after_write runs on the saver thread once the file is in place (used to
+// delete the files it replaces). Write errors are reported on std::cerr.
+class CheckpointSaver {
+public:
+    CheckpointSaver();
+    ~CheckpointSaver();  // writes out every pending job
+
+    // Safe to call from several threads
+    void submit(const std::string& key, CheckpointWriter&& ckpt, const std::string& path,
+                std::function<void()> after_write = nullptr);
+
+    // Blocks until every job submitted so far has been written
+    void wait_idle();
+
+    // Jobs that failed to write since construction
+    size_t failed_count() const;
+
+private:
+    struct Job {
+        std::string key;
+        std::string path;
+        CheckpointWriter ckpt;
+        std::function<void()> after_write;
+    };
+
+    void saver_loop();
+
+    std::deque<Job> pending;
+    mutable std::mutex mutex;
+    std::condition_variable work_cv;
+    std::condition_variable idle_cv;
+    bool busy;
+    bool stopping;
+    size_t failed;
+
+    std::thread saver;
+};
+
+#endif // CHECKPOINT_SAVER_HPP
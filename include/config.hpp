@@ -5,6 +5,9 @@
 #include <map>
 #include <vector>
 #include "yaml_handler.hpp"
+#include "activations.hpp"
+#include "quantized_matrix.hpp"
+#include "optimizer.hpp"
 #include <algorithm> 
 // Configuration structure for predictor settings
 struct PredictorConfig {
@@ -36,6 +39,17 @@ private:
         load_enabled = false;   
         save_interval = 48;    
         save_path = "model_states/";
+        batch_size = 1;
+        activation = Activation::Exact;
+        inference_precision = InferencePrecision::Float32;
+        shared_backbone = false;
+        num_threads = 1;
+        pin_threads = false;
+        follow_input = false;
+        follow_poll_ms = 200;
+        log_flush_interval_ms = 1000;
+        log_buffer_records = 1024;
+        stats_interval = 0;
     }
     std::map<std::string, std::string> config_map;
     Config(const Config&) = delete;
@@ -87,6 +101,12 @@ public:
     std::string data_source_path;
     std::string data_val_path;
     std::string log_file_path;
+    bool follow_input;     // Keep reading the CSV as it grows (tail -f)
+    int follow_poll_ms;    // How often to check for new rows in follow mode
+    int log_flush_interval_ms;  // Result log writer wakeup period (0 = every record)
+    int log_buffer_records;     // Result log ring size per parameter
+    int stats_interval;         // Timesteps between stage stats exports (0 = off)
+    std::string stats_file;     // Metrics file rewritten at each export (empty = stats line on stdout)
 
     // Training parameters
     int epoch_train;
@@ -97,6 +117,8 @@ public:
     float lr_update_generator;     // New
     int update_G_epoch;
     float update_G_lr;
+    int batch_size;        // Windows per gradient step in initial training
+    OptimizerConfig optimizer;  // Update rule for both models (sgd, momentum or adam)
 
     // Model architecture
     int LSTM_size;
@@ -106,6 +128,9 @@ public:
     int train_size;
     int num_classes;
     int input_size;
+    Activation activation;     // Gate activations: exact (libm) or fast approximations
+    InferencePrecision inference_precision;  // Weights used by predict/generate: fp32 or int8
+    bool shared_backbone;      // One LSTM backbone per model kind for all sensors, per-sensor heads
 
     // Anomaly detection
     float minimal_threshold;
@@ -118,6 +143,8 @@ public:
     // System
     unsigned int random_seed;
     bool verbose_output;
+    int num_threads;       // Sensors processed concurrently per timestep (0 = all cores)
+    bool pin_threads;      // Pin scheduler threads to cores
 
     // Model state configuration
     bool save_enabled;
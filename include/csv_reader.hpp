@@ -0,0 +1,51 @@
+#ifndef CSV_READER_HPP
+#define CSV_READER_HPP
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Single-pass reader for the sensor CSV (timestamp first, one column per
+// sensor). Rows are parsed as they are read and handed out one at a time, so
+// memory stays bounded by the longest line no matter how long the file is.
+//
+// In follow mode the reader behaves like `tail -f`: at end of file it waits for
+// the file to grow instead of returning false, and a line without its trailing
+// newline is held back until the rest of it arrives.
+class CSVStreamReader {
+public:
+    // Value used for empty, unparseable or placeholder fields ("NA", "NaN", "-", "0.0")
+    static constexpr float MISSING_VALUE = -999.0f;
+
+    // Opens the file and reads the header; throws std::runtime_error if either fails
+    CSVStreamReader(const std::string& path, bool follow = false, int poll_interval_ms = 200);
+
+    // Sensor column names from the header, timestamp excluded
+    const std::vector<std::string>& columns() const { return column_names; }
+
+    // Parses the next row into values (one entry per column). Returns false at
+    // end of file; in follow mode it only returns once a full row is available.
+    bool next_row(std::vector<float>& values);
+
+    size_t rows_read() const { return row_count; }
+    size_t invalid_count(size_t column) const { return invalid_counts[column]; }
+
+private:
+    bool read_line();
+    float parse_field(const char* begin, const char* end, size_t column);
+
+    std::ifstream file;
+    std::string path;
+    bool follow;
+    int poll_interval_ms;
+
+    std::vector<std::string> column_names;
+    std::vector<size_t> invalid_counts;
+    std::string line;
+    std::string partial;
+    size_t line_number;
+    size_t row_count;
+};
+
+#endif // CSV_READER_HPP
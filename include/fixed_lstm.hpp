@@ -0,0 +1,32 @@
+#ifndef FIXED_LSTM_HPP
+#define FIXED_LSTM_HPP
+
+#include <cstddef>
+
+class LSTMPredictor;
+
+// Single-sample fp32 inference specialized at compile time for the shapes
+// deployed from config.yaml. Sizes are template constants, so the matvecs and
+// gate loops have fixed trip counts and there is no per-call validation; the
+// math and its order match LSTMPredictor::infer exactly, so the results are
+// bit-identical on every backend (FP_FLAGS in the Makefile).
+//
+// Shapes are (input_size, hidden_size, num_layers), with num_classes 1. Every
+// input and hidden size listed here must also be in ADAPAD_FIXED_GEMV_COLS
+// (simd_kernels.hpp). Build with FIXED_SHAPES=0 to leave them all out.
+#define ADAPAD_FIXED_LSTM_SHAPES(X) \
+    X(3, 100, 2)
+
+// Runs one inference on the model's weights and buffers: h_state/c_state
+// must be zeroed, fc_output receives the prediction
+typedef void (*FixedInferFn)(LSTMPredictor& model, const float* x, size_t seq_len);
+
+template <int Input, int Hidden, int Layers>
+struct FixedLSTM {
+    static void infer(LSTMPredictor& model, const float* x, size_t seq_len);
+};
+
+// Specialized engine for the shape, or nullptr when none was compiled in
+FixedInferFn find_fixed_lstm(int input_size, int hidden_size, int num_layers, int num_classes);
+
+#endif // FIXED_LSTM_HPP
@@ -1,27 +1,49 @@
 #pragma once
 #include <vector>
+#include <limits>
 #include <cmath>
 #include <tuple>
 #include <random>
 #include <string>
 #include <fstream>
 #include <iostream>
-#include "blasfeo_utils.hpp"
+#include <memory>
+#include <stdexcept>
+#include "matrix_utils.hpp"
+#include "activations.hpp"
+#include "quantized_matrix.hpp"
+#include "optimizer.hpp"
+#include "fixed_lstm.hpp"
+
+// The public entry points (forward, train_step) check tensor shapes once; the
+// engine below them assumes consistent shapes. Build with DEBUG_CHECKS=1
+// (ADAPAD_DEBUG_CHECKS) to re-check dimensions on every cell step, backward
+// pass and unchecked call as well.
+#ifdef ADAPAD_DEBUG_CHECKS
+#define LSTM_DEBUG_CHECK(cond, msg) \
+    do { if (!(cond)) throw std::runtime_error(msg); } while (0)
+#else
+#define LSTM_DEBUG_CHECK(cond, msg) do { } while (0)
+#endif
+
+class CheckpointWriter;
+class CheckpointReader;
+class LegacyModelStream;
 
 class LSTMPredictor {
 public:
 
     struct LSTMLayer {
-        // [i,f,g,o] gates stacked vertically: (4*hidden_size, input_size)
-        std::vector<std::vector<float>> weight_ih;  // (4*hidden_size, input_size)
-        std::vector<std::vector<float>> weight_hh;  // (4*hidden_size, hidden_size)
+        // [i,f,g,o] gates stacked vertically, each matrix one contiguous aligned block
+        Matrix weight_ih;                           // (4*hidden_size, input_size)
+        Matrix weight_hh;                           // (4*hidden_size, hidden_size)
         std::vector<float> bias_ih;                 // (4*hidden_size)
         std::vector<float> bias_hh;                 // (4*hidden_size)
     };
 
     struct LSTMGradients {
-        std::vector<std::vector<float>> weight_ih_grad;
-        std::vector<std::vector<float>> weight_hh_grad;
+        Matrix weight_ih_grad;
+        Matrix weight_hh_grad;
         std::vector<float> bias_ih_grad;
         std::vector<float> bias_hh_grad;
     };
@@ -37,6 +59,81 @@ public:
                   int num_layers, int lookback_len, 
                   bool batch_first = true);
     
+    void set_activation(Activation kind) { activation = kind; }
+    Activation get_activation() const { return activation; }
+
+    // Int8 makes infer() run the gate matvecs on per-row quantized copies of
+    // the LSTM weights, requantized from the fp32 weights whenever they changed
+    // since the last call. forward() and training always use fp32.
+    void set_inference_precision(InferencePrecision precision) { inference_precision = precision; }
+    InferencePrecision get_inference_precision() const { return inference_precision; }
+
+    // infer() runs on the compile-time specialized engine (fixed_lstm.hpp) when
+    // one was built for this shape and the precision is fp32. On by default,
+    // turning it off forces the dynamic path (same results).
+    void set_fixed_shape_inference(bool enabled) { fixed_shape_enabled = enabled; }
+    bool uses_fixed_shape_inference() const {
+        return fixed_shape_enabled && fixed_infer != nullptr &&
+               inference_precision == InferencePrecision::Float32;
+    }
+
+    // LSTM weight bytes the inference matvecs read per timestep at the current precision
+    size_t inference_weight_bytes() const;
+
+    // Update rule used by training. Changing the rule drops its accumulated state.
+    void set_optimizer(const OptimizerConfig& config) { optimizer.configure(config); }
+    const Optimizer& get_optimizer() const { return optimizer; }
+
+    // Weight tying across models of one shape: after share_backbone(owner) the
+    // LSTM layers are the owner's, one copy in memory for every model tied to
+    // it, while the FC head stays per model (starting from a copy of the
+    // owner's). A shared backbone is frozen, so
+    // training updates the head only. Setting or loading LSTM weights gives
+    // the model its own copy again. Throws std::invalid_argument on a shape
+    // mismatch.
+    void share_backbone(LSTMPredictor& owner);
+    bool shares_backbone() const { return backbone.use_count() > 1; }
+    // Re-ties a model restored from a checkpoint: share_backbone() without
+    // taking the owner's head. Only valid if both hold the same LSTM weights,
+    // i.e. were saved from one tied group (has_backbone_weights_of).
+    void retie_backbone(LSTMPredictor& owner);
+    bool has_backbone_weights_of(const LSTMPredictor& owner) const;
+    // Equal for models tied to the same backbone
+    const void* backbone_id() const { return backbone.get(); }
+
+    // infer() for every model in `models`, all tied to this model's backbone,
+    // as one batched pass: the gate matvecs of all models become one GEMM per
+    // layer and step. x holds one sequence of seq_len * input_size values per
+    // model, out receives num_classes values per model, each through that
+    // model's own head. Runs in this model's workspaces, fp32 weights.
+    void infer_tied(const std::vector<LSTMPredictor*>& models, const float* x,
+                    size_t seq_len, float* out);
+
+    // Packed weight storage for models of one shape with their own weights:
+    // each model's LSTM weight matrices in one block of packed_floats() floats
+    // of a shared buffer, packed_offset() into the block. pack_weights copies
+    // them there and attaches the matrices to the block (owner keeps it
+    // alive), so training then updates them in place. Setting or loading
+    // weights gives the model its own storage again, is_packed_at() tells.
+    size_t packed_floats() const;
+    size_t packed_offset(int layer, bool recurrent) const;
+    void pack_weights(float* block, const std::shared_ptr<void>& owner);
+    bool is_packed_at(const float* block) const;
+
+    // infer() for models packed into one buffer, model k in the block at
+    // base + slots[k] * packed_floats(): every weight matvec is one grouped
+    // GEMV over all of them (gemv_accumulate_grouped). Same results as infer()
+    // on each model. x and out as in infer_tied; the models need this model's
+    // shape and fp32 precision. Runs in this model's workspaces.
+    void infer_packed(const std::vector<LSTMPredictor*>& models, const float* base,
+                      const std::vector<size_t>& slots, const float* x, size_t seq_len, float* out);
+
+    // Incremented by every change to the weights or biases
+    uint64_t get_weights_version() const { return weights_version; }
+
+    // How many times the layer 0 input projection was computed rather than reused
+    size_t input_projections_computed() const { return input_projection.computed; }
+
     void set_random_seed(unsigned seed) {
         random_seed = seed;
         initialize_weights();
@@ -46,6 +143,12 @@ public:
                       const std::vector<std::vector<float>>* initial_hidden = nullptr,
                       const std::vector<std::vector<float>>* initial_cell = nullptr);
     
+    // Allocation-free forward pass for one sequence of seq_len * input_size
+    // values, starting from zero state. Returns the FC output (num_classes
+    // values) held in an internal buffer that the next call overwrites.
+    // Does not record the training cache, so it is for inference only.
+    const std::vector<float>& infer(const float* x, size_t seq_len);
+
     // Weight setters for loading pretrained models
     void set_lstm_weights(int layer, const std::vector<std::vector<float>>& w_ih,
                          const std::vector<std::vector<float>>& w_hh);
@@ -56,28 +159,58 @@ public:
 
     void reset_states();
 
-    // Training methods
+    // Training methods. x may hold a mini-batch of sequences; target then holds
+    // num_classes values per sequence and the update uses the batch-mean loss.
     void train_step(const std::vector<std::vector<std::vector<float>>>& x,
                    const std::vector<float>& target,
                    const LSTMOutput& lstm_output,
                    float learning_rate);
+
+    // Fused training iteration: one forward pass, the batch-mean MSE loss and,
+    // unless that loss is above stop_above (early stopping), the backward pass
+    // and update. Returns the loss of the weights before the update. Cheaper
+    // than forward() + train_step() since no LSTMOutput is built and the FC
+    // output is computed once.
+    float train_step(const std::vector<std::vector<std::vector<float>>>& x,
+                     const std::vector<float>& target,
+                     float learning_rate,
+                     float stop_above = std::numeric_limits<float>::infinity());
+
+    // train_step without the shape checks, for callers that build x and target
+    // to the model's shape or validated them once with check_input/check_target
+    // (e.g. before an epoch loop)
+    float train_step_unchecked(const std::vector<std::vector<std::vector<float>>>& x,
+                               const std::vector<float>& target,
+                               float learning_rate,
+                               float stop_above = std::numeric_limits<float>::infinity());
+
+    // Throw std::invalid_argument unless x is [batch][seq_len][input_size] with
+    // batch, seq_len >= 1 and one seq_len for the whole batch, and target holds
+    // num_classes values per sequence
+    void check_input(const std::vector<std::vector<std::vector<float>>>& x) const;
+    void check_target(const std::vector<std::vector<std::vector<float>>>& x,
+                      const std::vector<float>& target) const;
     
     float compute_loss(const std::vector<float>& output,
                       const std::vector<float>& target);
 
+    // FC output for the last sequence of the batch, or for sequence `batch`
     std::vector<float> get_final_prediction(const LSTMOutput& lstm_output);
+    std::vector<float> get_final_prediction(const LSTMOutput& lstm_output, size_t batch);
 
     #ifdef TESTING
     float get_weight(int layer, int gate, int input_idx) const {
         // Convert from gate index to PyTorch's layout [i,f,g,o]
         int offset = gate * hidden_size;
-        return lstm_layers[layer].weight_ih[offset][input_idx];
+        return layers()[layer].weight_ih[offset][input_idx];
     }
 
     void set_weight(int layer, int gate, int input_idx, float value) {
         // Convert from gate index to PyTorch's layout [i,f,g,o]
         int offset = gate * hidden_size;
-        lstm_layers[layer].weight_ih[offset][input_idx] = value;
+        unshare_backbone();
+        layers()[layer].weight_ih[offset][input_idx] = value;
+        ++weights_version;
     }
 
     float get_weight_gradient(int layer, int gate, int input_idx) const {
@@ -91,7 +224,7 @@ public:
     #endif
 
     std::vector<LSTMLayer> get_weights() const {
-        return lstm_layers;
+        return layers();
     }
     
     void set_weights(const std::vector<LSTMLayer>& weights);
@@ -101,6 +234,9 @@ public:
     }
 
     int get_num_layers() const { return num_layers; }
+    int get_num_classes() const { return num_classes; }
+    int get_input_size() const { return input_size; }
+    int get_hidden_size() const { return hidden_size; }
 
     void eval() { 
         training_mode = false; 
@@ -114,12 +250,30 @@ public:
     // Model save/load methods
     void save_weights(std::ofstream& file);
     void save_biases(std::ofstream& file);
-    void load_weights(std::ifstream& file);
-    void load_biases(std::ifstream& file);
     void save_layer_cache(std::ofstream& file) const;
-    void load_layer_cache(std::ifstream& file);
     void initialize_layer_cache();
 
+    // Loading the stream layout above, for files from before the checkpoint
+    // container. The read_* calls check every size against this model and
+    // throw std::runtime_error on a mismatch or a short file without touching
+    // the model; set_legacy_parameters then applies what was read.
+    struct LegacyParameters {
+        std::vector<LSTMLayer> layers;
+        Matrix fc_weight;
+        std::vector<float> fc_bias;
+    };
+    // The cache is not kept (the next forward pass rewrites the tape and
+    // loading resets the state), only checked and stepped over
+    void skip_legacy_layer_cache(LegacyModelStream& in) const;
+    LegacyParameters read_legacy_parameters(LegacyModelStream& in) const;
+    void set_legacy_parameters(LegacyParameters&& params);
+
+    // Checkpoint sections are named prefix + "lstm0.weight_ih" etc. Loading
+    // maps the weight matrices straight from the file and throws if any shape
+    // does not match this model.
+    void save_checkpoint(CheckpointWriter& ckpt, const std::string& prefix) const;
+    void load_checkpoint(const CheckpointReader& ckpt, const std::string& prefix);
+
     std::pair<std::vector<float>, std::vector<float>> get_state() const {
         return {h_state[0], c_state[0]};  // Return first layer's states
     }
@@ -145,86 +299,192 @@ private:
     int seq_length;
     bool batch_first;
 
-    std::vector<LSTMLayer> lstm_layers;
+    // LSTM layers, possibly shared with other models (share_backbone)
+    std::shared_ptr<std::vector<LSTMLayer>> backbone;
 
     // Final linear layer weights
-    std::vector<std::vector<float>> fc_weight;
+    Matrix fc_weight;
     std::vector<float> fc_bias;
 
     // Hidden states
     std::vector<std::vector<float>> h_state; // [num_layers][hidden_size]
     std::vector<std::vector<float>> c_state; // [num_layers][hidden_size]
 
-    struct LSTMCacheEntry {
-        std::vector<float> input;
-        std::vector<float> prev_hidden;
-        std::vector<float> prev_cell;
-        std::vector<float> cell_state;
-        std::vector<float> input_gate;
-        std::vector<float> forget_gate;
-        std::vector<float> cell_gate;
-        std::vector<float> output_gate;
-        std::vector<float> hidden_state;
-        
-        LSTMCacheEntry() = default;
-        LSTMCacheEntry(const LSTMCacheEntry& other) = default;
-        LSTMCacheEntry& operator=(const LSTMCacheEntry& other) = default;
+    // Preallocated workspaces
+    template <int Input, int Hidden, int Layers> friend struct FixedLSTM;
+    FixedInferFn fixed_infer = nullptr;      // specialized infer() for this shape, if any
+    bool fixed_shape_enabled = true;
+
+    std::vector<float> gates_buf;            // [batch][4*hidden_size] gate pre-activations
+    std::vector<float> cell_tanh_buf;        // [hidden_size] tanh of the new cell state
+    std::vector<float> fc_output;            // [num_classes] result of infer()
+    Matrix fc_batch_output;                  // [batch][num_classes] predictions of the fused train_step
+    std::vector<float> flat_input;           // [seq_len][batch][input_size] layer 0 input of forward()
+    std::vector<Matrix> batch_h_state;       // [num_layers] of [batch][hidden_size]
+    std::vector<Matrix> batch_c_state;       // [num_layers] of [batch][hidden_size]
+    std::vector<const Matrix*> packed_projections;  // [model] layer 0 terms in infer_packed
+
+    // Activations the forward pass records for BPTT, one matrix per quantity
+    // with a row per (layer, batch, t) step. Rows are written in place by
+    // lstm_cell_forward and simply overwritten by the next forward pass.
+    struct ActivationTape {
+        size_t num_layers = 0;
+        size_t batch_size = 0;
+        size_t seq_len = 0;
+        Matrix input;           // layer 0 only uses the first input_size columns
+        Matrix prev_hidden;
+        Matrix prev_cell;
+        Matrix cell_state;
+        Matrix input_gate;
+        Matrix forget_gate;
+        Matrix cell_gate;
+        Matrix output_gate;
+        Matrix hidden_state;
+
+        void resize(size_t layers, size_t batches, size_t steps,
+                    size_t input_width, size_t hidden_size);
+        void clear() { resize(0, 0, 0, 0, 0); }
+        bool empty() const { return batch_size == 0 || seq_len == 0; }
+        bool has_shape(size_t layers, size_t batches, size_t steps) const {
+            return num_layers == layers && batch_size == batches && seq_len == steps;
+        }
+        size_t step(size_t layer, size_t batch, size_t t) const {
+            return (layer * batch_size + batch) * seq_len + t;
+        }
     };
-    std::vector<std::vector<std::vector<LSTMCacheEntry>>> layer_cache;
+    ActivationTape tape;
 
     // Store last gradients for testing
     std::vector<LSTMGradients> last_gradients;
 
-    // Helper functions
-    float sigmoid(float x);
-    float tanh_custom(float x);
-    std::vector<float> lstm_cell_forward(
-        const std::vector<float>& input,
-        std::vector<float>& h_state,
-        std::vector<float>& c_state,
-        const LSTMLayer& layer);
+    // Backward pass workspaces. Like the tape they keep their storage between
+    // training steps and are only zeroed in place; the seq_len and batch sized
+    // ones grow on the first step with a new shape.
+    struct BackwardBuffers {
+        Matrix fc_weight_grad;           // [num_classes][hidden_size]
+        std::vector<float> fc_bias_grad; // [num_classes]
+        std::vector<float> loss_grad;    // [num_classes] MSE gradient of one prediction
+        Matrix lstm_grad;                // [batch][hidden_size] gradient of the top layer's last h
+        std::vector<float> output_grad;  // [seq_len][hidden_size] gradient of this layer's outputs
+        std::vector<float> below_grad;   // [seq_len][hidden_size] same for the layer below
+        std::vector<float> dh;           // [hidden_size] recurrent gradients from timestep t+1
+        std::vector<float> dc;
+        std::vector<float> dh_prev;      // [hidden_size] and the ones passed on to t-1
+        std::vector<float> dc_prev;
+        std::vector<float> d_gates;      // [4*hidden_size] stacked [i,f,g,o]
+        std::vector<float> tanh_cell;    // [hidden_size]
+    };
+    BackwardBuffers backward_bufs;
+
+    // Gate activation implementation (libm or fast approximations)
+    Activation activation = Activation::Exact;
+
+    // Int8 copies of the LSTM weights for infer(), valid while
+    // quantized_version == weights_version
+    struct QuantizedLayer {
+        QuantizedMatrix weight_ih;
+        QuantizedMatrix weight_hh;
+    };
+    InferencePrecision inference_precision = InferencePrecision::Float32;
+    std::vector<QuantizedLayer> quantized_layers;
+    uint64_t weights_version = 0;
+    uint64_t quantized_version = 0;
+
+    void update_quantized_weights();
+
+    // Layer 0 gate pre-activations without the recurrent term,
+    // bias_ih + bias_hh + weight_ih * x, with one row per (t, batch) of the
+    // last input. Layer 0 has no recurrence in its input, so the whole window
+    // is projected in one pass; the result is reused while the input, the
+    // weights and the precision are unchanged (infer() followed by the first
+    // forward() of an update on the same window).
+    struct InputProjection {
+        Matrix gates;               // [seq_len * batch][4*hidden_size], row t*batch + b
+        std::vector<float> input;   // input it was computed from, same row order
+        size_t batch = 0;
+        size_t seq_len = 0;
+        bool int8 = false;
+        uint64_t weights_version = 0;
+        size_t computed = 0;
+    };
+    InputProjection input_projection;
+
+    // x holds batch * seq_len rows of input_size, row t * batch + b
+    const Matrix& project_input(const float* x, size_t batch, size_t seq_len,
+                                const QuantizedLayer* quantized);
+    void fill_gate_biases(const LSTMLayer& layer, float* gates_all,
+                          size_t gate_stride, size_t batch) const;
+
+    // Advances one layer by one timestep for `batch` sequences. Sequence b
+    // reads input + b*input_stride and updates h_state/c_state + b*state_stride
+    // in place. With `quantized` the gate matvecs use its int8 weights. With
+    // `projected` (row b at b*projected_stride) the biases and weight_ih term
+    // are taken from there instead of being computed.
+    void lstm_cell_forward(
+        const float* input,
+        size_t input_len,
+        size_t input_stride,
+        float* h_state,
+        float* c_state,
+        size_t state_stride,
+        size_t batch,
+        const LSTMLayer& layer,
+        const QuantizedLayer* quantized = nullptr,
+        const float* projected = nullptr,
+        size_t projected_stride = 0);
     
+    // forward() without building the LSTMOutput when output is null; the
+    // final states are left in h_state/c_state and batch_h_state/batch_c_state
+    void forward_batch(const std::vector<std::vector<std::vector<float>>>& x,
+                       const std::vector<std::vector<float>>* initial_hidden,
+                       const std::vector<std::vector<float>>* initial_cell,
+                       LSTMOutput* output);
+    // Sizes the batch workspaces and sets each sequence's starting state
+    void begin_batch(size_t batch_size,
+                     const std::vector<std::vector<float>>* initial_hidden,
+                     const std::vector<std::vector<float>>* initial_cell);
+    // Runs every layer over the seq_len steps in flat_input (row t * batch + b),
+    // leaving the top layer's last hidden states in batch_h_state
+    void run_batch(size_t batch_size, size_t seq_len, LSTMOutput* output);
+
+    // Gives the model its own copy of a shared backbone before the LSTM weights change
+    void unshare_backbone();
+    std::vector<LSTMLayer>& layers() { return *backbone; }
+    const std::vector<LSTMLayer>& layers() const { return *backbone; }
+
+    // out[num_classes] = fc_weight * hidden + fc_bias
+    void compute_fc_output(const float* hidden, float* out) const;
+
+    // Backward pass from the FC layer down and the weight update; row b of
+    // predictions/last_hidden belongs to sequence b of the forward pass on the tape
+    void backward_and_update(const std::vector<float>& target,
+                             const Matrix& predictions,
+                             const Matrix& last_hidden,
+                             float learning_rate);
+
     // Training helper functions
     void backward_linear_layer(const std::vector<float>& grad_output,
-                             const std::vector<float>& last_hidden,
-                             std::vector<std::vector<float>>& weight_grad,
+                             const float* last_hidden,
+                             Matrix& weight_grad,
                              std::vector<float>& bias_grad,
-                             std::vector<float>& input_grad);
+                             float* input_grad);            // [hidden_size]
     
-    std::vector<LSTMGradients> backward_lstm_layer(
-        const std::vector<float>& grad_output,
-        const std::vector<std::vector<std::vector<LSTMCacheEntry>>>& cache,
+    // Fills and returns last_gradients
+    const std::vector<LSTMGradients>& backward_lstm_layer(
+        const Matrix& grad_output,                          // [batch][hidden_size]
+        const ActivationTape& cache,
         float learning_rate);
 
     int current_layer = 0;
-    size_t current_batch{0};  
     size_t current_timestep{0};
 
     void initialize_weights();
 
-    // For LSTM layers
-    std::vector<std::vector<std::vector<float>>> m_weight_ih;
-    std::vector<std::vector<std::vector<float>>> v_weight_ih;
-    std::vector<std::vector<std::vector<float>>> m_weight_hh;
-    std::vector<std::vector<std::vector<float>>> v_weight_hh;
-    std::vector<std::vector<float>> m_bias_ih;
-    std::vector<std::vector<float>> v_bias_ih;
-    std::vector<std::vector<float>> m_bias_hh;
-    std::vector<std::vector<float>> v_bias_hh;
-
-    // For FC layer
-    std::vector<std::vector<float>> m_fc_weight;
-    std::vector<std::vector<float>> v_fc_weight;
-    std::vector<float> m_fc_bias;
-    std::vector<float> v_fc_bias;
-
-    void apply_sgd_update(std::vector<std::vector<float>>& weights,
-                        std::vector<std::vector<float>>& grads,
-                        float learning_rate);
-    
-    void apply_sgd_update(std::vector<float>& biases,
-                        std::vector<float>& grads,
-                        float learning_rate);
+    // Update rule and its per-tensor state. Slots are registered in the
+    // constructor: fc.weight, fc.bias, then weight_ih, weight_hh, bias_ih,
+    // bias_hh for each layer.
+    Optimizer optimizer;
+    static size_t layer_slot(int layer) { return 2 + 4 * static_cast<size_t>(layer); }
 
     bool training_mode = true;
     size_t current_cache_size = 0;  
@@ -4,10 +4,184 @@
 #include <vector>
 #include <string>
 #include <cstddef>
+#include <cstdlib>
+#include <new>
 #include <utility>
+#include <algorithm>
+#include <memory>
+
+// Allocator returning blocks aligned to a cache line so weight rows can be
+// streamed without straddling lines (and loaded with aligned SIMD moves).
+template <typename T, std::size_t Alignment = 64>
+struct AlignedAllocator {
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+    AlignedAllocator() {}
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(std::size_t n) {
+        void* ptr = nullptr;
+        if (posix_memalign(&ptr, Alignment, n * sizeof(T)) != 0) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, std::size_t) { std::free(ptr); }
+};
+
+template <typename T, typename U, std::size_t A>
+bool operator==(const AlignedAllocator<T, A>&, const AlignedAllocator<U, A>&) { return true; }
+template <typename T, typename U, std::size_t A>
+bool operator!=(const AlignedAllocator<T, A>&, const AlignedAllocator<U, A>&) { return false; }
+
+typedef std::vector<float, AlignedAllocator<float> > AlignedVector;
+
+// Non-owning view of one matrix row, so existing m[i][j] / m[i].size() code keeps working
+template <typename T>
+class RowView {
+public:
+    RowView(T* ptr, std::size_t n) : ptr(ptr), n(n) {}
+    T& operator[](std::size_t i) const { return ptr[i]; }
+    std::size_t size() const { return n; }
+    T* data() const { return ptr; }
+    T* begin() const { return ptr; }
+    T* end() const { return ptr + n; }
+private:
+    T* ptr;
+    std::size_t n;
+};
+
+// Row-major float matrix backed by a single 64-byte aligned block.
+// Rows are padded to a multiple of 4 floats so every row starts 16-byte aligned.
+//
+// A matrix can also be attached to memory it does not own (a mapped checkpoint
+// section); it then keeps the owner alive and reads/writes that memory in place
+// until the next resize(). Copies always get their own storage.
+class Matrix {
+public:
+    static const std::size_t ROW_ALIGN = 4;
+
+    Matrix() : n_rows(0), n_cols(0), row_stride(0), base(nullptr) {}
+    Matrix(std::size_t rows, std::size_t cols, float value = 0.0f) 
+        : n_rows(0), n_cols(0), row_stride(0), base(nullptr) {
+        resize(rows, cols, value);
+    }
+
+    Matrix(const Matrix& other)
+        : n_rows(other.n_rows), n_cols(other.n_cols), row_stride(other.row_stride),
+          storage(other.base, other.base + other.n_rows * other.row_stride) {
+        base = storage.data();
+    }
+
+    Matrix& operator=(const Matrix& other) {
+        if (this != &other) {
+            n_rows = other.n_rows;
+            n_cols = other.n_cols;
+            row_stride = other.row_stride;
+            storage.assign(other.base, other.base + other.n_rows * other.row_stride);
+            base = storage.data();
+            external.reset();
+        }
+        return *this;
+    }
+
+    Matrix(Matrix&& other)
+        : n_rows(other.n_rows), n_cols(other.n_cols), row_stride(other.row_stride),
+          storage(std::move(other.storage)), external(std::move(other.external)) {
+        base = external ? other.base : storage.data();
+        other.n_rows = other.n_cols = other.row_stride = 0;
+        other.base = nullptr;
+    }
+
+    Matrix& operator=(Matrix&& other) {
+        if (this != &other) {
+            n_rows = other.n_rows;
+            n_cols = other.n_cols;
+            row_stride = other.row_stride;
+            storage = std::move(other.storage);
+            external = std::move(other.external);
+            base = external ? other.base : storage.data();
+            other.n_rows = other.n_cols = other.row_stride = 0;
+            other.base = nullptr;
+        }
+        return *this;
+    }
+
+    // Reshapes and fills every element with value (existing contents are discarded)
+    void resize(std::size_t rows, std::size_t cols, float value = 0.0f) {
+        n_rows = rows;
+        n_cols = cols;
+        row_stride = padded_stride(cols);
+        storage.assign(n_rows * row_stride, 0.0f);
+        base = storage.data();
+        external.reset();
+        if (value != 0.0f) {
+            fill(value);
+        }
+    }
+
+    // Uses rows * padded_stride(cols) floats at data in place. data must be
+    // 16-byte aligned and stay valid while owner is alive.
+    void attach(float* data, std::size_t rows, std::size_t cols, std::shared_ptr<void> owner) {
+        n_rows = rows;
+        n_cols = cols;
+        row_stride = padded_stride(cols);
+        AlignedVector().swap(storage);
+        base = data;
+        external = std::move(owner);
+    }
+
+    static std::size_t padded_stride(std::size_t cols) {
+        return (cols + ROW_ALIGN - 1) / ROW_ALIGN * ROW_ALIGN;
+    }
+
+    void fill(float value) {
+        for (std::size_t r = 0; r < n_rows; ++r) {
+            std::fill(row(r), row(r) + n_cols, value);
+        }
+    }
+
+    void assign(const std::vector<std::vector<float>>& values) {
+        resize(values.size(), values.empty() ? 0 : values[0].size());
+        for (std::size_t r = 0; r < n_rows; ++r) {
+            std::copy(values[r].begin(), values[r].begin() + n_cols, row(r));
+        }
+    }
+
+    std::size_t rows() const { return n_rows; }
+    std::size_t cols() const { return n_cols; }
+    std::size_t stride() const { return row_stride; }
+    std::size_t size() const { return n_rows; }  // row count, like the nested vectors it replaces
+    bool empty() const { return n_rows == 0; }
+    bool is_attached() const { return static_cast<bool>(external); }
+
+    float* data() { return base; }
+    const float* data() const { return base; }
+    float* row(std::size_t r) { return base + r * row_stride; }
+    const float* row(std::size_t r) const { return base + r * row_stride; }
+
+    RowView<float> operator[](std::size_t r) { return RowView<float>(row(r), n_cols); }
+    RowView<const float> operator[](std::size_t r) const { return RowView<const float>(row(r), n_cols); }
+
+private:
+    std::size_t n_rows;
+    std::size_t n_cols;
+    std::size_t row_stride;
+    AlignedVector storage;
+    float* base;                      // storage.data() or attached memory
+    std::shared_ptr<void> external;   // keeps attached memory alive
+};
 
 std::vector<float> compute_mse_loss_gradient(const std::vector<float>& output, const std::vector<float>& target);
 std::pair<std::vector<std::vector<float>>, std::vector<float>>
 create_sliding_windows(const std::vector<float>& data, int lookback_len, int prediction_len);
+// Windows of several series, interleaved: window 0 of every series, then window 1, ...
+std::pair<std::vector<std::vector<float>>, std::vector<float>>
+create_pooled_windows(const std::vector<std::vector<float>>& series, int lookback_len, int prediction_len);
 
 #endif // MATRIX_UTILS_HPP
@@ -10,22 +10,42 @@ class NormalDataPredictor {
 public:
     NormalDataPredictor(int lstm_layer, int lstm_unit, int lookback_len, int prediction_len);
     
+    // Trains on sliding windows of data2learn, batch_size windows per update step
     std::pair<std::vector<std::vector<std::vector<float>>>, std::vector<float>>
-    train(int epoch, float lr, const std::vector<float>& data2learn);
+    train(int epoch, float lr, const std::vector<float>& data2learn, int batch_size = 1);
     
     float predict(const std::vector<std::vector<std::vector<float>>>& observed);
+    // predict() from the model's raw output, for callers running infer() themselves
+    static float to_prediction(float output);
+    LSTMPredictor& model() { return *predictor; }
     
-    void update(int epoch_update, float lr_update,
+    // Online update with early stopping, returns the number of updates applied
+    int update(int epoch_update, float lr_update,
                 const std::vector<std::vector<std::vector<float>>>& past_observations,
                 const std::vector<float>& recent_observation);
 
     void reset_states() { predictor->reset_states(); }
+    void set_activation(Activation kind) { predictor->set_activation(kind); }
+    void set_inference_precision(InferencePrecision precision) { predictor->set_inference_precision(precision); }
+    void set_optimizer(const OptimizerConfig& config) { predictor->set_optimizer(config); }
     void train_step(const std::vector<std::vector<std::vector<float>>>& x,
                    const std::vector<float>& target,
                    const LSTMPredictor::LSTMOutput& lstm_output,
                    float learning_rate) {
         predictor->train_step(x, target, lstm_output, learning_rate);
     }
+    float train_step(const std::vector<std::vector<std::vector<float>>>& x,
+                     const std::vector<float>& target,
+                     float learning_rate,
+                     float stop_above = std::numeric_limits<float>::infinity()) {
+        return predictor->train_step(x, target, learning_rate, stop_above);
+    }
+    float train_step_unchecked(const std::vector<std::vector<std::vector<float>>>& x,
+                               const std::vector<float>& target,
+                               float learning_rate,
+                               float stop_above = std::numeric_limits<float>::infinity()) {
+        return predictor->train_step_unchecked(x, target, learning_rate, stop_above);
+    }
 
     // Existing delegate methods
     void eval() { predictor->eval(); }
@@ -40,11 +60,26 @@ public:
     // Model save/load methods
     void save_weights(std::ofstream& file);
     void save_biases(std::ofstream& file);
-    void load_weights(std::ifstream& file);
-    void load_biases(std::ifstream& file);
     void save_layer_cache(std::ofstream& file) const;
-    void load_layer_cache(std::ifstream& file);
     void initialize_layer_cache();
+    void save_checkpoint(CheckpointWriter& ckpt, const std::string& prefix) const {
+        predictor->save_checkpoint(ckpt, prefix);
+    }
+    void load_checkpoint(const CheckpointReader& ckpt, const std::string& prefix) {
+        predictor->load_checkpoint(ckpt, prefix);
+    }
+
+    // Shared backbone mode: train_backbone fits the model on the pooled windows
+    // of several series, the other models of the group then share_backbone()
+    // with it and train() only fits their own head
+    void train_backbone(int epoch, float lr, const std::vector<std::vector<float>>& series,
+                        int batch_size = 1);
+    void share_backbone(NormalDataPredictor& owner) { predictor->share_backbone(*owner.predictor); }
+    bool shares_backbone() const { return predictor->shares_backbone(); }
+    void retie_backbone(NormalDataPredictor& owner) { predictor->retie_backbone(*owner.predictor); }
+    bool has_backbone_weights_of(const NormalDataPredictor& owner) const {
+        return predictor->has_backbone_weights_of(*owner.predictor);
+    }
 
     void clear_temporary_cache() {
         if (predictor) {
@@ -64,5 +99,7 @@ private:
     
     std::pair<std::vector<std::vector<float>>, std::vector<float>>
     create_sliding_windows(const std::vector<float>& data);
+    void fit(int epoch, float lr, const std::pair<std::vector<std::vector<float>>, std::vector<float>>& windows,
+             int batch_size);
 };
 #endif // NORMAL_DATA_PREDICTOR_HPP
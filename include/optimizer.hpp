@@ -0,0 +1,93 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "matrix_utils.hpp"
+
+class CheckpointWriter;
+class CheckpointReader;
+
+// Parameter update rule for LSTMPredictor. Every rule first clips each
+// gradient element to [-grad_clip, grad_clip]; clipping and update are done in
+// a single pass over the parameter block.
+//
+//   sgd:      w -= lr * g
+//   momentum: v = momentum * v + g;  w -= lr * v
+//   adam:     m = beta1 * m + (1 - beta1) * g
+//             v = beta2 * v + (1 - beta2) * g^2
+//             w -= lr * m_hat / (sqrt(v_hat) + epsilon), with bias correction
+enum class OptimizerKind { SGD, Momentum, Adam };
+
+// "sgd", "momentum" or "adam"; throws std::runtime_error for anything else
+OptimizerKind parse_optimizer(const std::string& name);
+const char* optimizer_name(OptimizerKind kind);
+
+struct OptimizerConfig {
+    OptimizerKind kind = OptimizerKind::SGD;
+    float grad_clip = 1.0f;
+    float momentum = 0.9f;
+    float beta1 = 0.9f;
+    float beta2 = 0.999f;
+    float epsilon = 1e-8f;
+};
+
+// Holds the per-parameter state (velocity, or Adam's two moments) for a fixed
+// list of named parameter blocks ("slots"). State is sized on the first
+// update of a slot and persists across updates and, through save/load, across
+// restarts.
+class Optimizer {
+public:
+    Optimizer() {}
+
+    // Switches the rule; existing state is dropped when the kind changes
+    void configure(const OptimizerConfig& config);
+    const OptimizerConfig& get_config() const { return cfg; }
+
+    // Registers a parameter block, returns its slot index
+    size_t add_slot(const std::string& name);
+
+    // Starts one model update (advances Adam's bias correction); call once
+    // before the update() calls of that step
+    void begin_update();
+
+    // Clips grads and updates params in place; shapes must match. Only the
+    // logical columns of a Matrix are touched, row padding stays as it is.
+    void update(size_t slot, Matrix& params, const Matrix& grads, float learning_rate);
+    void update(size_t slot, std::vector<float>& params, const std::vector<float>& grads,
+                float learning_rate);
+
+    // Sections are named prefix + slot name + ".m"/".v", plus prefix + "state".
+    // SGD has no state and writes nothing. Loading a file without optimizer
+    // sections, or saved with another rule, starts from fresh state.
+    void save(CheckpointWriter& ckpt, const std::string& prefix) const;
+    void load(const CheckpointReader& ckpt, const std::string& prefix);
+
+    void reset();
+    uint64_t step_count() const { return steps; }
+
+private:
+    struct Slot {
+        std::string name;
+        std::vector<float> m;   // momentum velocity or Adam first moment
+        std::vector<float> v;   // Adam second moment
+    };
+
+    void ensure_state(Slot& s, size_t n) const;
+
+    // Updates n contiguous values whose state starts at offset in the slot
+    void update_block(Slot& s, size_t offset, float* params, const float* grads, size_t n,
+                      float learning_rate);
+
+    OptimizerConfig cfg;
+    std::vector<Slot> slots;
+    uint64_t steps = 0;
+
+    // Adam step constants for the current update
+    float adam_step_scale = 0.0f;   // 1 / (1 - beta1^t)
+    float adam_v_scale = 0.0f;      // 1 / (1 - beta2^t)
+};
+
+#endif // OPTIMIZER_HPP
@@ -0,0 +1,54 @@
+#ifndef QUANTIZED_MATRIX_HPP
+#define QUANTIZED_MATRIX_HPP
+
+#include "matrix_utils.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Weight precision used by LSTMPredictor::infer. Training and forward() always
+// run on the fp32 master weights; Int8 only swaps the gate matvecs of the
+// inference path for per-row quantized copies.
+enum class InferencePrecision { Float32, Int8 };
+
+// "fp32" or "int8"; throws std::runtime_error for anything else
+InferencePrecision parse_inference_precision(const std::string& name);
+const char* inference_precision_name(InferencePrecision precision);
+
+// Symmetric per-row int8 copy of a Matrix: w[r][c] ~= scale(r) * row(r)[c],
+// with scale(r) = max|w[r][c]| / 127, so the rounding error of every entry is
+// at most scale(r) / 2. Rows are zero padded to a multiple of 16 bytes.
+class QuantizedMatrix {
+public:
+    QuantizedMatrix() : n_rows(0), n_cols(0), row_stride(0) {}
+
+    // Requantizes from w, reusing the storage when the shape is unchanged
+    void quantize(const Matrix& w);
+
+    size_t rows() const { return n_rows; }
+    size_t cols() const { return n_cols; }
+    size_t stride() const { return row_stride; }
+
+    const int8_t* row(size_t r) const { return values.data() + r * row_stride; }
+    float scale(size_t r) const { return scales[r]; }
+
+    // w[r][c] as represented by the quantized copy
+    float dequantized(size_t r, size_t c) const { return scales[r] * row(r)[c]; }
+
+    // Bytes held for values and scales
+    size_t memory_bytes() const { return memory_bytes(n_rows, n_cols); }
+    static size_t memory_bytes(size_t rows, size_t cols) {
+        return rows * padded_stride(cols) + rows * sizeof(float);
+    }
+    static size_t padded_stride(size_t cols) { return (cols + 15) & ~size_t(15); }
+
+private:
+    size_t n_rows;
+    size_t n_cols;
+    size_t row_stride;
+    std::vector<int8_t> values;
+    std::vector<float> scales;
+};
+
+#endif // QUANTIZED_MATRIX_HPP
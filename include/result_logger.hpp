@@ -0,0 +1,90 @@
+#ifndef RESULT_LOGGER_HPP
+#define RESULT_LOGGER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Buffered writer for the per-parameter *_log.csv result files.
+//
+// Each model gets a Channel: a fixed-size ring of raw records that the model
+// pushes into without locking, allocating or touching the file. One background
+// thread drains every channel, formats the rows and writes them to files that
+// stay open for the whole run. The writer wakes every flush_interval_ms, or
+// early once a ring is half full; if a ring fills up completely the model
+// waits for the writer instead of dropping rows. flush_interval_ms == 0 wakes
+// the writer for every record.
+//
+// Each channel must only be pushed to from one thread at a time (one model per
+// job in main's thread pool satisfies this).
+class ResultLogger {
+public:
+    struct Record {
+        enum Kind : uint8_t {
+            Result,        // observed,predicted,low,high,anomalous,err,threshold
+            Training,      // observed,predicted,,,,,
+            ErrorPattern   // observed,predicted,,,,
+        };
+        Kind kind;
+        bool anomalous;
+        float observed;
+        float predicted;
+        float low;
+        float high;
+        float error;
+        float threshold;
+    };
+
+    class Channel;
+
+    ResultLogger(int flush_interval_ms, size_t records_per_channel);
+    ~ResultLogger();  // writes out everything still buffered
+
+    // Truncates path and writes the header line right away
+    Channel* open(const std::string& path, const std::string& header);
+    // Writes out the channel's remaining records and closes its file
+    void close(Channel* channel);
+
+    void push(Channel* channel, const Record& record);
+
+    // Blocks until every record pushed so far is written and flushed
+    void flush();
+
+private:
+    void writer_loop();
+    void wake_writer();
+    void drain(Channel& channel);
+    void drain_all();
+
+    int flush_interval_ms;
+    size_t capacity;
+
+    std::vector<std::unique_ptr<Channel>> channels;
+    std::mutex channels_mutex;  // channel list and file writes
+
+    std::mutex mutex;           // wakeups and back-pressure
+    std::condition_variable writer_cv;
+    std::condition_variable space_cv;
+    bool wake_requested;
+    bool stopping;
+
+    std::thread writer;
+};
+
+class ResultLogger::Channel {
+    friend class ResultLogger;
+
+    std::ofstream out;
+    std::unique_ptr<Record[]> ring;
+    std::atomic<size_t> head;   // records pushed
+    std::atomic<size_t> tail;   // records written
+};
+
+#endif // RESULT_LOGGER_HPP
@@ -0,0 +1,61 @@
+#ifndef RING_BUFFER_HPP
+#define RING_BUFFER_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Fixed-capacity history: push_back() overwrites the oldest element once the
+// buffer is full, so memory never grows after reset(). Elements are indexed
+// oldest first, [size() - 1] is the newest, like the std::vector it replaces.
+template <typename T>
+class RingBuffer {
+public:
+    explicit RingBuffer(std::size_t capacity = 0) { reset(capacity); }
+
+    // Resizes the storage and drops all elements
+    void reset(std::size_t capacity) {
+        buf.assign(capacity, T());
+        start = 0;
+        count = 0;
+    }
+
+    void clear() {
+        start = 0;
+        count = 0;
+    }
+
+    void push_back(const T& value) {
+        if (buf.empty()) {
+            return;
+        }
+        if (count < buf.size()) {
+            buf[wrap(start + count)] = value;
+            ++count;
+        } else {
+            buf[start] = value;
+            start = wrap(start + 1);
+        }
+    }
+
+    const T& operator[](std::size_t i) const { return buf[wrap(start + i)]; }
+    T& operator[](std::size_t i) { return buf[wrap(start + i)]; }
+
+    const T& back() const { return (*this)[count - 1]; }
+    // i-th element counted from the newest, from_back(0) == back()
+    const T& from_back(std::size_t i) const { return (*this)[count - 1 - i]; }
+
+    std::size_t size() const { return count; }
+    std::size_t capacity() const { return buf.size(); }
+    bool empty() const { return count == 0; }
+    bool full() const { return count == buf.size(); }
+
+private:
+    // Indices passed in are always < 2 * capacity
+    std::size_t wrap(std::size_t i) const { return i >= buf.size() ? i - buf.size() : i; }
+
+    std::vector<T> buf;
+    std::size_t start;
+    std::size_t count;
+};
+
+#endif // RING_BUFFER_HPP
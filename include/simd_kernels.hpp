@@ -0,0 +1,74 @@
+#ifndef SIMD_KERNELS_HPP
+#define SIMD_KERNELS_HPP
+
+#include "matrix_utils.hpp"
+#include "quantized_matrix.hpp"
+
+// Kernel backend is picked at build time from the target flags:
+// NEON (armv7 with -mfpu=neon*, armv8), AVX2+FMA, SSE2, otherwise scalar.
+// Define ADAPAD_SCALAR_KERNELS (make SCALAR_KERNELS=1) to force the reference path.
+#if !defined(ADAPAD_SCALAR_KERNELS)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ADAPAD_KERNELS_NEON 1
+#elif defined(__AVX2__) && defined(__FMA__)
+#define ADAPAD_KERNELS_AVX2 1
+#elif defined(__SSE2__)
+#define ADAPAD_KERNELS_SSE 1
+#endif
+#endif
+
+// Name of the compiled-in backend ("neon", "avx2", "sse", "scalar")
+const char* simd_backend_name();
+
+// y[r] += dot(w.row(r), x) for every row of w.
+// With the stacked [i,f,g,o] LSTM weights this computes all four gate
+// pre-activations in one pass.
+void gemv_accumulate(const Matrix& w, const float* x, float* y);
+
+// Batched gemv: y[b*ldy + r] += dot(w.row(r), x + b*ldx) for b < batch, i.e.
+// Y += X W^T with one input/output vector per row of X/Y.
+void gemm_accumulate(const Matrix& w, const float* x, size_t ldx, size_t batch,
+                     float* y, size_t ldy);
+
+// gemv_accumulate with the column count fixed at compile time, so the dot
+// products unroll completely; bit-identical to gemv_accumulate on every
+// backend (the Makefile builds with -ffp-contract=off, so unrolling cannot
+// change which multiply-adds the compiler fuses). Instantiated
+// for the column counts in ADAPAD_FIXED_GEMV_COLS (the input and hidden sizes
+// of the shapes in fixed_lstm.hpp); w.cols() must equal Cols.
+#define ADAPAD_FIXED_GEMV_COLS(X) X(3) X(100)
+
+template <size_t Cols>
+void gemv_accumulate_fixed(const Matrix& w, const float* x, float* y);
+
+// Grouped gemv over matrices of one shape packed into one buffer (rows
+// padded to Matrix::padded_stride(cols), matrix s at w + s * w_step): for
+// k < count, y + k * ldy += W(slots[k]) * (x + k * ldx). Each product is
+// bit-identical to gemv_accumulate on that matrix; the point is one pass over
+// a contiguous buffer instead of a separate call per model.
+void gemv_accumulate_grouped(const float* w, size_t rows, size_t cols, size_t w_step,
+                             const size_t* slots, size_t count,
+                             const float* x, size_t ldx, float* y, size_t ldy);
+
+// y[r] += w.scale(r) * dot(w.row(r), x): int8 weights widened to float and
+// accumulated in fp32, so only the weight storage and loads shrink
+void gemv_accumulate_q8(const QuantizedMatrix& w, const float* x, float* y);
+
+// a[r][c] += x[r] * y[c] (rank-1 update, used for weight gradients in BPTT)
+void ger_accumulate(Matrix& a, const float* x, const float* y);
+
+// y[c] += sum_r w[r][c] * x[r] (W^T x, used to propagate gate deltas backwards)
+void gemv_transposed_accumulate(const Matrix& w, const float* x, float* y);
+
+// Scalar reference implementations
+void gemv_accumulate_scalar(const Matrix& w, const float* x, float* y);
+void gemm_accumulate_scalar(const Matrix& w, const float* x, size_t ldx, size_t batch,
+                            float* y, size_t ldy);
+void gemv_accumulate_grouped_scalar(const float* w, size_t rows, size_t cols, size_t w_step,
+                                    const size_t* slots, size_t count,
+                                    const float* x, size_t ldx, float* y, size_t ldy);
+void gemv_accumulate_q8_scalar(const QuantizedMatrix& w, const float* x, float* y);
+void ger_accumulate_scalar(Matrix& a, const float* x, const float* y);
+void gemv_transposed_accumulate_scalar(const Matrix& w, const float* x, float* y);
+
+#endif // SIMD_KERNELS_HPP
@@ -0,0 +1,104 @@
+#ifndef STAGE_STATS_HPP
+#define STAGE_STATS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Latency counters for the stages of AdapAD::is_anomalous. Recording is a
+// clock read and a few integer adds, cheap enough to stay on all the time;
+// main.cpp merges the per-model counters and exports them when
+// logging.stats_interval is set.
+//
+// Histograms use 4 buckets per power of two of nanoseconds, so reported
+// percentiles are within 25% of the true value (they are the bucket's upper
+// edge, capped at the largest sample).
+class StageStats {
+public:
+    enum Stage {
+        Normalize,        // scaling and pushing the sample into the history
+        Predict,          // building the window and the data predictor forward pass
+        Generate,         // threshold generator forward pass
+        PredictorUpdate,  // online update of the data predictor
+        GeneratorUpdate,  // online update of the threshold generator
+        Logging,          // queueing the result record
+        Checkpoint,       // snapshotting the models for the background saver
+        NUM_STAGES
+    };
+
+    static const int NUM_BUCKETS = 160;
+
+    struct Histogram {
+        uint64_t count = 0;
+        uint64_t total_ns = 0;
+        uint64_t max_ns = 0;
+        uint64_t buckets[NUM_BUCKETS] = {};
+
+        void record(uint64_t ns);
+        void merge(const Histogram& other);
+        double mean_ns() const { return count ? static_cast<double>(total_ns) / count : 0.0; }
+        // p in [0, 100]; 0 when empty
+        uint64_t percentile_ns(double p) const;
+    };
+
+    // Times consecutive stages with one clock read per boundary: each mark()
+    // charges the time since the previous mark (or construction) to a stage
+    class Lap {
+    public:
+        explicit Lap(StageStats& stats) : stats(stats), last(std::chrono::steady_clock::now()) {}
+        void mark(Stage stage) {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            stats.record(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count());
+            last = now;
+        }
+        // Starts the next stage here without charging the time so far
+        void skip() { last = std::chrono::steady_clock::now(); }
+        // Stops the clock, e.g. while the caller runs other models; resume()
+        // continues the current stage, charging it extra_ns for work done outside
+        void pause() { paused = std::chrono::steady_clock::now() - last; }
+        void resume(uint64_t extra_ns = 0) {
+            last = std::chrono::steady_clock::now() - paused - std::chrono::nanoseconds(extra_ns);
+        }
+
+    private:
+        StageStats& stats;
+        std::chrono::steady_clock::time_point last;
+        std::chrono::steady_clock::duration paused = std::chrono::steady_clock::duration::zero();
+    };
+
+    void record(Stage stage, uint64_t ns) { stages[stage].record(ns); }
+    // Epochs an online update actually ran before early stopping
+    void add_epochs(Stage stage, int epochs) { epoch_counts[stage] += epochs; }
+    void count_sample(bool anomalous) {
+        ++samples;
+        if (anomalous) ++anomalies;
+    }
+
+    const Histogram& stage(Stage s) const { return stages[s]; }
+    uint64_t epochs(Stage s) const { return epoch_counts[s]; }
+    uint64_t sample_count() const { return samples; }
+    uint64_t anomaly_count() const { return anomalies; }
+
+    void merge(const StageStats& other);
+    void reset() { *this = StageStats(); }
+
+    static const char* stage_name(Stage stage);
+
+    // One line: sample counts, then mean/p50/p99/max per stage in
+    // microseconds, and mean epochs per update for the two update stages
+    std::string summary_line() const;
+
+    // Prometheus text format (summaries in seconds plus counters), written to
+    // a temp file and renamed over path so readers never see a partial file.
+    // Throws std::runtime_error if the file cannot be written.
+    void write_metrics(const std::string& path) const;
+
+private:
+    Histogram stages[NUM_STAGES];
+    uint64_t epoch_counts[NUM_STAGES] = {};
+    uint64_t samples = 0;
+    uint64_t anomalies = 0;
+};
+
+#endif // STAGE_STATS_HPP
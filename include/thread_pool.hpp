@@ -0,0 +1,48 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cstddef>
+
+// Fixed-size pool for running independent per-sensor jobs of one timestep.
+// parallel_for() hands out indices dynamically (an idle thread grabs the next
+// unclaimed sensor), and returns only when every index has finished, so each
+// call acts as a barrier between timesteps. The calling thread takes part in
+// the work, so a pool of size 1 runs everything inline with no worker threads.
+class ThreadPool {
+public:
+    // num_threads == 0 uses all hardware threads. With pin_threads the caller
+    // is pinned to core 0 and worker k to core k (Linux only, ignored elsewhere).
+    explicit ThreadPool(size_t num_threads, bool pin_threads = false);
+    ~ThreadPool();
+
+    void parallel_for(size_t count, const std::function<void(size_t)>& task);
+
+    size_t size() const { return workers.size() + 1; }
+
+private:
+    void worker_loop(size_t worker_index);
+    void run_tasks();
+    static void pin_current_thread(size_t core);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+
+    // State of the current parallel_for call
+    const std::function<void(size_t)>* current_task;
+    size_t task_count;
+    std::atomic<size_t> next_index;
+    size_t active_workers;
+    size_t generation;
+    bool stopping;
+    bool pin_threads;
+};
+
+#endif // THREAD_POOL_HPP
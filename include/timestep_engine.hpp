@@ -0,0 +1,108 @@
+#ifndef TIMESTEP_ENGINE_HPP
+#define TIMESTEP_ENGINE_HPP
+
+#include "lstm_predictor.hpp"
+#include "thread_pool.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class AdapAD;
+
+// Forward passes of many models for one timestep. Models tied to one backbone
+// (LSTMPredictor::share_backbone) form a group that runs as one batched pass,
+// a GEMM per layer and step over the whole group (infer_tied).
+//
+// Models with their own weights keep them packed in one buffer owned here
+// (LSTMPredictor::pack_weights): the first run copies them in once, and from
+// then on training updates them in place there. They run in a few chunks, one
+// per pool thread, each a grouped GEMV per layer and step (infer_packed). A
+// model whose weights were set or loaded since is packed again on the next
+// run. Models of another shape than the first one, or with int8 inference,
+// run their own infer().
+class BatchedInference {
+public:
+    // out[i] = models[i]'s first output for the seq_len * input_size values at
+    // x + i * stride, for every i with active[i] (all if active is null).
+    // model_ns[i] receives the time of i's group divided by its size.
+    void run(const std::vector<LSTMPredictor*>& models, const float* x, size_t stride, size_t seq_len,
+             const std::vector<char>* active, float* out, uint64_t* model_ns, ThreadPool& pool);
+
+    // Groups formed by the last run()
+    size_t group_count() const { return used_groups; }
+    // Models whose weights are in the packed buffer
+    size_t packed_count() const { return packed_models.size(); }
+    // How many times the packed buffer was built
+    size_t packs_built() const { return packs; }
+
+private:
+    struct Group {
+        bool packed = false;
+        std::vector<size_t> members;
+        std::vector<LSTMPredictor*> models;
+        std::vector<size_t> slots;       // packed groups: the members' blocks
+        std::vector<float> x;
+        std::vector<float> out;
+    };
+    // Kept across runs so their buffers are reused; the first used_groups are live
+    std::vector<Group> groups;
+    std::vector<const void*> group_ids;
+    size_t used_groups = 0;
+
+    // The packed weights, block packed_slot[i] holding models[i]'s (NOT_PACKED if not)
+    static const size_t NOT_PACKED = static_cast<size_t>(-1);
+    std::shared_ptr<AlignedVector> packed_weights;
+    std::vector<LSTMPredictor*> packed_models;
+    std::vector<size_t> packed_slot;
+    std::vector<LSTMPredictor*> candidates;
+    std::vector<size_t> packed_members;
+    size_t packs = 0;
+
+    void pack(const std::vector<LSTMPredictor*>& models);
+    void regroup(const std::vector<LSTMPredictor*>& models, const std::vector<char>* active,
+                 size_t packed_chunks);
+    Group& new_group();
+};
+
+// Runs one timestep of a set of AdapAD models stage by stage: begin_sample on
+// the pool, the predictor forward passes of all models batched, end_prediction
+// on the pool, the generator forward passes batched, then finish_sample on the
+// pool. Same results as is_anomalous() per model.
+class TimestepEngine {
+public:
+    // Runs one stage of one model; the caller may wrap it, e.g. to time it
+    typedef std::function<void(size_t model, const std::function<void()>& stage)> StageRunner;
+
+    explicit TimestepEngine(const std::vector<AdapAD*>& models);
+
+    // values[i] is the new observation of models[i]. A model that throws sits
+    // out the rest of the step; error(i) then holds the message.
+    void step(const std::vector<float>& values, ThreadPool& pool, const StageRunner& run_stage);
+
+    bool is_anomalous(size_t model) const { return anomalous[model] != 0; }
+    const std::string& error(size_t model) const { return errors[model]; }
+    // Wall time of the two batched forward passes of the last step
+    double batched_seconds() const { return batched_time; }
+
+private:
+    std::vector<AdapAD*> models;
+    std::vector<LSTMPredictor*> predictors;
+    std::vector<LSTMPredictor*> generators;
+    BatchedInference predictor_pass;
+    BatchedInference generator_pass;
+    size_t lookback_len;
+
+    std::vector<float> windows;         // [model][lookback_len] forward pass inputs
+    std::vector<float> outputs;         // [model] raw forward pass outputs
+    std::vector<uint64_t> forward_ns;   // [model] forward pass time charged to the model
+    // Flags written from the pool threads, one char per model (not vector<bool>)
+    std::vector<char> active;           // still in the step
+    std::vector<char> needs_threshold;  // active and waiting for a threshold
+    std::vector<char> anomalous;
+    std::vector<std::string> errors;
+    double batched_time;
+};
+
+#endif // TIMESTEP_ENGINE_HPP
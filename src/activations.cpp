@@ -0,0 +1,281 @@
+#include "activations.hpp"
+#include "simd_kernels.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+#if defined(ADAPAD_KERNELS_NEON)
+#include <arm_neon.h>
+#elif defined(ADAPAD_KERNELS_AVX2)
+#include <immintrin.h>
+#elif defined(ADAPAD_KERNELS_SSE)
+#include <emmintrin.h>
+#endif
+
+Activation parse_activation(const std::string& name) {
+    if (name == "exact") return Activation::Exact;
+    if (name == "fast") return Activation::Fast;
+    throw std::runtime_error("Unknown activation '" + name + "' (expected exact or fast)");
+}
+
+const char* activation_name(Activation kind) {
+    return kind == Activation::Fast ? "fast" : "exact";
+}
+
+// Cephes expf/tanhf constants. The exp argument is clamped to [-87, 88] so
+// 2^n stays a normal float.
+static const float EXP_HI = 88.0f;
+static const float EXP_LO = -87.0f;
+static const float LOG2E = 1.44269504088896341f;
+static const float LN2_HI = 0.693359375f;
+static const float LN2_LO = -2.12194440e-4f;
+static const float EXP_P0 = 1.9875691500e-4f;
+static const float EXP_P1 = 1.3981999507e-3f;
+static const float EXP_P2 = 8.3334519073e-3f;
+static const float EXP_P3 = 4.1665795894e-2f;
+static const float EXP_P4 = 1.6666665459e-1f;
+static const float EXP_P5 = 5.0000001201e-1f;
+static const float TANH_SMALL = 0.625f;
+static const float TANH_P0 = -5.70498872745e-3f;
+static const float TANH_P1 = 2.06390887954e-2f;
+static const float TANH_P2 = -5.37397155531e-2f;
+static const float TANH_P3 = 1.33314422036e-1f;
+static const float TANH_P4 = -3.33332819422e-1f;
+
+static inline float exp_fast(float x) {
+    x = std::min(std::max(x, EXP_LO), EXP_HI);
+    float fx = std::floor(x * LOG2E + 0.5f);
+    float r = x - fx * LN2_HI - fx * LN2_LO;
+    float y = EXP_P0;
+    y = y * r + EXP_P1;
+    y = y * r + EXP_P2;
+    y = y * r + EXP_P3;
+    y = y * r + EXP_P4;
+    y = y * r + EXP_P5;
+    y = y * r * r + r + 1.0f;
+    int32_t bits = (static_cast<int32_t>(fx) + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return y * scale;
+}
+
+static inline float sigmoid_fast(float x) {
+    return 1.0f / (1.0f + exp_fast(-x));
+}
+
+static inline float tanh_fast(float x) {
+    float ax = std::fabs(x);
+    if (ax < TANH_SMALL) {
+        float z = x * x;
+        float y = TANH_P0;
+        y = y * z + TANH_P1;
+        y = y * z + TANH_P2;
+        y = y * z + TANH_P3;
+        y = y * z + TANH_P4;
+        return y * z * x + x;
+    }
+    float t = 1.0f - 2.0f / (exp_fast(2.0f * ax) + 1.0f);
+    return std::copysign(t, x);
+}
+
+#if defined(ADAPAD_KERNELS_NEON)
+
+static const size_t BLOCK = 4;
+
+static inline float32x4_t div_ps(float32x4_t a, float32x4_t b) {
+#if defined(__aarch64__)
+    return vdivq_f32(a, b);
+#else
+    // Reciprocal estimate refined by two Newton-Raphson steps
+    float32x4_t r = vrecpeq_f32(b);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    return vmulq_f32(a, r);
+#endif
+}
+
+static inline float32x4_t exp_ps(float32x4_t x) {
+    x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(EXP_LO)), vdupq_n_f32(EXP_HI));
+    float32x4_t fx = vmlaq_f32(vdupq_n_f32(0.5f), x, vdupq_n_f32(LOG2E));
+    // floor: truncate, then step down where truncation rounded up
+    float32x4_t t = vcvtq_f32_s32(vcvtq_s32_f32(fx));
+    uint32x4_t gt = vcgtq_f32(t, fx);
+    fx = vsubq_f32(t, vreinterpretq_f32_u32(vandq_u32(gt, vreinterpretq_u32_f32(vdupq_n_f32(1.0f)))));
+    float32x4_t r = vmlsq_f32(x, fx, vdupq_n_f32(LN2_HI));
+    r = vmlsq_f32(r, fx, vdupq_n_f32(LN2_LO));
+    float32x4_t y = vdupq_n_f32(EXP_P0);
+    y = vmlaq_f32(vdupq_n_f32(EXP_P1), y, r);
+    y = vmlaq_f32(vdupq_n_f32(EXP_P2), y, r);
+    y = vmlaq_f32(vdupq_n_f32(EXP_P3), y, r);
+    y = vmlaq_f32(vdupq_n_f32(EXP_P4), y, r);
+    y = vmlaq_f32(vdupq_n_f32(EXP_P5), y, r);
+    y = vmlaq_f32(vaddq_f32(r, vdupq_n_f32(1.0f)), y, vmulq_f32(r, r));
+    int32x4_t n = vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(fx), vdupq_n_s32(127)), 23);
+    return vmulq_f32(y, vreinterpretq_f32_s32(n));
+}
+
+static inline void sigmoid_block(const float* in, float* out) {
+    float32x4_t e = exp_ps(vnegq_f32(vld1q_f32(in)));
+    vst1q_f32(out, div_ps(vdupq_n_f32(1.0f), vaddq_f32(vdupq_n_f32(1.0f), e)));
+}
+
+static inline void tanh_block(const float* in, float* out) {
+    float32x4_t x = vld1q_f32(in);
+    float32x4_t ax = vabsq_f32(x);
+    float32x4_t z = vmulq_f32(x, x);
+    float32x4_t y = vdupq_n_f32(TANH_P0);
+    y = vmlaq_f32(vdupq_n_f32(TANH_P1), y, z);
+    y = vmlaq_f32(vdupq_n_f32(TANH_P2), y, z);
+    y = vmlaq_f32(vdupq_n_f32(TANH_P3), y, z);
+    y = vmlaq_f32(vdupq_n_f32(TANH_P4), y, z);
+    float32x4_t small = vmlaq_f32(x, vmulq_f32(y, z), x);
+    float32x4_t e = exp_ps(vaddq_f32(ax, ax));
+    float32x4_t t = vsubq_f32(vdupq_n_f32(1.0f),
+                              div_ps(vdupq_n_f32(2.0f), vaddq_f32(e, vdupq_n_f32(1.0f))));
+    uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(x), vdupq_n_u32(0x80000000u));
+    float32x4_t large = vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(t), sign));
+    uint32x4_t use_small = vcltq_f32(ax, vdupq_n_f32(TANH_SMALL));
+    vst1q_f32(out, vbslq_f32(use_small, small, large));
+}
+
+#elif defined(ADAPAD_KERNELS_AVX2)
+
+static const size_t BLOCK = 8;
+
+static inline __m256 exp_ps(__m256 x) {
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(EXP_LO)), _mm256_set1_ps(EXP_HI));
+    __m256 fx = _mm256_floor_ps(_mm256_fmadd_ps(x, _mm256_set1_ps(LOG2E), _mm256_set1_ps(0.5f)));
+    __m256 r = _mm256_fnmadd_ps(fx, _mm256_set1_ps(LN2_HI), x);
+    r = _mm256_fnmadd_ps(fx, _mm256_set1_ps(LN2_LO), r);
+    __m256 y = _mm256_set1_ps(EXP_P0);
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(EXP_P1));
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(EXP_P2));
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(EXP_P3));
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(EXP_P4));
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(EXP_P5));
+    y = _mm256_fmadd_ps(y, _mm256_mul_ps(r, r), _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+    __m256i n = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(fx), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(y, _mm256_castsi256_ps(n));
+}
+
+static inline void sigmoid_block(const float* in, float* out) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 e = exp_ps(_mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(in)));
+    _mm256_storeu_ps(out, _mm256_div_ps(one, _mm256_add_ps(one, e)));
+}
+
+static inline void tanh_block(const float* in, float* out) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+    __m256 x = _mm256_loadu_ps(in);
+    __m256 ax = _mm256_andnot_ps(sign_mask, x);
+    __m256 z = _mm256_mul_ps(x, x);
+    __m256 y = _mm256_set1_ps(TANH_P0);
+    y = _mm256_fmadd_ps(y, z, _mm256_set1_ps(TANH_P1));
+    y = _mm256_fmadd_ps(y, z, _mm256_set1_ps(TANH_P2));
+    y = _mm256_fmadd_ps(y, z, _mm256_set1_ps(TANH_P3));
+    y = _mm256_fmadd_ps(y, z, _mm256_set1_ps(TANH_P4));
+    __m256 small = _mm256_fmadd_ps(_mm256_mul_ps(y, z), x, x);
+    __m256 e = exp_ps(_mm256_add_ps(ax, ax));
+    __m256 t = _mm256_sub_ps(one, _mm256_div_ps(_mm256_set1_ps(2.0f), _mm256_add_ps(e, one)));
+    __m256 large = _mm256_or_ps(t, _mm256_and_ps(sign_mask, x));
+    __m256 use_small = _mm256_cmp_ps(ax, _mm256_set1_ps(TANH_SMALL), _CMP_LT_OQ);
+    _mm256_storeu_ps(out, _mm256_blendv_ps(large, small, use_small));
+}
+
+#elif defined(ADAPAD_KERNELS_SSE)
+
+static const size_t BLOCK = 4;
+
+static inline __m128 exp_ps(__m128 x) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(EXP_LO)), _mm_set1_ps(EXP_HI));
+    __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(LOG2E)), _mm_set1_ps(0.5f));
+    // floor without SSE4.1: truncate, then step down where truncation rounded up
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+    fx = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, fx), one));
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(LN2_HI)));
+    r = _mm_sub_ps(r, _mm_mul_ps(fx, _mm_set1_ps(LN2_LO)));
+    __m128 y = _mm_set1_ps(EXP_P0);
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(EXP_P1));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(EXP_P2));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(EXP_P3));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(EXP_P4));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(EXP_P5));
+    y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, _mm_mul_ps(r, r)), r), one);
+    __m128i n = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(fx), _mm_set1_epi32(127)), 23);
+    return _mm_mul_ps(y, _mm_castsi128_ps(n));
+}
+
+static inline void sigmoid_block(const float* in, float* out) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 e = exp_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(in)));
+    _mm_storeu_ps(out, _mm_div_ps(one, _mm_add_ps(one, e)));
+}
+
+static inline void tanh_block(const float* in, float* out) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    __m128 x = _mm_loadu_ps(in);
+    __m128 ax = _mm_andnot_ps(sign_mask, x);
+    __m128 z = _mm_mul_ps(x, x);
+    __m128 y = _mm_set1_ps(TANH_P0);
+    y = _mm_add_ps(_mm_mul_ps(y, z), _mm_set1_ps(TANH_P1));
+    y = _mm_add_ps(_mm_mul_ps(y, z), _mm_set1_ps(TANH_P2));
+    y = _mm_add_ps(_mm_mul_ps(y, z), _mm_set1_ps(TANH_P3));
+    y = _mm_add_ps(_mm_mul_ps(y, z), _mm_set1_ps(TANH_P4));
+    __m128 small = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(y, z), x), x);
+    __m128 e = exp_ps(_mm_add_ps(ax, ax));
+    __m128 t = _mm_sub_ps(one, _mm_div_ps(_mm_set1_ps(2.0f), _mm_add_ps(e, one)));
+    __m128 large = _mm_or_ps(t, _mm_and_ps(sign_mask, x));
+    __m128 use_small = _mm_cmplt_ps(ax, _mm_set1_ps(TANH_SMALL));
+    _mm_storeu_ps(out, _mm_or_ps(_mm_and_ps(use_small, small), _mm_andnot_ps(use_small, large)));
+}
+
+#else
+
+static const size_t BLOCK = 1;
+
+static inline void sigmoid_block(const float* in, float* out) {
+    *out = sigmoid_fast(*in);
+}
+
+static inline void tanh_block(const float* in, float* out) {
+    *out = tanh_fast(*in);
+}
+
+#endif
+
+void apply_sigmoid(const float* in, float* out, std::size_t n, Activation kind) {
+    if (kind == Activation::Exact) {
+        for (std::size_t i = 0; i < n; ++i) {
+            out[i] = 1.0f / (1.0f + std::exp(-in[i]));
+        }
+        return;
+    }
+    std::size_t i = 0;
+    for (; i + BLOCK <= n; i += BLOCK) {
+        sigmoid_block(in + i, out + i);
+    }
+    for (; i < n; ++i) {
+        out[i] = sigmoid_fast(in[i]);
+    }
+}
+
+void apply_tanh(const float* in, float* out, std::size_t n, Activation kind) {
+    if (kind == Activation::Exact) {
+        for (std::size_t i = 0; i < n; ++i) {
+            out[i] = std::tanh(in[i]);
+        }
+        return;
+    }
+    std::size_t i = 0;
+    for (; i + BLOCK <= n; i += BLOCK) {
+        tanh_block(in + i, out + i);
+    }
+    for (; i < n; ++i) {
+        out[i] = tanh_fast(in[i]);
+    }
+}
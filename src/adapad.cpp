@@ -2,15 +2,58 @@
 #include "matrix_utils.hpp"
 #include "normal_data_prediction_error_calculator.hpp"
 #include "config.hpp"
+#include "checkpoint.hpp"
+#include "checkpoint_saver.hpp"
 #include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <chrono>
+#include <ctime>
 #include <fstream>
 #include <sys/stat.h>
 #include <dirent.h>
 #include <unistd.h>
 
+// One writer thread for the result logs of every parameter
+static ResultLogger& result_logger() {
+    const Config& config = Config::getInstance();
+    static ResultLogger logger(config.log_flush_interval_ms, config.log_buffer_records);
+    return logger;
+}
+
+// One background thread writes the model checkpoints of every parameter
+static CheckpointSaver& checkpoint_saver() {
+    static CheckpointSaver saver;
+    return saver;
+}
+
+// Removes the parameter's saves other than keep_file, along with temp files
+// left behind by an interrupted write. Runs once keep_file is in place.
+static void remove_older_saves(const std::string& save_path, const std::string& parameter_name,
+                               const std::string& keep_file) {
+    DIR* dir = opendir(save_path.c_str());
+    if (dir == nullptr) {
+        return;
+    }
+    const std::string prefix = parameter_name + "_model_";
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        std::string filename = entry->d_name;
+        std::string name = filename;
+        if (!name.empty() && name[0] == '.') {
+            name = name.substr(1);
+        }
+        if (name.find(prefix) != 0 || name.find(".bin") == std::string::npos || filename == keep_file) {
+            continue;
+        }
+        std::string old_file = save_path + "/" + filename;
+        if (remove(old_file.c_str()) != 0) {
+            std::cerr << "Warning: Could not remove old model file: " << old_file << std::endl;
+        }
+    }
+    closedir(dir);
+}
+
 AdapAD::AdapAD(const PredictorConfig& predictor_config,
                const ValueRangeConfig& value_range_config,
                float minimal_threshold,
@@ -18,10 +61,21 @@ AdapAD::AdapAD(const PredictorConfig& predictor_config,
     : value_range_config(value_range_config),
       predictor_config(predictor_config),
       minimal_threshold(minimal_threshold),
+      lap(stage_stats),
       parameter_name(parameter_name),
       config(Config::getInstance()),
       update_count(0) {
     
+    // History sizes: prepare_data_for_prediction needs lookback_len + 1
+    // observations, is_default_normal the last train_size
+    const size_t lookback = predictor_config.lookback_len;
+    observed_vals.reset(std::max<size_t>(predictor_config.train_size, lookback + 1));
+    predicted_vals.reset(lookback);
+    predictive_errors.reset(lookback);
+    thresholds.reset(lookback);
+    anomalies.reset(predictor_config.train_size);
+    clear_observed();
+    
     // Initialize AdapAD components
     data_predictor.reset(new NormalDataPredictor(
         config.LSTM_size_layer,
@@ -37,6 +91,19 @@ AdapAD::AdapAD(const PredictorConfig& predictor_config,
         predictor_config.prediction_len
     ));
     
+    data_predictor->set_activation(config.activation);
+    generator->set_activation(config.activation);
+    data_predictor->set_inference_precision(config.inference_precision);
+    generator->set_inference_precision(config.inference_precision);
+    data_predictor->set_optimizer(config.optimizer);
+    generator->set_optimizer(config.optimizer);
+    
+    // Inference workspaces: (batch=1, seq=1, lookback_len) input window and
+    // the error window fed to the generator, sized once and reused per sample
+    input_window.assign(1, std::vector<std::vector<float>>(
+        1, std::vector<float>(predictor_config.lookback_len, 0.0f)));
+    past_errors_window.assign(predictor_config.lookback_len, 0.0f);
+    
     // Create parameter-specific log file name
     f_name = config.log_file_path + "/" + parameter_name + "_log.csv";
     
@@ -44,28 +111,59 @@ AdapAD::AdapAD(const PredictorConfig& predictor_config,
     mkdir(config.log_file_path.c_str(), 0777);
     
     // Initialize logging with the parameter-specific filename
-    f_log.open(f_name);
-    f_log << "observed,predicted,low,high,anomalous,err,threshold\n";
-    f_log.close();
+    f_log = result_logger().open(f_name, "observed,predicted,low,high,anomalous,err,threshold");
 
     // Create save directory if it doesn't exist
     mkdir(config.save_path.c_str(), 0777);  // UNIX-style directory creation
 }
 
+AdapAD::~AdapAD() {
+    result_logger().close(f_log);
+}
+
 void AdapAD::set_training_data(const std::vector<float>& data) {
-    observed_vals.clear();
+    training_vals.clear();
+    clear_observed();
     for (float val : data) {
         float normalized = normalize_data(val);
-        observed_vals.push_back(normalized);
+        training_vals.push_back(normalized);
+        push_observed(normalized);
     }
 }
 
 bool AdapAD::is_anomalous(float observed_val) {
+    const auto& past_observations = begin_sample(observed_val);
+    
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    data_predictor->eval();  // Set to eval mode for prediction
+    float predicted_val = data_predictor->predict(past_observations);
+    data_predictor->train(); // Switch back to training mode for online learning
+    const std::vector<float>* past_errors = end_prediction(predicted_val, elapsed_ns(start));
+    
+    float threshold = minimal_threshold;
+    uint64_t generate_ns = 0;
+    if (past_errors) {
+        start = std::chrono::steady_clock::now();
+        threshold = generator->generate(*past_errors, minimal_threshold);
+        generate_ns = elapsed_ns(start);
+    }
+    return finish_sample(threshold, generate_ns);
+}
+
+uint64_t AdapAD::elapsed_ns(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+const std::vector<std::vector<std::vector<float>>>& AdapAD::begin_sample(float observed_val) {
+    lap.skip();
     
-    bool is_anomalous_ret = false;
-    float normalized = normalize_data(observed_val);
+    pending.observed = observed_val;
+    pending.normalized = normalize_data(observed_val);
+    pending.needs_threshold = false;
     
-    observed_vals.push_back(normalized);
+    push_observed(pending.normalized);
+    lap.mark(StageStats::Normalize);
 
     try {
         // Validate vector sizes before operations
@@ -74,72 +172,89 @@ bool AdapAD::is_anomalous(float observed_val) {
         }
 
         // Validate past_observations dimensions
-        auto past_observations = prepare_data_for_prediction(observed_vals.size());
+        const auto& past_observations = prepare_data_for_prediction(observed_count);
         if (past_observations.empty() || past_observations[0].empty() || 
             past_observations[0][0].size() != predictor_config.lookback_len) {
             throw std::runtime_error("Invalid past_observations dimensions");
         }
-
-        //reset_model_states();
-
-        // Make prediction
-        data_predictor->eval();  // Set to eval mode for prediction
-        auto predicted_val = data_predictor->predict(past_observations);
-        data_predictor->train(); // Switch back to training mode for online learning
+        lap.pause();
+        return past_observations;
         
-        // Validate vector sizes before push_back
-        if (predicted_vals.size() >= predictor_config.lookback_len * 2) {
-            predicted_vals.erase(predicted_vals.begin());
+    } catch (const std::exception& e) {
+        std::cerr << "Error in is_anomalous: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+const std::vector<float>* AdapAD::end_prediction(float predicted_val, uint64_t predict_ns) {
+    lap.resume(predict_ns);
+    
+    pending.predicted = predicted_val;
+    predicted_vals.push_back(predicted_val);
+    
+    // Calculate error in normalized space to match thresholds
+    pending.error = NormalDataPredictionErrorCalculator::calc_error(
+        predicted_val, pending.normalized);  
+    
+    predictive_errors.push_back(pending.error);
+    lap.mark(StageStats::Predict);
+    
+    // Thresholds are only generated for in-range values with a full error window
+    if (is_inside_range(pending.normalized) &&
+        static_cast<int>(predictive_errors.size()) >= predictor_config.lookback_len) {
+        std::vector<float>& past_errors = past_errors_window;
+        const size_t first = predictive_errors.size() - predictor_config.lookback_len;
+        for (int i = 0; i < predictor_config.lookback_len; ++i) {
+            past_errors[i] = predictive_errors[first + i];
         }
-        predicted_vals.push_back(predicted_val);
-        
-        // Calculate error in normalized space to match thresholds
-        float prediction_error = NormalDataPredictionErrorCalculator::calc_error(
-            predicted_val, normalized);  
-        
-        predictive_errors.push_back(prediction_error);
-        
+        pending.needs_threshold = true;
+    }
+    lap.pause();
+    return pending.needs_threshold ? &past_errors_window : nullptr;
+}
+
+bool AdapAD::finish_sample(float threshold, uint64_t generate_ns) {
+    lap.resume(generate_ns);
+    bool is_anomalous_ret = false;
+
+    try {
         // Check range first
-        if (!is_inside_range(normalized)) {
+        if (!is_inside_range(pending.normalized)) {
             is_anomalous_ret = true;
-            anomalies.push_back(observed_vals.size());
+            anomalies.push_back(observed_count);
         } else {
             // Only process thresholds and errors for in-range values
-            float threshold = minimal_threshold;
-            
-            if (static_cast<int>(predictive_errors.size()) >= predictor_config.lookback_len) {
-                auto past_errors = std::vector<float>(
-                    predictive_errors.end() - predictor_config.lookback_len,
-                    predictive_errors.end());
-                
-                threshold = generator->generate(past_errors, minimal_threshold);
+            if (pending.needs_threshold) {
+                lap.mark(StageStats::Generate);
                 
-                if (prediction_error > threshold && !is_default_normal()) {
+                if (pending.error > threshold && !is_default_normal()) {
                     is_anomalous_ret = true;
-                    anomalies.push_back(observed_vals.size());
+                    anomalies.push_back(observed_count);
                 }
 
                 // Update models only for in-range values
-                data_predictor->update(predictor_config.epoch_update, predictor_config.lr_update,
-                                    past_observations, {normalized});
+                int epochs = data_predictor->update(predictor_config.epoch_update, predictor_config.lr_update,
+                                                    input_window, {pending.normalized});
+                stage_stats.add_epochs(StageStats::PredictorUpdate, epochs);
+                lap.mark(StageStats::PredictorUpdate);
                 
                 if (is_anomalous_ret || threshold > minimal_threshold) {
-                    update_generator(past_errors, prediction_error);
+                    epochs = update_generator(past_errors_window, pending.error);
+                    stage_stats.add_epochs(StageStats::GeneratorUpdate, epochs);
+                    lap.mark(StageStats::GeneratorUpdate);
                 }
+            } else {
+                threshold = minimal_threshold;
             }
             thresholds.push_back(threshold);
         }
         
         // Log results
-        f_log.open(f_name, std::ios_base::app);
-        f_log << observed_val << ","
-              << reverse_normalized_data(predicted_val) << ","
-              << reverse_normalized_data(predicted_val - (thresholds.empty() ? minimal_threshold : thresholds.back())) << ","
-              << reverse_normalized_data(predicted_val + (thresholds.empty() ? minimal_threshold : thresholds.back())) << ","
-              << (is_anomalous_ret ? "True" : "False") << ","
-              << (predictive_errors.empty() ? 0.0f : predictive_errors.back()) << ","
-              << (thresholds.empty() ? minimal_threshold : thresholds.back()) << "\n";
-        f_log.close();
+        log_result(pending.observed, pending.predicted,
+                   thresholds.empty() ? minimal_threshold : thresholds.back(),
+                   is_anomalous_ret,
+                   predictive_errors.empty() ? 0.0f : predictive_errors.back());
+        lap.mark(StageStats::Logging);
         
         // Check if we should save the model based on update count
         if (config.save_enabled && ++update_count >= config.save_interval) {
@@ -149,7 +264,9 @@ bool AdapAD::is_anomalous(float observed_val) {
             } catch (const std::exception& e) {
                 std::cerr << "Failed to save model state: " << e.what() << std::endl;
             }
+            lap.mark(StageStats::Checkpoint);
         }
+        stage_stats.count_sample(is_anomalous_ret);
         
     } catch (const std::exception& e) {
         std::cerr << "Error in is_anomalous: " << e.what() << std::endl;
@@ -159,68 +276,38 @@ bool AdapAD::is_anomalous(float observed_val) {
     return is_anomalous_ret;
 }
 
-void AdapAD::update_generator(
+int AdapAD::update_generator(
     const std::vector<float>& past_errors, float recent_error) {
-    
-    auto start_time = std::chrono::high_resolution_clock::now();
-    
     // Reshape past_errors to match PyTorch's reshape(1, -1)
     std::vector<std::vector<std::vector<float>>> reshaped_input(1);
     reshaped_input[0].resize(1);
     reshaped_input[0][0] = past_errors;
     
-    // Single forward pass before epoch loop
-    auto output = generator->forward(reshaped_input);
-    auto pred = generator->get_final_prediction(output);
-    
-    // Calculate initial loss
-    float initial_loss = 0.0f;
-    float diff = pred[0] - recent_error;
-    initial_loss = diff * diff;
-    
-    // Training loop with early stopping based on loss progression
-    float prev_loss = initial_loss;
-    int epochs_completed = 0;
-    for (int e = 0; e < predictor_config.epoch_update_generator; ++e) {
-        generator->train_step(reshaped_input, {recent_error}, output, predictor_config.lr_update_generator);
-        
-        // Calculate new loss after training step
-        output = generator->forward(reshaped_input);
-        pred = generator->get_final_prediction(output);
-        diff = pred[0] - recent_error;
-        float current_loss = diff * diff;
-        
-        if (e > 0 && current_loss > prev_loss) {
+    // Training loop with early stopping based on loss progression. Each
+    // step reports the loss before its update, i.e. the loss after the
+    // previous step's update; from the third step on, a loss above the one
+    // before stops the loop without updating again. The first two updates
+    // always happen.
+    float prev_loss = std::numeric_limits<float>::infinity();
+    int e = 0;
+    for (; e < predictor_config.epoch_update_generator; ++e) {
+        const float stop_above = e >= 2 ? prev_loss : std::numeric_limits<float>::infinity();
+        // Same tensors every epoch, only the first step checks their shapes
+        float current_loss = e == 0
+            ? generator->train_step(reshaped_input, {recent_error},
+                                    predictor_config.lr_update_generator, stop_above)
+            : generator->train_step_unchecked(reshaped_input, {recent_error},
+                                              predictor_config.lr_update_generator, stop_above);
+        if (current_loss > stop_above) {
             break;
         }
         prev_loss = current_loss;
-        epochs_completed++;
     }
-    
-    auto end_time = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = end_time - start_time;
-    
+    return e;
 }
 
 void AdapAD::clean() {
-    size_t window_size = predictor_config.lookback_len;
-    
-    // Use circular buffer approach instead of growing/shrinking
-    if (predicted_vals.size() > window_size) {
-        // Move elements to the beginning instead of reallocating
-        std::copy(predicted_vals.end() - window_size, predicted_vals.end(), predicted_vals.begin());
-        predicted_vals.resize(window_size);  // No shrink_to_fit needed
-        
-        if (!predictive_errors.empty()) {
-            std::copy(predictive_errors.end() - window_size, predictive_errors.end(), predictive_errors.begin());
-            predictive_errors.resize(window_size);
-        }
-        
-        if (!thresholds.empty()) {
-            std::copy(thresholds.end() - window_size, thresholds.end(), thresholds.begin());
-            thresholds.resize(window_size);
-        }
-    }
+    // Histories are fixed-size rings, the oldest entries drop out on push
 }
 
 float AdapAD::normalize_data(float val) {
@@ -233,122 +320,179 @@ float AdapAD::reverse_normalized_data(float val) {
            value_range_config.lower_bound;
 }
 
-bool AdapAD::is_inside_range(float val) {
-    float denormalized = reverse_normalized_data(val);
-    return denormalized >= value_range_config.lower_bound && 
-           denormalized <= value_range_config.upper_bound;
+// val is normalized, so the bounds are 0 and 1
+bool AdapAD::is_inside_range(float val) const {
+    return val >= 0.0f && val <= 1.0f;
 }
 
-bool AdapAD::is_default_normal() {
-    size_t window_size = std::min(predictor_config.train_size, 
-                                 (int)observed_vals.size());
-    auto recent_vals = std::vector<float>(
-        observed_vals.end() - window_size,
-        observed_vals.end()
-    );
-    
-    int cnt = 0;
-    for (float val : recent_vals) {
-        if (!is_inside_range(val)) {
-            cnt++;
-        }
+// Appends to observed_vals and keeps out_of_range_count in step with the
+// last train_size values, so is_default_normal never rescans the window
+void AdapAD::push_observed(float normalized) {
+    const size_t window = predictor_config.train_size;
+    if (window > 0 && observed_vals.size() >= window &&
+        !is_inside_range(observed_vals.from_back(window - 1))) {
+        out_of_range_count--;
     }
-    
-    return cnt > predictor_config.train_size / 2;
+    observed_vals.push_back(normalized);
+    if (!is_inside_range(normalized)) {
+        out_of_range_count++;
+    }
+    ++observed_count;
+}
+
+void AdapAD::clear_observed() {
+    observed_vals.clear();
+    observed_count = 0;
+    out_of_range_count = 0;
+}
+
+bool AdapAD::is_default_normal() {
+    return out_of_range_count > predictor_config.train_size / 2;
 }
 
 void AdapAD::logging(bool is_anomalous_ret) {
-    f_log.open(f_name, std::ios_base::app);
-    
-    float current_threshold = thresholds.back();
-    float current_predicted = predicted_vals.back();
-    float current_observed = observed_vals.back();
-    float current_error = predictive_errors.back();
-    
-    f_log << reverse_normalized_data(current_observed) << ","
-          << reverse_normalized_data(current_predicted) << ","
-          << reverse_normalized_data(current_predicted - current_threshold) << ","
-          << reverse_normalized_data(current_predicted + current_threshold) << ","
-          << (is_anomalous_ret ? "True" : "False") << ","
-          << current_error << ","
-          << current_threshold << "\n";
-    
-    f_log.close();
+    log_result(reverse_normalized_data(observed_vals.back()), predicted_vals.back(),
+               thresholds.back(), is_anomalous_ret, predictive_errors.back());
 }
 
-std::vector<std::vector<std::vector<float>>> 
+// observed is in sensor units, predicted/threshold/error in normalized space
+void AdapAD::log_result(float observed, float predicted, float threshold, bool anomalous, float error) {
+    ResultLogger::Record record;
+    record.kind = ResultLogger::Record::Result;
+    record.anomalous = anomalous;
+    record.observed = observed;
+    record.predicted = reverse_normalized_data(predicted);
+    record.low = reverse_normalized_data(predicted - threshold);
+    record.high = reverse_normalized_data(predicted + threshold);
+    record.error = error;
+    record.threshold = threshold;
+    result_logger().push(f_log, record);
+}
+
+const std::vector<std::vector<std::vector<float>>>& 
 AdapAD::prepare_data_for_prediction(size_t supposed_anomalous_pos) {
-    // Get lookback window 
-    std::vector<float> x_temp(
-        observed_vals.end() - predictor_config.lookback_len - 1,
-        observed_vals.end() - 1
-    );
+    // Tensor matching PyTorch's reshape(1, -1), filled in place
+    std::vector<float>& x_temp = input_window[0][0];
+    
+    // Get lookback window, the newest observation is the one being judged
+    const size_t first = observed_vals.size() - predictor_config.lookback_len - 1;
+    for (int i = 0; i < predictor_config.lookback_len; ++i) {
+        x_temp[i] = observed_vals[first + i];
+    }
     
     // Only try to use predicted values if we have them
     if (!predicted_vals.empty() && predicted_vals.size() >= predictor_config.lookback_len) {
-        // Get predicted values 
-        std::vector<float> predicted(
-            predicted_vals.end() - predictor_config.lookback_len,
-            predicted_vals.end()
-        );
-        
-        // Replace out-of-range values 
+        // Replace out-of-range values with the matching predicted values
         for (int i = 0; i < predictor_config.lookback_len; ++i) {
             if (!is_inside_range(x_temp[x_temp.size() - i - 1])) {
-                x_temp[x_temp.size() - i - 1] = predicted[predicted.size() - i - 1];
+                x_temp[x_temp.size() - i - 1] = predicted_vals.from_back(i);
             }
         }
     }
     
-    // Create tensor matching PyTorch's reshape(1, -1) 
-    std::vector<std::vector<std::vector<float>>> input_tensor(1);
-    input_tensor[0].resize(1);
-    input_tensor[0][0] = x_temp;
-    
-    return input_tensor;
+    return input_window;
 }
 
 void AdapAD::train() {
-    // Start timing
-    auto start_time = std::chrono::high_resolution_clock::now();
+    train_predictor();
+    train_generator();
+}
+
+void AdapAD::train_shared(const std::vector<AdapAD*>& group) {
+    if (group.empty()) {
+        return;
+    }
+    const Config& config = Config::getInstance();
+    AdapAD& owner = *group[0];
+    
+    // The first model's backbone learns from every series and becomes the
+    // group's; each model then fits its own heads on its own series
+    std::vector<std::vector<float>> series;
+    for (AdapAD* model : group) {
+        series.push_back(model->training_vals);
+    }
+    owner.data_predictor->train_backbone(config.epoch_train, config.lr_train, series, config.batch_size);
+    for (AdapAD* model : group) {
+        model->backbone_owner = owner.parameter_name;
+        model->data_predictor->share_backbone(*owner.data_predictor);
+        model->train_predictor();
+    }
     
+    // Same for the generator, on the training errors the step above left behind
+    series.clear();
+    for (AdapAD* model : group) {
+        series.push_back(model->training_errors);
+    }
+    owner.generator->train_backbone(config.epoch_train, config.lr_train, series, config.batch_size);
+    for (AdapAD* model : group) {
+        model->generator->share_backbone(*owner.generator);
+        model->train_generator();
+    }
+}
+
+void AdapAD::retie_shared(const std::vector<AdapAD*>& models) {
+    for (AdapAD* model : models) {
+        if (model->backbone_owner.empty() || model->backbone_owner == model->parameter_name) {
+            continue;
+        }
+        AdapAD* owner = nullptr;
+        for (AdapAD* candidate : models) {
+            if (candidate->parameter_name == model->backbone_owner &&
+                candidate->backbone_owner == candidate->parameter_name) {
+                owner = candidate;
+            }
+        }
+        if (owner == nullptr ||
+            !model->data_predictor->has_backbone_weights_of(*owner->data_predictor) ||
+            !model->generator->has_backbone_weights_of(*owner->generator)) {
+            std::cerr << "Cannot re-tie " << model->parameter_name << " to the backbone of "
+                      << model->backbone_owner << ", keeping its own weights" << std::endl;
+            model->backbone_owner.clear();
+            continue;
+        }
+        model->data_predictor->retie_backbone(*owner->data_predictor);
+        model->generator->retie_backbone(*owner->generator);
+    }
+}
+
+void AdapAD::train_predictor() {
     // Train data predictor and get training data
     std::pair<std::vector<std::vector<std::vector<float>>>, std::vector<float>> 
-        training_data = data_predictor->train(config.epoch_train, config.lr_train, observed_vals);
+        training_data = data_predictor->train(config.epoch_train, config.lr_train, training_vals, config.batch_size);
     auto& trainX = training_data.first;
     auto& trainY = training_data.second;
     
-    // Calculate and store predicted values for training data
-    predicted_vals.clear();
+    // Calculate predicted values for training data
+    std::vector<float> train_predicted;
     for (const auto& x : trainX) {
         std::vector<std::vector<std::vector<float>>> input_tensor(1);
         input_tensor[0].resize(1);
         input_tensor[0][0] = x[0];
         
         auto pred = data_predictor->predict(input_tensor);
-        predicted_vals.push_back(pred);
+        train_predicted.push_back(pred);
         
         // Log training predictions without thresholds
-        f_log.open(f_name, std::ios_base::app);
-        f_log << reverse_normalized_data(observed_vals[predicted_vals.size()-1]) << ","
-              << reverse_normalized_data(pred) << ",,,,," << "\n";
-        f_log.close();
+        ResultLogger::Record record = {};
+        record.kind = ResultLogger::Record::Training;
+        record.observed = reverse_normalized_data(training_vals[train_predicted.size()-1]);
+        record.predicted = reverse_normalized_data(pred);
+        result_logger().push(f_log, record);
     }
     
     // Calculate prediction errors for training data
-    predictive_errors.clear();
+    training_errors.clear();
     for (size_t i = 0; i < trainY.size(); i++) {
-        float error = std::abs(trainY[i] - predicted_vals[i]);
-        predictive_errors.push_back(error);
+        float error = std::abs(trainY[i] - train_predicted[i]);
+        training_errors.push_back(error);
     }
-    
+}
+
+void AdapAD::train_generator() {
     // Train generator
     //generator->reset_states();
-    generator->train(config.epoch_train, config.lr_train, predictive_errors);
-    
-    // End timing
-    auto end_time = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = end_time - start_time;
+    generator->train(config.epoch_train, config.lr_train, training_errors, config.batch_size);
+    std::vector<float>().swap(training_errors);
     
     // Save after initial training if enabled
     if (config.save_enabled) {
@@ -378,13 +522,14 @@ void AdapAD::train() {
     }
     
     // Keep only the most recent lookback_len values in observed_vals
-    if (observed_vals.size() > predictor_config.lookback_len) {
-        std::vector<float> recent_vals(
-            observed_vals.end() - predictor_config.lookback_len,
-            observed_vals.end()
-        );
-        observed_vals = std::move(recent_vals);  // Use move for efficiency
+    clear_observed();
+    size_t keep = std::min(training_vals.size(), (size_t)predictor_config.lookback_len);
+    for (size_t i = training_vals.size() - keep; i < training_vals.size(); ++i) {
+        push_observed(training_vals[i]);
     }
+    
+    // The training set is not needed online
+    std::vector<float>().swap(training_vals);
 }
 
 void AdapAD::learn_error_pattern(
@@ -392,28 +537,28 @@ void AdapAD::learn_error_pattern(
     const std::vector<float>& trainY) {
     
     // Calculate predictions
-    predicted_vals.clear();
+    std::vector<float> train_predicted;
     for (size_t i = 0; i < trainX.size(); i++) {
         auto reshaped_input = std::vector<std::vector<std::vector<float>>>(1);
         reshaped_input[0] = trainX[i];
         float pred = data_predictor->predict(reshaped_input);
-        predicted_vals.push_back(pred);
+        train_predicted.push_back(pred);
     }
 
     // Get tail of predicted values
     auto recent_predicted = std::vector<float>(
-        predicted_vals.end() - trainY.size(),
-        predicted_vals.end()
+        train_predicted.end() - trainY.size(),
+        train_predicted.end()
     );
     
     // Calculate errors
-    predictive_errors = NormalDataPredictionErrorCalculator::calc_error(
+    std::vector<float> train_errors = NormalDataPredictionErrorCalculator::calc_error(
         trainY, recent_predicted);
 
     // Train generator using batch learning approach
     std::pair<std::vector<std::vector<float>>, std::vector<float>> 
         batch_data = create_sliding_windows(
-            predictive_errors, 
+            train_errors, 
             predictor_config.lookback_len,
             predictor_config.prediction_len
         );
@@ -426,18 +571,17 @@ void AdapAD::learn_error_pattern(
             input[0].push_back(batch_x[i]);
             auto target = std::vector<float>{batch_y[i]};
             
-            // Add forward pass and pass output to train_step
-            auto output = generator->forward(input);
-            generator->train_step(input, target, output, config.lr_train);
+            generator->train_step_unchecked(input, target, config.lr_train);
         }
     }
 
     // Log results
     for (size_t i = 0; i < trainY.size(); i++) {
-        f_log.open(f_name, std::ios_base::app);
-        f_log << reverse_normalized_data(trainY[i]) << ","
-              << reverse_normalized_data(predicted_vals[i]) << ",,,,\n";
-        f_log.close();
+        ResultLogger::Record record = {};
+        record.kind = ResultLogger::Record::ErrorPattern;
+        record.observed = reverse_normalized_data(trainY[i]);
+        record.predicted = reverse_normalized_data(train_predicted[i]);
+        result_logger().push(f_log, record);
     }
 }
 
@@ -462,6 +606,10 @@ float AdapAD::simplify_error(const std::vector<float>& errors, float N_sigma) {
     return mean + N_sigma * std_dev;
 }
 
+void AdapAD::wait_for_saves() {
+    checkpoint_saver().wait_idle();
+}
+
 void AdapAD::save_models() {
     try {
         // Create directory if it doesn't exist
@@ -474,57 +622,34 @@ void AdapAD::save_models() {
         // Get current timestamp
         auto now = std::chrono::system_clock::now();
         auto time = std::chrono::system_clock::to_time_t(now);
+        std::tm local_tm;
+        localtime_r(&time, &local_tm);  // localtime() is not thread-safe
         std::stringstream timestamp;
-        timestamp << std::put_time(std::localtime(&time), "%Y%m%d_%H%M%S");
-        
-        // Remove previous model file for this parameter if it exists
-        DIR* dir = opendir(config.save_path.c_str());
-        if (dir != nullptr) {
-            struct dirent* entry;
-            while ((entry = readdir(dir)) != nullptr) {
-                std::string filename = entry->d_name;
-                // Check if file is a previous save for this parameter
-                if (filename.find(parameter_name + "_model_") == 0 && 
-                    filename.find(".bin") != std::string::npos) {
-                    std::string old_file = config.save_path + "/" + filename;
-                    if (remove(old_file.c_str()) != 0) {
-                        std::cerr << "Warning: Could not remove old model file: " << old_file << std::endl;
-                    } else {
-                        std::cout << "Updated model save file for parameter: " << parameter_name << std::endl;
-                    }
-                }
-            }
-            closedir(dir);
-        }
+        timestamp << std::put_time(&local_tm, "%Y%m%d_%H%M%S");
         
         // Create new file path with parameter name and timestamp
-        std::string save_file = config.save_path + "/" + 
-                               parameter_name + 
-                               "_model_" + 
-                               timestamp.str() + 
-                               ".bin";
+        std::string save_name = parameter_name + "_model_" + timestamp.str() + ".bin";
+        std::string save_file = config.save_path + "/" + save_name;
         
-        std::ofstream file(save_file, std::ios::binary);
-        if (!file.is_open()) {
-            throw std::runtime_error("Could not open file for writing: " + save_file);
+        CheckpointWriter ckpt;
+        const float meta[3] = {minimal_threshold, 
+                               value_range_config.lower_bound, 
+                               value_range_config.upper_bound};
+        ckpt.add_floats("adapad.meta", meta, 3);
+        if (!backbone_owner.empty()) {
+            ckpt.add_string("adapad.backbone_owner", backbone_owner);
         }
-
-        // Save metadata
-        file.write(reinterpret_cast<const char*>(&minimal_threshold), sizeof(float));
-        file.write(reinterpret_cast<const char*>(&value_range_config.lower_bound), sizeof(float));
-        file.write(reinterpret_cast<const char*>(&value_range_config.upper_bound), sizeof(float));
-
-        // Save layer cache states
-        data_predictor->save_layer_cache(file);
-        generator->save_layer_cache(file);
-
-        // Save predictor weights and biases directly to file
-        data_predictor->save_weights(file);
-        data_predictor->save_biases(file);
+        data_predictor->save_checkpoint(ckpt, "predictor.");
+        generator->save_checkpoint(ckpt, "generator.");
         
-        // Save generator weights and biases directly to file
-        generator->save_weights(file);
-        generator->save_biases(file);
+        // Only the copy above happens here; the previous save is removed once
+        // the new file has been renamed into place, so one always exists
+        std::string save_path = config.save_path;
+        std::string name = parameter_name;
+        checkpoint_saver().submit(parameter_name, std::move(ckpt), save_file,
+                                  [save_path, name, save_name]() {
+                                      remove_older_saves(save_path, name, save_name);
+                                  });
         
     } catch (const std::exception& e) {
         std::cerr << "Error saving model state: " << e.what() << std::endl;
@@ -554,60 +679,27 @@ void AdapAD::load_models(const std::string& timestamp, const std::vector<float>&
             throw std::runtime_error("Model file does not exist: " + load_file);
         }
 
-        std::ifstream file(load_file, std::ios::binary);
-        if (!file.is_open()) {
-            throw std::runtime_error("Could not open file for reading: " + load_file);
-        }
-
         try {
-            std::cout << "Loading metadata..." << std::endl;
-            // Load metadata first
-            float temp_minimal_threshold;
-            float temp_lower_bound;
-            float temp_upper_bound;
-            
-            file.read(reinterpret_cast<char*>(&temp_minimal_threshold), sizeof(float));
-            file.read(reinterpret_cast<char*>(&temp_lower_bound), sizeof(float));
-            file.read(reinterpret_cast<char*>(&temp_upper_bound), sizeof(float));
-
-            if (!file.good()) {
-                throw std::runtime_error("Failed to read metadata");
-            }
-
-            std::cout << "Updating configuration values..." << std::endl;
-            // Only update values after successful read
-            minimal_threshold = temp_minimal_threshold;
-            value_range_config.lower_bound = temp_lower_bound;
-            value_range_config.upper_bound = temp_upper_bound;
-
-            std::cout << "Initializing layer caches..." << std::endl;
-            // Initialize layer caches
-            data_predictor->initialize_layer_cache();
-            generator->initialize_layer_cache();
-
-            std::cout << "Loading layer cache states..." << std::endl;
-            // Load layer cache states
-            try {
-                data_predictor->load_layer_cache(file);
-            } catch (const std::exception& e) {
-                throw std::runtime_error("Failed to load data predictor cache: " + std::string(e.what()));
-            }
-
-            try {
-                generator->load_layer_cache(file);
-            } catch (const std::exception& e) {
-                throw std::runtime_error("Failed to load generator cache: " + std::string(e.what()));
-            }
-
-            std::cout << "Loading weights and biases..." << std::endl;
-            // Load weights and biases
-            try {
-                data_predictor->load_weights(file);
-                data_predictor->load_biases(file);
-                generator->load_weights(file);
-                generator->load_biases(file);
-            } catch (const std::exception& e) {
-                throw std::runtime_error("Failed to load weights/biases: " + std::string(e.what()));
+            bool outdated = true;
+            if (CheckpointReader::is_checkpoint(load_file)) {
+                // Validates every section checksum before anything is used
+                std::cout << "Loading checkpoint..." << std::endl;
+                CheckpointReader ckpt(load_file);
+                float meta[3];
+                ckpt.read_bytes("adapad.meta", meta, sizeof(meta));
+                std::string owner = ckpt.has("adapad.backbone_owner") 
+                    ? ckpt.read_string("adapad.backbone_owner") : std::string();
+                data_predictor->load_checkpoint(ckpt, "predictor.");
+                generator->load_checkpoint(ckpt, "generator.");
+                outdated = ckpt.version() < CHECKPOINT_VERSION;
+                
+                minimal_threshold = meta[0];
+                value_range_config.lower_bound = meta[1];
+                value_range_config.upper_bound = meta[2];
+                backbone_owner = owner;
+            } else {
+                load_legacy_model(load_file);
+                backbone_owner.clear();
             }
 
             std::cout << "Resetting model states..." << std::endl;
@@ -616,10 +708,10 @@ void AdapAD::load_models(const std::string& timestamp, const std::vector<float>&
             
             std::cout << "Initializing observed values..." << std::endl;
             // Initialize observed_vals with exactly lookback_len points
-            observed_vals.clear();
+            clear_observed();
             for (size_t i = 0; i < predictor_config.lookback_len; i++) {
                 float normalized = normalize_data(initial_data[i]);
-                observed_vals.push_back(normalized);
+                push_observed(normalized);
             }
             
             // Initialize other vectors
@@ -629,6 +721,14 @@ void AdapAD::load_models(const std::string& timestamp, const std::vector<float>&
             
             std::cout << "Successfully loaded model state for " << parameter_name << std::endl;
             
+            // Migrate older files (stream format or checkpoints that still carry
+            // the activation tape) by saving again, which replaces the old file
+            if (outdated && config.save_enabled) {
+                std::cout << "Rewriting " << load_file << " as checkpoint version " 
+                          << CHECKPOINT_VERSION << std::endl;
+                save_models();
+            }
+            
         } catch (const std::runtime_error& e) {
             throw std::runtime_error("Error during model loading: " + std::string(e.what()));
         }
@@ -639,12 +739,49 @@ void AdapAD::load_models(const std::string& timestamp, const std::vector<float>&
     }
 }
 
+// Files written before the checkpoint container: raw metadata floats followed
+// by the stream layouts of save_layer_cache/save_weights/save_biases. Such a
+// file has no magic, so anything that is not a checkpoint ends up here; it is
+// only taken as a legacy save if every size matches these models and the file
+// ends exactly after the last bias. Nothing is changed until all of it is read.
+void AdapAD::load_legacy_model(const std::string& load_file) {
+    std::cout << "Loading legacy model file..." << std::endl;
+    LegacyModelStream in(load_file);
+    LSTMPredictor::LegacyParameters predictor_params, generator_params;
+    float meta[3];
+    try {
+        in.read_floats(meta, 3);
+        if (!std::isfinite(meta[0]) || !std::isfinite(meta[1]) || !std::isfinite(meta[2]) ||
+            meta[0] < 0.0f || !(meta[1] < meta[2])) {
+            throw std::runtime_error("implausible metadata");
+        }
+        data_predictor->model().skip_legacy_layer_cache(in);
+        generator->model().skip_legacy_layer_cache(in);
+        predictor_params = data_predictor->model().read_legacy_parameters(in);
+        generator_params = generator->model().read_legacy_parameters(in);
+        if (in.remaining() != 0) {
+            throw std::runtime_error(std::to_string(in.remaining()) + " unexpected trailing bytes");
+        }
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error(load_file + " is neither a checkpoint nor a legacy model file "
+                                 "for this model: " + e.what());
+    }
+
+    data_predictor->model().set_legacy_parameters(std::move(predictor_params));
+    generator->model().set_legacy_parameters(std::move(generator_params));
+    minimal_threshold = meta[0];
+    value_range_config.lower_bound = meta[1];
+    value_range_config.upper_bound = meta[2];
+}
+
 std::string AdapAD::get_state_filename() const {
     auto now = std::chrono::system_clock::now();
     auto time = std::chrono::system_clock::to_time_t(now);
+    std::tm local_tm;
+    localtime_r(&time, &local_tm);
     std::stringstream ss;
     ss << config.save_path << "model_state_" 
-       << std::put_time(std::localtime(&time), "%Y%m%d_%H%M%S") 
+       << std::put_time(&local_tm, "%Y%m%d_%H%M%S") 
        << ".bin";
     return ss.str();
 }
@@ -712,8 +849,9 @@ void AdapAD::load_latest_model(const std::vector<float>& initial_data) {
     while ((entry = readdir(dir)) != nullptr) {
         std::string filename = entry->d_name;
         if (filename.find(parameter_name + "_model_") == 0 && 
-            filename.find(".bin") != std::string::npos) {
-            latest_file = filename;
+            filename.find(".bin") != std::string::npos &&
+            filename > latest_file) {
+            latest_file = filename;  // timestamps sort lexicographically
         }
     }
     closedir(dir);
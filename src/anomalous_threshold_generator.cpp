@@ -28,25 +28,19 @@ float AnomalousThresholdGenerator::generate(
     const std::vector<float>& prediction_errors,
     float minimal_threshold) {
     
-    bool was_training = generator->is_training(); 
-    generator->eval();  
-    
-    std::vector<std::vector<std::vector<float>>> reshaped_input(1);
-    reshaped_input[0].resize(1);
-    reshaped_input[0][0] = prediction_errors;
-    
-    auto output = generator->forward(reshaped_input);
-    auto pred = generator->get_final_prediction(output);
+    if (static_cast<int>(prediction_errors.size()) != lookback_len) {
+        throw std::runtime_error("Invalid input dimensions for threshold generation");
+    }
     
+    // Single (batch=1, seq=1) window, run through the allocation-free inference path
+    const std::vector<float>& pred = generator->infer(prediction_errors.data(), 1);
+    return to_threshold(pred[0], minimal_threshold);
+}
+
+float AnomalousThresholdGenerator::to_threshold(float output, float minimal_threshold) {
     // Clamp to minimal_threshold
     const auto& config = Config::getInstance();
-    float result = std::max(minimal_threshold, pred[0] * config.threshold_multiplier);
-    
-    if (was_training) {
-        generator->train();  
-    }
-    
-    return result;
+    return std::max(minimal_threshold, output * config.threshold_multiplier);
 }
 
 void AnomalousThresholdGenerator::update(
@@ -61,39 +55,63 @@ void AnomalousThresholdGenerator::update(
     
     std::vector<float> target{recent_error};
     
-    auto output = generator->forward(reshaped_input);
-    auto pred = generator->get_final_prediction(output);
-    
-    generator->train_step(reshaped_input, target, output, lr_update);
+    generator->train_step(reshaped_input, target, lr_update);
 }
 
 std::pair<std::vector<std::vector<std::vector<float>>>, std::vector<float>>
-AnomalousThresholdGenerator::train(int epoch, float lr, const std::vector<float>& data2learn) {
+AnomalousThresholdGenerator::train(int epoch, float lr, const std::vector<float>& data2learn, int batch_size) {
     if (data2learn.size() < lookback_len + prediction_len) {
         throw std::runtime_error("Not enough data for generator training");
     }
     
     auto windows = create_sliding_windows(data2learn);
+    fit(epoch, lr, windows, batch_size);
+
+    // Return processed windows in the expected format
+    std::vector<std::vector<std::vector<float>>> x3d;
+    for (const auto& window : windows.first) {
+        std::vector<std::vector<std::vector<float>>> input_tensor(1);
+        input_tensor[0].resize(1);
+        input_tensor[0][0] = window;
+        x3d.push_back(input_tensor[0]);
+    }
+    
+    return {x3d, windows.second};
+}
+
+void AnomalousThresholdGenerator::train_backbone(int epoch, float lr,
+                                                 const std::vector<std::vector<float>>& series,
+                                                 int batch_size) {
+    auto windows = create_pooled_windows(series, lookback_len, prediction_len);
+    if (windows.first.empty()) {
+        throw std::runtime_error("Not enough data for generator training");
+    }
+    std::cout << "Training shared generator backbone on " << windows.first.size() << " windows of "
+              << series.size() << " series..." << std::endl;
+    fit(epoch, lr, windows, batch_size);
+}
+
+void AnomalousThresholdGenerator::fit(int epoch, float lr,
+                                      const std::pair<std::vector<std::vector<float>>, std::vector<float>>& windows,
+                                      int batch_size) {
     generator->train();  
     
+    const size_t num_windows = windows.first.size();
+    const size_t step = static_cast<size_t>(std::max(1, batch_size));
+    
     for (int e = 0; e < epoch; ++e) {
         float epoch_loss = 0.0f;
         
-        for (size_t i = 0; i < windows.first.size(); ++i) {
-            
-            std::vector<std::vector<std::vector<float>>> reshaped_input(1);
-            reshaped_input[0].resize(1);
-            reshaped_input[0][0] = windows.first[i];
-            
-            std::vector<float> target{windows.second[i]};
+        for (size_t start = 0; start < num_windows; start += step) {
+            const size_t count = std::min(step, num_windows - start);
+            std::vector<std::vector<std::vector<float>>> reshaped_input(count);
+            std::vector<float> target(count);
+            for (size_t b = 0; b < count; ++b) {
+                reshaped_input[b].push_back(windows.first[start + b]);
+                target[b] = windows.second[start + b];
+            }
             
-            auto output = generator->forward(reshaped_input);
-            auto pred = generator->get_final_prediction(output);
-            
-            float diff = pred[0] - target[0];
-            epoch_loss += diff * diff;
-            
-            generator->train_step(reshaped_input, target, output, lr);
+            epoch_loss += generator->train_step_unchecked(reshaped_input, target, lr) * count;
         }
         
         // Report progress
@@ -103,17 +121,6 @@ AnomalousThresholdGenerator::train(int epoch, float lr, const std::vector<float>
                      << ", Average Loss: " << avg_loss << std::endl;
         }
     }
-
-    // Return processed windows in the expected format
-    std::vector<std::vector<std::vector<float>>> x3d;
-    for (const auto& window : windows.first) {
-        std::vector<std::vector<std::vector<float>>> input_tensor(1);
-        input_tensor[0].resize(1);
-        input_tensor[0][0] = window;
-        x3d.push_back(input_tensor[0]);
-    }
-    
-    return {x3d, windows.second};
 }
 
 void AnomalousThresholdGenerator::save_weights(std::ofstream& file) {
@@ -132,22 +139,6 @@ void AnomalousThresholdGenerator::save_biases(std::ofstream& file) {
     }
 }
 
-void AnomalousThresholdGenerator::load_weights(std::ifstream& file) {
-    if (generator) {
-        generator->load_weights(file);
-    } else {
-        throw std::runtime_error("Generator not initialized");
-    }
-}
-
-void AnomalousThresholdGenerator::load_biases(std::ifstream& file) {
-    if (generator) {
-        generator->load_biases(file);
-    } else {
-        throw std::runtime_error("Generator not initialized");
-    }
-}
-
 void AnomalousThresholdGenerator::save_layer_cache(std::ofstream& file) const {
     if (generator) {
         generator->save_layer_cache(file);
@@ -156,14 +147,6 @@ void AnomalousThresholdGenerator::save_layer_cache(std::ofstream& file) const {
     }
 }
 
-void AnomalousThresholdGenerator::load_layer_cache(std::ifstream& file) {
-    if (generator) {
-        generator->load_layer_cache(file);
-    } else {
-        throw std::runtime_error("Generator not initialized");
-    }
-}
-
 void AnomalousThresholdGenerator::initialize_layer_cache() {
     if (generator) {
         generator->initialize_layer_cache();
@@ -0,0 +1,415 @@
+#include "checkpoint.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char MAGIC[8] = {'A', 'D', 'A', 'P', 'A', 'D', 'C', 'K'};
+const uint32_t ENDIAN_TAG = 0x01020304;
+const size_t ALIGNMENT = 64;
+const size_t NAME_LEN = 40;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian_tag;
+    uint32_t section_count;
+    uint32_t reserved0;
+    uint64_t file_size;
+    uint32_t table_crc;
+    uint32_t header_crc;   // CRC of the header with this field zeroed
+    uint8_t reserved[24];
+};
+
+struct SectionEntry {
+    char name[NAME_LEN];
+    uint64_t offset;
+    uint64_t size;
+    uint32_t crc;
+    uint32_t reserved;
+};
+
+struct MatrixShape {
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t stride;
+    uint8_t reserved[40];
+};
+
+static_assert(sizeof(FileHeader) == 64, "checkpoint header must be 64 bytes");
+static_assert(sizeof(SectionEntry) == 64, "checkpoint section entry must be 64 bytes");
+static_assert(sizeof(MatrixShape) == 64, "matrix shape block must be 64 bytes");
+
+size_t align_up(size_t n) {
+    return (n + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+uint32_t header_crc(FileHeader header) {
+    header.header_crc = 0;
+    return crc32(&header, sizeof(header));
+}
+
+}
+
+uint32_t crc32(const void* data, size_t bytes, uint32_t crc) {
+    // Reflected IEEE 802.3 polynomial, same values as zlib's crc32()
+    static uint32_t table[256];
+    static bool table_ready = [] {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return true;
+    }();
+    (void)table_ready;
+    
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < bytes; ++i) {
+        crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+std::vector<char>& CheckpointWriter::new_section(const std::string& name, size_t bytes) {
+    if (name.empty() || name.size() >= NAME_LEN) {
+        throw std::invalid_argument("Invalid checkpoint section name: '" + name + "'");
+    }
+    for (const auto& section : sections) {
+        if (section.name == name) {
+            throw std::invalid_argument("Duplicate checkpoint section: " + name);
+        }
+    }
+    sections.push_back(Section());
+    sections.back().name = name;
+    sections.back().payload.resize(bytes);
+    return sections.back().payload;
+}
+
+void CheckpointWriter::add_bytes(const std::string& name, const void* data, size_t bytes) {
+    std::vector<char>& payload = new_section(name, bytes);
+    if (bytes > 0) {
+        std::memcpy(payload.data(), data, bytes);
+    }
+}
+
+void CheckpointWriter::add_floats(const std::string& name, const float* data, size_t count) {
+    add_bytes(name, data, count * sizeof(float));
+}
+
+void CheckpointWriter::add_matrix(const std::string& name, const Matrix& m) {
+    MatrixShape shape;
+    std::memset(&shape, 0, sizeof(shape));
+    shape.rows = m.rows();
+    shape.cols = m.cols();
+    shape.stride = m.stride();
+    
+    // Shape block, then the rows exactly as Matrix stores them (padding included)
+    const size_t data_bytes = m.rows() * m.stride() * sizeof(float);
+    std::vector<char>& payload = new_section(name, sizeof(shape) + data_bytes);
+    std::memcpy(payload.data(), &shape, sizeof(shape));
+    if (data_bytes > 0) {
+        std::memcpy(payload.data() + sizeof(shape), m.data(), data_bytes);
+    }
+}
+
+size_t CheckpointWriter::size_bytes() const {
+    size_t total = 0;
+    for (const auto& section : sections) {
+        total += section.payload.size();
+    }
+    return total;
+}
+
+void CheckpointWriter::write(const std::string& path) const {
+    std::vector<SectionEntry> table(sections.size());
+    size_t offset = align_up(sizeof(FileHeader) + table.size() * sizeof(SectionEntry));
+    for (size_t i = 0; i < sections.size(); ++i) {
+        SectionEntry& entry = table[i];
+        std::memset(&entry, 0, sizeof(entry));
+        std::memcpy(entry.name, sections[i].name.data(), sections[i].name.size());
+        entry.offset = offset;
+        entry.size = sections[i].payload.size();
+        entry.crc = crc32(sections[i].payload.data(), sections[i].payload.size());
+        offset = align_up(offset + entry.size);
+    }
+    
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = CHECKPOINT_VERSION;
+    header.endian_tag = ENDIAN_TAG;
+    header.section_count = static_cast<uint32_t>(table.size());
+    header.file_size = offset;
+    header.table_crc = crc32(table.data(), table.size() * sizeof(SectionEntry));
+    header.header_crc = header_crc(header);
+    
+    // Hidden temp file in the same directory, renamed over path once it is
+    // complete and synced, so path is either the old file or the new one
+    const size_t slash = path.find_last_of('/');
+    const std::string dir = slash == std::string::npos ? "." : path.substr(0, slash);
+    const std::string base = slash == std::string::npos ? path : path.substr(slash + 1);
+    const std::string tmp_path = dir + "/." + base + ".tmp";
+    
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open file for writing: " + tmp_path);
+    }
+    
+    static const char zeros[ALIGNMENT] = {};
+    size_t written = 0;
+    bool ok = true;
+    auto put = [&](const void* data, size_t bytes) {
+        const char* p = static_cast<const char*>(data);
+        while (ok && bytes > 0) {
+            ssize_t n = ::write(fd, p, bytes);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                ok = false;
+                break;
+            }
+            p += n;
+            bytes -= n;
+            written += n;
+        }
+    };
+    auto pad = [&]() {
+        put(zeros, align_up(written) - written);
+    };
+    
+    put(&header, sizeof(header));
+    put(table.data(), table.size() * sizeof(SectionEntry));
+    pad();
+    for (const auto& section : sections) {
+        put(section.payload.data(), section.payload.size());
+        pad();
+    }
+    
+    ok = ok && fsync(fd) == 0;
+    ok = (::close(fd) == 0) && ok;
+    if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("Failed to write checkpoint: " + path);
+    }
+    
+    // Make the rename itself durable
+    int dir_fd = ::open(dir.c_str(), O_RDONLY);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        ::close(dir_fd);
+    }
+}
+
+struct CheckpointReader::Mapping {
+    void* addr;
+    size_t length;
+    
+    Mapping() : addr(MAP_FAILED), length(0) {}
+    ~Mapping() {
+        if (addr != MAP_FAILED) {
+            munmap(addr, length);
+        }
+    }
+    char* bytes() const { return static_cast<char*>(addr); }
+};
+
+bool CheckpointReader::is_checkpoint(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(MAGIC)];
+    return file.read(magic, sizeof(magic)) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+CheckpointReader::CheckpointReader(const std::string& path)
+    : path(path), mapping(new Mapping), file_version(0) {
+    
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open checkpoint: " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(FileHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Checkpoint is truncated: " + path);
+    }
+    
+    // Private writable mapping: weights can be used and updated in place
+    // without the changes reaching the file
+    mapping->length = st.st_size;
+    mapping->addr = mmap(nullptr, mapping->length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping->addr == MAP_FAILED) {
+        throw std::runtime_error("Could not map checkpoint: " + path);
+    }
+    
+    const char* base = mapping->bytes();
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::runtime_error("Not a checkpoint file: " + path);
+    }
+    if (header.endian_tag != ENDIAN_TAG) {
+        throw std::runtime_error("Checkpoint was written with a different byte order: " + path);
+    }
+    if (header.header_crc != header_crc(header)) {
+        throw std::runtime_error("Checkpoint header is corrupted: " + path);
+    }
+    if (header.version == 0 || header.version > CHECKPOINT_VERSION) {
+        throw std::runtime_error("Unsupported checkpoint version " + 
+                                 std::to_string(header.version) + ": " + path);
+    }
+    if (header.file_size != mapping->length) {
+        throw std::runtime_error("Checkpoint size mismatch (truncated?): " + path);
+    }
+    
+    const size_t table_bytes = (size_t)header.section_count * sizeof(SectionEntry);
+    if (sizeof(FileHeader) + table_bytes > mapping->length) {
+        throw std::runtime_error("Checkpoint section table is out of bounds: " + path);
+    }
+    const char* table = base + sizeof(FileHeader);
+    if (header.table_crc != crc32(table, table_bytes)) {
+        throw std::runtime_error("Checkpoint section table is corrupted: " + path);
+    }
+    
+    for (uint32_t i = 0; i < header.section_count; ++i) {
+        SectionEntry raw;
+        std::memcpy(&raw, table + i * sizeof(SectionEntry), sizeof(raw));
+        Entry entry;
+        entry.name.assign(raw.name, strnlen(raw.name, NAME_LEN));
+        entry.offset = raw.offset;
+        entry.size = raw.size;
+        
+        if (entry.offset % ALIGNMENT != 0 || entry.offset > mapping->length ||
+            entry.size > mapping->length - entry.offset) {
+            throw std::runtime_error("Checkpoint section '" + entry.name + "' is out of bounds: " + path);
+        }
+        if (raw.crc != crc32(base + entry.offset, entry.size)) {
+            throw std::runtime_error("Checkpoint section '" + entry.name + "' is corrupted: " + path);
+        }
+        entries.push_back(entry);
+    }
+    file_version = header.version;
+}
+
+bool CheckpointReader::has(const std::string& name) const {
+    for (const auto& entry : entries) {
+        if (entry.name == name) return true;
+    }
+    return false;
+}
+
+const CheckpointReader::Entry& CheckpointReader::find(const std::string& name) const {
+    for (const auto& entry : entries) {
+        if (entry.name == name) return entry;
+    }
+    throw std::runtime_error("Checkpoint section '" + name + "' missing in " + path);
+}
+
+void CheckpointReader::read_bytes(const std::string& name, void* out, size_t bytes) const {
+    const Entry& entry = find(name);
+    if (entry.size != bytes) {
+        throw std::runtime_error("Checkpoint section '" + name + "' has size " + 
+                                 std::to_string(entry.size) + ", expected " + std::to_string(bytes));
+    }
+    std::memcpy(out, mapping->bytes() + entry.offset, bytes);
+}
+
+std::string CheckpointReader::read_string(const std::string& name) const {
+    const Entry& entry = find(name);
+    return std::string(mapping->bytes() + entry.offset, entry.size);
+}
+
+std::vector<float> CheckpointReader::read_floats(const std::string& name) const {
+    const Entry& entry = find(name);
+    if (entry.size % sizeof(float) != 0) {
+        throw std::runtime_error("Checkpoint section '" + name + "' is not a float array");
+    }
+    std::vector<float> values(entry.size / sizeof(float));
+    if (!values.empty()) {
+        std::memcpy(values.data(), mapping->bytes() + entry.offset, entry.size);
+    }
+    return values;
+}
+
+void CheckpointReader::matrix_shape(const Entry& entry, size_t& rows, size_t& cols, char*& data) const {
+    MatrixShape shape;
+    if (entry.size < sizeof(shape)) {
+        throw std::runtime_error("Checkpoint section '" + entry.name + "' is not a matrix");
+    }
+    std::memcpy(&shape, mapping->bytes() + entry.offset, sizeof(shape));
+    if (shape.stride != Matrix::padded_stride(shape.cols) ||
+        entry.size != sizeof(shape) + shape.rows * shape.stride * sizeof(float)) {
+        throw std::runtime_error("Checkpoint section '" + entry.name + "' has an invalid matrix shape");
+    }
+    rows = shape.rows;
+    cols = shape.cols;
+    data = mapping->bytes() + entry.offset + sizeof(shape);
+}
+
+void CheckpointReader::view_matrix(const std::string& name, Matrix& m) const {
+    size_t rows, cols;
+    char* data;
+    matrix_shape(find(name), rows, cols, data);
+    m.attach(reinterpret_cast<float*>(data), rows, cols, mapping);
+}
+
+void CheckpointReader::read_matrix(const std::string& name, Matrix& m) const {
+    size_t rows, cols;
+    char* data;
+    matrix_shape(find(name), rows, cols, data);
+    m.resize(rows, cols);
+    if (rows > 0) {
+        std::memcpy(m.data(), data, rows * m.stride() * sizeof(float));
+    }
+}
+
+LegacyModelStream::LegacyModelStream(const std::string& path) : path(path), pos(0) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("Could not open model file: " + path);
+    }
+    bytes.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    if (!file.read(bytes.data(), bytes.size())) {
+        throw std::runtime_error("Could not read model file: " + path);
+    }
+}
+
+void LegacyModelStream::read(void* out, size_t count) {
+    if (count > remaining()) {
+        throw std::runtime_error("Model file is truncated or corrupt: " + path);
+    }
+    std::memcpy(out, bytes.data() + pos, count);
+    pos += count;
+}
+
+uint64_t LegacyModelStream::read_size() {
+    size_t size;
+    read(&size, sizeof(size));
+    return size;
+}
+
+void LegacyModelStream::read_floats(float* out, size_t count) {
+    if (count > remaining() / sizeof(float)) {
+        throw std::runtime_error("Model file is truncated or corrupt: " + path);
+    }
+    read(out, count * sizeof(float));
+}
+
+void LegacyModelStream::expect_size(const std::string& what, uint64_t expected) {
+    const uint64_t size = read_size();
+    if (size != expected) {
+        throw std::runtime_error(what + " is " + std::to_string(size) + ", model expects " +
+                                 std::to_string(expected) + " (" + path + ")");
+    }
+}
@@ -0,0 +1,86 @@
+#include "checkpoint_saver.hpp"
+#include <iostream>
+
+CheckpointSaver::CheckpointSaver()
+    : busy(false),
+      stopping(false),
+      failed(0) {
+    saver = std::thread(&CheckpointSaver::saver_loop, this);
+}
+
+CheckpointSaver::~CheckpointSaver() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_cv.notify_one();
+    saver.join();
+}
+
+void CheckpointSaver::submit(const std::string& key, CheckpointWriter&& ckpt, const std::string& path,
+                             std::function<void()> after_write) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& job : pending) {
+            if (job.key == key) {
+                // Not started yet, the newer snapshot takes its place
+                job.path = path;
+                job.ckpt = std::move(ckpt);
+                job.after_write = std::move(after_write);
+                return;
+            }
+        }
+        pending.push_back(Job());
+        Job& job = pending.back();
+        job.key = key;
+        job.path = path;
+        job.ckpt = std::move(ckpt);
+        job.after_write = std::move(after_write);
+    }
+    work_cv.notify_one();
+}
+
+void CheckpointSaver::wait_idle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle_cv.wait(lock, [this]() { return pending.empty() && !busy; });
+}
+
+size_t CheckpointSaver::failed_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return failed;
+}
+
+void CheckpointSaver::saver_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        work_cv.wait(lock, [this]() { return stopping || !pending.empty(); });
+        if (pending.empty()) {
+            break;  // stopping and nothing left to write
+        }
+        
+        Job job = std::move(pending.front());
+        pending.pop_front();
+        busy = true;
+        lock.unlock();
+        
+        bool ok = true;
+        try {
+            job.ckpt.write(job.path);
+            if (job.after_write) {
+                job.after_write();
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error saving checkpoint " << job.path << ": " << e.what() << std::endl;
+            ok = false;
+        }
+        
+        lock.lock();
+        busy = false;
+        if (!ok) {
+            ++failed;
+        }
+        if (pending.empty()) {
+            idle_cv.notify_all();
+        }
+    }
+}
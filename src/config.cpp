@@ -32,12 +32,21 @@ bool Config::load(const std::string& yaml_path) {
         data_source_path = get_string("data.paths.training");
         data_val_path = get_string("data.paths.validation");
         log_file_path = get_string("data.paths.log");
+        follow_input = get_bool("data.follow", false);
+        follow_poll_ms = get_int("data.follow_poll_ms", 200);
+        log_flush_interval_ms = get_int("logging.flush_interval_ms", 1000);
+        log_buffer_records = std::max(2, get_int("logging.buffer_records", 1024));
+        stats_interval = std::max(0, get_int("logging.stats_interval", 0));
+        stats_file = get_string("logging.stats_file", "");
 
         // Load model architecture
         LSTM_size = get_int("model.lstm.size", 100);
         LSTM_size_layer = get_int("model.lstm.layers", 2);
         lookback_len = get_int("model.lstm.lookback", 3);
         prediction_len = get_int("model.lstm.prediction_len", 1);
+        activation = parse_activation(get_string("model.activation", "exact"));
+        inference_precision = parse_inference_precision(get_string("model.inference_precision", "fp32"));
+        shared_backbone = get_bool("model.shared_backbone", false);
 
         // Load save settings
         save_enabled = get_bool("model.save_enabled", false);
@@ -52,10 +61,19 @@ bool Config::load(const std::string& yaml_path) {
         lr_train = get_float("training.learning_rates.train", 0.015f);
         lr_update = get_float("training.learning_rates.update", 0.015f);
         lr_update_generator = get_float("training.learning_rates.update_generator", 0.015f);
+        batch_size = std::max(1, get_int("training.batch_size", 1));
+        optimizer.kind = parse_optimizer(get_string("training.optimizer.type", "sgd"));
+        optimizer.grad_clip = get_float("training.optimizer.grad_clip", 1.0f);
+        optimizer.momentum = get_float("training.optimizer.momentum", 0.9f);
+        optimizer.beta1 = get_float("training.optimizer.beta1", 0.9f);
+        optimizer.beta2 = get_float("training.optimizer.beta2", 0.999f);
+        optimizer.epsilon = get_float("training.optimizer.epsilon", 1e-8f);
 
         // Load system settings
         random_seed = get_int("system.random_seed", 42);
         verbose_output = get_bool("system.verbose_output", true);
+        num_threads = get_int("system.threads", 1);
+        pin_threads = get_bool("system.pin_threads", false);
 
         // Load anomaly detection parameters
         threshold_multiplier = get_float("anomaly_detection.threshold_multiplier", 1.0f);
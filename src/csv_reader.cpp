@@ -0,0 +1,135 @@
+#include "csv_reader.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <chrono>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+constexpr float CSVStreamReader::MISSING_VALUE;
+
+namespace {
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool field_equals(const char* begin, const char* end, const char* token) {
+    size_t len = std::strlen(token);
+    return (size_t)(end - begin) == len && std::memcmp(begin, token, len) == 0;
+}
+
+}
+
+CSVStreamReader::CSVStreamReader(const std::string& path, bool follow, int poll_interval_ms)
+    : file(path),
+      path(path),
+      follow(follow),
+      poll_interval_ms(poll_interval_ms > 0 ? poll_interval_ms : 1),
+      line_number(0),
+      row_count(0) {
+    
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open data file: " + path);
+    }
+    if (!read_line()) {
+        throw std::runtime_error("No header found in data file: " + path);
+    }
+    
+    // Skip timestamp, the rest are sensor columns
+    size_t start = line.find(',');
+    while (start != std::string::npos) {
+        size_t end = line.find(',', start + 1);
+        column_names.push_back(line.substr(start + 1, 
+            end == std::string::npos ? std::string::npos : end - start - 1));
+        start = end;
+    }
+    invalid_counts.assign(column_names.size(), 0);
+}
+
+bool CSVStreamReader::read_line() {
+    while (true) {
+        if (std::getline(file, line)) {
+            if (!file.eof()) {
+                // Complete line
+                if (!partial.empty()) {
+                    line.insert(0, partial);
+                    partial.clear();
+                }
+                ++line_number;
+                return true;
+            }
+            // Last line of the file without a newline
+            if (!follow) {
+                line.insert(0, partial);
+                partial.clear();
+                ++line_number;
+                return true;
+            }
+            partial += line;
+        }
+        
+        if (!follow) {
+            return false;
+        }
+        
+        // Wait for the writer to append more
+        file.clear();
+        std::this_thread::sleep_for(std::chrono::milliseconds(poll_interval_ms));
+    }
+}
+
+float CSVStreamReader::parse_field(const char* begin, const char* end, size_t column) {
+    while (begin < end && is_space(*begin)) ++begin;
+    while (end > begin && is_space(end[-1])) --end;
+    
+    if (begin == end || field_equals(begin, end, "NA") || field_equals(begin, end, "NaN") ||
+        field_equals(begin, end, "-") || field_equals(begin, end, "0.0")) {
+        std::cerr << "Warning: Invalid/missing value at line " << line_number 
+                  << ", column " << column + 1 << ": '" << std::string(begin, end) 
+                  << "', setting to -999" << std::endl;
+        ++invalid_counts[column];
+        return MISSING_VALUE;
+    }
+    
+    // The field is followed by ',' or the end of the line, so strtof stops in time
+    char* parsed_end = nullptr;
+    errno = 0;
+    float value = std::strtof(begin, &parsed_end);
+    if (parsed_end == begin || errno == ERANGE) {
+        std::cerr << "Warning: Failed to parse value at line " << line_number 
+                  << ", column " << column + 1 << ": '" << std::string(begin, end) 
+                  << "', setting to -999" << std::endl;
+        ++invalid_counts[column];
+        return MISSING_VALUE;
+    }
+    return value;
+}
+
+bool CSVStreamReader::next_row(std::vector<float>& values) {
+    if (!read_line()) {
+        return false;
+    }
+    
+    values.resize(column_names.size());
+    const char* pos = line.c_str();
+    const char* line_end = pos + line.size();
+    
+    // Skip timestamp
+    pos = static_cast<const char*>(std::memchr(pos, ',', line_end - pos));
+    
+    for (size_t c = 0; c < column_names.size(); ++c) {
+        if (pos == nullptr) {
+            std::cerr << "Warning: Missing column at line " << line_number << std::endl;
+            values[c] = parse_field(line_end, line_end, c);
+            continue;
+        }
+        const char* field = pos + 1;
+        pos = static_cast<const char*>(std::memchr(field, ',', line_end - field));
+        values[c] = parse_field(field, pos ? pos : line_end, c);
+    }
+    
+    ++row_count;
+    return true;
+}
@@ -0,0 +1,80 @@
+#include "fixed_lstm.hpp"
+#include "lstm_predictor.hpp"
+#include "simd_kernels.hpp"
+#include "activations.hpp"
+#include <algorithm>
+
+template <int Input, int Hidden, int Layers>
+void FixedLSTM<Input, Hidden, Layers>::infer(LSTMPredictor& model, const float* x, size_t seq_len) {
+    const int gates_size = 4 * Hidden;
+    const Activation activation = model.activation;
+    float* gates = model.gates_buf.data();
+    float* tanh_c = model.cell_tanh_buf.data();
+
+    // Layer 0 input term (biases included) through the model's projection
+    // cache, so an update that follows on the same window reuses it
+    const Matrix& projected = model.project_input(x, 1, seq_len, nullptr);
+
+    for (size_t t = 0; t < seq_len; ++t) {
+        for (int layer = 0; layer < Layers; ++layer) {
+            const LSTMPredictor::LSTMLayer& w = model.layers()[layer];
+            float* h = model.h_state[layer].data();
+            float* c = model.c_state[layer].data();
+
+            // [i,f,g,o] pre-activations: biases, then input and recurrent matvecs
+            if (layer == 0) {
+                std::copy(projected.row(t), projected.row(t) + gates_size, gates);
+            } else {
+                for (int g = 0; g < gates_size; ++g) {
+                    gates[g] = w.bias_ih[g] + w.bias_hh[g];
+                }
+                gemv_accumulate_fixed<Hidden>(w.weight_ih, model.h_state[layer - 1].data(), gates);
+            }
+            gemv_accumulate_fixed<Hidden>(w.weight_hh, h, gates);
+
+            apply_sigmoid(gates, gates, 2 * Hidden, activation);
+            apply_tanh(gates + 2 * Hidden, gates + 2 * Hidden, Hidden, activation);
+            apply_sigmoid(gates + 3 * Hidden, gates + 3 * Hidden, Hidden, activation);
+
+            const float* i_t = gates;
+            const float* f_t = gates + Hidden;
+            const float* g_t = gates + 2 * Hidden;
+            const float* o_t = gates + 3 * Hidden;
+            for (int k = 0; k < Hidden; ++k) {
+                c[k] = f_t[k] * c[k] + i_t[k] * g_t[k];
+            }
+            apply_tanh(c, tanh_c, Hidden, activation);
+            for (int k = 0; k < Hidden; ++k) {
+                h[k] = o_t[k] * tanh_c[k];
+            }
+        }
+    }
+
+    const float* last_hidden = model.h_state[Layers - 1].data();
+    const float* fc_w = model.fc_weight.row(0);
+    float out = model.fc_bias[0];
+    for (int k = 0; k < Hidden; ++k) {
+        out += fc_w[k] * last_hidden[k];
+    }
+    model.fc_output[0] = out;
+}
+
+FixedInferFn find_fixed_lstm(int input_size, int hidden_size, int num_layers, int num_classes) {
+#if !defined(ADAPAD_NO_FIXED_SHAPES)
+    if (num_classes != 1) {
+        return nullptr;
+    }
+#define ADAPAD_FIXED_LSTM_CASE(I, H, L) \
+    if (input_size == I && hidden_size == H && num_layers == L) { \
+        return &FixedLSTM<I, H, L>::infer; \
+    }
+    ADAPAD_FIXED_LSTM_SHAPES(ADAPAD_FIXED_LSTM_CASE)
+#undef ADAPAD_FIXED_LSTM_CASE
+#else
+    (void)input_size;
+    (void)hidden_size;
+    (void)num_layers;
+    (void)num_classes;
+#endif
+    return nullptr;
+}
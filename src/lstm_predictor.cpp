@@ -1,7 +1,10 @@
 #include "lstm_predictor.hpp"
 #include "matrix_utils.hpp"
+#include "simd_kernels.hpp"
+#include "activations.hpp"
 #include "config.hpp"
 #include "model_state.hpp"
+#include "checkpoint.hpp"
 
 #include <random>
 #include <algorithm>
@@ -24,8 +27,34 @@ LSTMPredictor::LSTMPredictor(int num_classes, int input_size, int hidden_size,
       seq_length(lookback_len),
       batch_first(batch_first) {
     
-    lstm_layers.resize(num_layers);
+    backbone = std::make_shared<std::vector<LSTMLayer>>(num_layers);
     last_gradients.resize(num_layers);
+
+    // Per-model workspaces, allocated once so the inference path does not touch the heap
+    gates_buf.resize(4 * hidden_size);
+    cell_tanh_buf.resize(hidden_size);
+    fc_output.resize(num_classes);
+    // and the backward pass buffers that only depend on the model shape
+    backward_bufs.fc_weight_grad.resize(num_classes, hidden_size);
+    backward_bufs.fc_bias_grad.resize(num_classes);
+    backward_bufs.loss_grad.resize(num_classes);
+    backward_bufs.dh.resize(hidden_size);
+    backward_bufs.dc.resize(hidden_size);
+    backward_bufs.dh_prev.resize(hidden_size);
+    backward_bufs.dc_prev.resize(hidden_size);
+    backward_bufs.d_gates.resize(4 * hidden_size);
+    backward_bufs.tanh_cell.resize(hidden_size);
+    fixed_infer = find_fixed_lstm(input_size, hidden_size, num_layers, num_classes);
+
+    optimizer.add_slot("fc.weight");
+    optimizer.add_slot("fc.bias");
+    for (int layer = 0; layer < num_layers; ++layer) {
+        const std::string name = "lstm" + std::to_string(layer) + ".";
+        optimizer.add_slot(name + "weight_ih");
+        optimizer.add_slot(name + "weight_hh");
+        optimizer.add_slot(name + "bias_ih");
+        optimizer.add_slot(name + "bias_hh");
+    }
     
     initialize_weights();
     reset_states();
@@ -33,284 +62,635 @@ LSTMPredictor::LSTMPredictor(int num_classes, int input_size, int hidden_size,
 
 // Neither cell nor hidden state are used for long term dependencies
 void LSTMPredictor::reset_states() {
-    c_state.clear();
-    h_state.clear();
-    c_state.resize(num_layers, std::vector<float>(hidden_size, 0.0f));
-    h_state.resize(num_layers, std::vector<float>(hidden_size, 0.0f));
-}
-
-float LSTMPredictor::sigmoid(float x) {
-    return 1.0f / (1.0f + std::exp(-x));
-}
-
-float LSTMPredictor::tanh_custom(float x) {
-    return std::tanh(x);
-}
-
-std::vector<float> LSTMPredictor::lstm_cell_forward(
-    const std::vector<float>& input,
-    std::vector<float>& h_state,
-    std::vector<float>& c_state,
-    const LSTMLayer& layer) {
-
-    // Get the correct input size for this layer
-    int expected_layer_input = (current_layer == 0) ? input_size : hidden_size;
-
-    // Verify weight dimensions
-    int weight_input_size = layer.weight_ih[0].size();
-    if (weight_input_size != expected_layer_input) {
-        throw std::runtime_error("Weight dimension mismatch in lstm_cell_forward");
+    // Zero in place; assign() reuses the existing capacity
+    c_state.resize(num_layers);
+    h_state.resize(num_layers);
+    for (int layer = 0; layer < num_layers; ++layer) {
+        c_state[layer].assign(hidden_size, 0.0f);
+        h_state[layer].assign(hidden_size, 0.0f);
     }
+}
 
-    // Verify input size
-    if (input.size() != expected_layer_input) {
-        throw std::runtime_error("Input size mismatch in lstm_cell_forward");
+// gates = bias_ih + bias_hh (PyTorch layout: [i,f,g,o]), one row of
+// 4*hidden_size per batch entry
+void LSTMPredictor::fill_gate_biases(const LSTMLayer& layer, float* gates_all,
+                                     size_t gate_stride, size_t batch) const {
+    for (size_t b = 0; b < batch; ++b) {
+        float* gates = gates_all + b * gate_stride;
+        for (int h = 0; h < hidden_size; ++h) {
+            gates[h] = layer.bias_ih[h] + layer.bias_hh[h];                     // input gate (i)
+            gates[hidden_size + h] = layer.bias_ih[hidden_size + h] + 
+                                    layer.bias_hh[hidden_size + h];             // forget gate (f)
+            gates[2 * hidden_size + h] = layer.bias_ih[2 * hidden_size + h] + 
+                                        layer.bias_hh[2 * hidden_size + h];     // cell gate (g)
+            gates[3 * hidden_size + h] = layer.bias_ih[3 * hidden_size + h] + 
+                                        layer.bias_hh[3 * hidden_size + h];     // output gate (o)
+        }
     }
+}
 
-    // Verify state dimensions
-    if (h_state.size() != hidden_size) {
-        h_state.resize(hidden_size, 0.0f);
-    }
-    if (c_state.size() != hidden_size) {
-        c_state.resize(hidden_size, 0.0f);
+const Matrix& LSTMPredictor::project_input(const float* x, size_t batch, size_t seq_len,
+                                           const QuantizedLayer* quantized) {
+    InputProjection& p = input_projection;
+    const size_t count = batch * seq_len * input_size;
+    const bool int8 = quantized != nullptr;
+    
+    if (p.batch == batch && p.seq_len == seq_len && p.int8 == int8 &&
+        p.weights_version == weights_version &&
+        std::equal(x, x + count, p.input.begin())) {
+        return p.gates;
     }
-
-    // Verify weight matrix dimensions
-    if (layer.weight_ih.size() != 4 * hidden_size || 
-        layer.weight_ih[0].size() != expected_layer_input) {
-        throw std::runtime_error("Weight ih dimension mismatch");
+    
+    const size_t rows = batch * seq_len;
+    const size_t gate_stride = 4 * hidden_size;
+    if (p.gates.rows() != rows) {
+        p.gates.resize(rows, gate_stride);
     }
-    if (layer.weight_hh.size() != 4 * hidden_size || 
-        layer.weight_hh[0].size() != hidden_size) {
-        throw std::runtime_error("Weight hh dimension mismatch");
+    p.input.assign(x, x + count);
+    
+    // Same arithmetic as the per-step path (biases first, then the matvec),
+    // just for every timestep and sequence in one pass over weight_ih
+    const LSTMLayer& layer = layers()[0];
+    fill_gate_biases(layer, p.gates.data(), p.gates.stride(), rows);
+    if (int8) {
+        for (size_t r = 0; r < rows; ++r) {
+            gemv_accumulate_q8(quantized->weight_ih, x + r * input_size, p.gates.row(r));
+        }
+    } else {
+        gemm_accumulate(layer.weight_ih, x, input_size, rows, p.gates.data(), p.gates.stride());
     }
     
-    // Declare cache_entry only if training_mode is true**
-    LSTMCacheEntry cache_entry;
+    p.batch = batch;
+    p.seq_len = seq_len;
+    p.int8 = int8;
+    p.weights_version = weights_version;
+    ++p.computed;
+    return p.gates;
+}
 
+void LSTMPredictor::lstm_cell_forward(
+    const float* input,
+    size_t input_len,
+    size_t input_stride,
+    float* h_state,
+    float* c_state,
+    size_t state_stride,
+    size_t batch,
+    const LSTMLayer& layer,
+    const QuantizedLayer* quantized,
+    const float* projected,
+    size_t projected_stride) {
+
+    const size_t expected_layer_input = (current_layer == 0) ? input_size : hidden_size;
+    LSTM_DEBUG_CHECK(input_len == expected_layer_input, "Input size mismatch in lstm_cell_forward");
+    LSTM_DEBUG_CHECK(gates_buf.size() >= batch * 4 * hidden_size,
+                     "Gate workspace too small for batch in lstm_cell_forward");
+    LSTM_DEBUG_CHECK(layer.weight_ih.rows() == 4 * static_cast<size_t>(hidden_size) &&
+                     layer.weight_ih.cols() == expected_layer_input, "Weight ih dimension mismatch");
+    LSTM_DEBUG_CHECK(layer.weight_hh.rows() == 4 * static_cast<size_t>(hidden_size) &&
+                     layer.weight_hh.cols() == static_cast<size_t>(hidden_size), "Weight hh dimension mismatch");
+    (void)expected_layer_input;
+    
     if (training_mode) {
-        // Validate indices before accessing cache**
-        if (current_layer >= layer_cache.size() ||
-            current_batch >= layer_cache[current_layer].size() ||
-            current_timestep >= layer_cache[current_layer][current_batch].size()) {
-            throw std::runtime_error("Invalid cache access");
-        }
-        
-        // Initialize cache entry with proper sizes**
-        cache_entry = layer_cache[current_layer][current_batch][current_timestep];
+        LSTM_DEBUG_CHECK(current_layer < static_cast<int>(tape.num_layers) &&
+                         batch <= tape.batch_size && current_timestep < tape.seq_len,
+                         "Invalid cache access");
         
-        // Validate and copy input
-        cache_entry.input = input;  // Now we know the size is correct
-        
-        // Initialize other cache vectors
-        cache_entry.input_gate.resize(hidden_size, 0.0f);
-        cache_entry.forget_gate.resize(hidden_size, 0.0f);
-        cache_entry.cell_gate.resize(hidden_size, 0.0f);
-        cache_entry.output_gate.resize(hidden_size, 0.0f);
-        cache_entry.cell_state.resize(hidden_size, 0.0f);
-        cache_entry.hidden_state.resize(hidden_size, 0.0f);
-        cache_entry.prev_hidden = h_state;
-        cache_entry.prev_cell = c_state;
-    }
-    
-    // Initialize gates with biases (PyTorch layout: [i,f,g,o])
-    std::vector<float> gates(4 * hidden_size);
-    for (int h = 0; h < hidden_size; ++h) {
-        gates[h] = layer.bias_ih[h] + layer.bias_hh[h];                     // input gate (i)
-        gates[hidden_size + h] = layer.bias_ih[hidden_size + h] + 
-                                layer.bias_hh[hidden_size + h];             // forget gate (f)
-        gates[2 * hidden_size + h] = layer.bias_ih[2 * hidden_size + h] + 
-                                    layer.bias_hh[2 * hidden_size + h];     // cell gate (g)
-        gates[3 * hidden_size + h] = layer.bias_ih[3 * hidden_size + h] + 
-                                    layer.bias_hh[3 * hidden_size + h];     // output gate (o)
+        // Inputs to this step are needed by the backward pass, so record them
+        // before the states are updated below
+        for (size_t b = 0; b < batch; ++b) {
+            const size_t row = tape.step(current_layer, b, current_timestep);
+            const float* x_b = input + b * input_stride;
+            const float* h_b = h_state + b * state_stride;
+            const float* c_b = c_state + b * state_stride;
+            std::copy(x_b, x_b + input_len, tape.input.row(row));
+            std::copy(h_b, h_b + hidden_size, tape.prev_hidden.row(row));
+            std::copy(c_b, c_b + hidden_size, tape.prev_cell.row(row));
+        }
     }
     
-    // Input to hidden contributions
-    for (size_t i = 0; i < input.size(); ++i) {
-        for (int h = 0; h < hidden_size; ++h) {
-            gates[h] += layer.weight_ih[h][i] * input[i];                                       // input gate
-            gates[hidden_size + h] += layer.weight_ih[hidden_size + h][i] * input[i];           // forget gate
-            gates[2 * hidden_size + h] += layer.weight_ih[2 * hidden_size + h][i] * input[i];   // cell gate
-            gates[3 * hidden_size + h] += layer.weight_ih[3 * hidden_size + h][i] * input[i];   // output gate
+    const size_t gate_stride = 4 * hidden_size;
+    float* gates_all = gates_buf.data();
+    if (projected) {
+        // Biases and input contribution were computed up front by project_input
+        for (size_t b = 0; b < batch; ++b) {
+            const float* p_b = projected + b * projected_stride;
+            std::copy(p_b, p_b + gate_stride, gates_all + b * gate_stride);
         }
+    } else {
+        fill_gate_biases(layer, gates_all, gate_stride, batch);
     }
     
-    // Hidden to hidden contributions
-    for (int h = 0; h < hidden_size; ++h) {
-        for (size_t i = 0; i < hidden_size; ++i) {
-            gates[h] += layer.weight_hh[h][i] * h_state[i];                                     // input gate
-            gates[hidden_size + h] += layer.weight_hh[hidden_size + h][i] * h_state[i];         // forget gate
-            gates[2 * hidden_size + h] += layer.weight_hh[2 * hidden_size + h][i] * h_state[i]; // cell gate
-            gates[3 * hidden_size + h] += layer.weight_hh[3 * hidden_size + h][i] * h_state[i]; // output gate
+    // Input to hidden and hidden to hidden contributions, all four gates and
+    // the whole batch per pass over the weights
+    if (quantized) {
+        for (size_t b = 0; b < batch; ++b) {
+            if (!projected) {
+                gemv_accumulate_q8(quantized->weight_ih, input + b * input_stride, gates_all + b * gate_stride);
+            }
+            gemv_accumulate_q8(quantized->weight_hh, h_state + b * state_stride, gates_all + b * gate_stride);
         }
+    } else {
+        if (!projected) {
+            gemm_accumulate(layer.weight_ih, input, input_stride, batch, gates_all, gate_stride);
+        }
+        gemm_accumulate(layer.weight_hh, h_state, state_stride, batch, gates_all, gate_stride);
     }
 
     // Apply activations and update states
-    for (int h = 0; h < hidden_size; ++h) {
-        float i_t = sigmoid(gates[h]);                          // input gate
-        float f_t = sigmoid(gates[hidden_size + h]);            // forget gate
-        float g_t = tanh_custom(gates[2 * hidden_size + h]);    // cell gate
-        float o_t = sigmoid(gates[3 * hidden_size + h]);        // output gate
+    for (size_t b = 0; b < batch; ++b) {
+        float* gates = gates_all + b * gate_stride;
+        float* h_b = h_state + b * state_stride;
+        float* c_b = c_state + b * state_stride;
+
+        // Gate activations in place, a whole gate block per call:
+        // sigmoid for i and f (adjacent), tanh for g, sigmoid for o
+        apply_sigmoid(gates, gates, 2 * hidden_size, activation);
+        apply_tanh(gates + 2 * hidden_size, gates + 2 * hidden_size, hidden_size, activation);
+        apply_sigmoid(gates + 3 * hidden_size, gates + 3 * hidden_size, hidden_size, activation);
+
+        const float* i_t = gates;                      // input gate
+        const float* f_t = gates + hidden_size;        // forget gate
+        const float* g_t = gates + 2 * hidden_size;    // cell gate
+        const float* o_t = gates + 3 * hidden_size;    // output gate
 
         // Update cell state
-        float new_cell = f_t * c_state[h] + i_t * g_t;
-        c_state[h] = new_cell;
+        for (int h = 0; h < hidden_size; ++h) {
+            c_b[h] = f_t[h] * c_b[h] + i_t[h] * g_t[h];
+        }
         
         // Update hidden state
-        float new_hidden = o_t * tanh_custom(new_cell);
-        h_state[h] = new_hidden;
+        float* tanh_c = cell_tanh_buf.data();
+        apply_tanh(c_b, tanh_c, hidden_size, activation);
+        for (int h = 0; h < hidden_size; ++h) {
+            h_b[h] = o_t[h] * tanh_c[h];
+        }
 
-        // Store values in cache only if training_mode is true
+        // Record activations only if training_mode is true
         if (training_mode) {
-            cache_entry.input_gate[h] = i_t;
-            cache_entry.forget_gate[h] = f_t;
-            cache_entry.cell_gate[h] = g_t;
-            cache_entry.output_gate[h] = o_t;
-            cache_entry.cell_state[h] = new_cell;
-            cache_entry.hidden_state[h] = new_hidden;
+            const size_t row = tape.step(current_layer, b, current_timestep);
+            std::copy(i_t, i_t + hidden_size, tape.input_gate.row(row));
+            std::copy(f_t, f_t + hidden_size, tape.forget_gate.row(row));
+            std::copy(g_t, g_t + hidden_size, tape.cell_gate.row(row));
+            std::copy(o_t, o_t + hidden_size, tape.output_gate.row(row));
+            std::copy(c_b, c_b + hidden_size, tape.cell_state.row(row));
+            std::copy(h_b, h_b + hidden_size, tape.hidden_state.row(row));
         }
     }
-    
-    // Ensure h_state has the correct size
-    if (h_state.size() != hidden_size) {
-        h_state.resize(hidden_size);
-    }
+}
 
-    // Create a copy of h_state to return
-    std::vector<float> output = h_state;
-    
-    // Verify output dimensions one last time
-    if (output.size() != hidden_size) {
-        throw std::runtime_error("Output size mismatch in lstm_cell_forward");
-    }
 
-    // If training_mode, store cache_entry back to layer_cache
-    if (training_mode) {
-        layer_cache[current_layer][current_batch][current_timestep] = cache_entry;
-    }
+LSTMPredictor::LSTMOutput LSTMPredictor::forward(
+    const std::vector<std::vector<std::vector<float>>>& x,
+    const std::vector<std::vector<float>>* initial_hidden,
+    const std::vector<std::vector<float>>* initial_cell) {
 
+    check_input(x);
+    LSTMOutput output;
+    forward_batch(x, initial_hidden, initial_cell, &output);
+    output.final_hidden = h_state;
+    output.final_cell = c_state;
     return output;
 }
 
-
-LSTMPredictor::LSTMOutput LSTMPredictor::forward(
+void LSTMPredictor::forward_batch(
     const std::vector<std::vector<std::vector<float>>>& x,
     const std::vector<std::vector<float>>* initial_hidden,
-    const std::vector<std::vector<float>>* initial_cell) {
+    const std::vector<std::vector<float>>* initial_cell,
+    LSTMOutput* output) {
 
     reset_states();
-    
-    for (size_t batch = 0; batch < x.size(); ++batch) {
-        
-        for (size_t seq = 0; seq < x[batch].size(); ++seq) {
-            
-            // Verify input dimensions for each timestep
-            if (x[batch][seq].size() != input_size) {
-                throw std::runtime_error("Input dimension mismatch in sequence");
-            }
-        }
-    }
+#ifdef ADAPAD_DEBUG_CHECKS
+    check_input(x);
+#endif
     
     try {
         size_t batch_size = x.size();
         size_t seq_len = x[0].size();
         
-        // Initialize layer cache for training
-        if (training_mode) {
-            if (layer_cache.empty() || 
-                layer_cache.size() != num_layers ||
-                layer_cache[0].size() != batch_size ||
-                layer_cache[0][0].size() != seq_len) {
-                
-                layer_cache.clear();
-                layer_cache.resize(num_layers);
-                
-                for (int layer = 0; layer < num_layers; ++layer) {
-                    layer_cache[layer].resize(batch_size);
-                    for (size_t batch = 0; batch < batch_size; ++batch) {
-                        layer_cache[layer][batch].resize(seq_len);
-                    }
-                }
-            }
+        // Size the activation tape for training; it is only reallocated
+        // when the batch shape changes
+        if (training_mode && !tape.has_shape(num_layers, batch_size, seq_len)) {
+            tape.resize(num_layers, batch_size, seq_len,
+                        std::max(input_size, hidden_size), hidden_size);
         }
+        begin_batch(batch_size, initial_hidden, initial_cell);
         
         // Initialize output structure
-        LSTMOutput output;
-        output.sequence_output.resize(batch_size, 
-            std::vector<std::vector<float>>(seq_len, 
-                std::vector<float>(hidden_size)));
+        if (output) {
+            output->sequence_output.assign(batch_size, 
+                std::vector<std::vector<float>>(seq_len, 
+                    std::vector<float>(hidden_size)));
+        }
         
-        // Initialize or use provided states
-        if (!initial_hidden || !initial_cell) {
-            h_state.resize(num_layers);
-            c_state.resize(num_layers);
-            for (int layer = 0; layer < num_layers; ++layer) {
-                h_state[layer].resize(hidden_size, 0.0f);
-                c_state[layer].resize(hidden_size, 0.0f);
+        // Layer 0 input of every timestep, row t * batch_size + b
+        flat_input.resize(seq_len * batch_size * input_size);
+        for (size_t t = 0; t < seq_len; ++t) {
+            for (size_t batch = 0; batch < batch_size; ++batch) {
+                std::copy(x[batch][t].begin(), x[batch][t].end(),
+                          flat_input.begin() + (t * batch_size + batch) * input_size);
             }
-        } else {
-            h_state = *initial_hidden;
-            c_state = *initial_cell;
+        }
+        run_batch(batch_size, seq_len, output);
+        
+        // Final states are those of the last sequence in the batch
+        for (int layer = 0; layer < num_layers; ++layer) {
+            const float* h_row = batch_h_state[layer].row(batch_size - 1);
+            const float* c_row = batch_c_state[layer].row(batch_size - 1);
+            h_state[layer].assign(h_row, h_row + hidden_size);
+            c_state[layer].assign(c_row, c_row + hidden_size);
         }
         
-        // Process each batch and timestep
+    } catch (const std::exception& e) {
+        throw;
+    }
+}
+
+void LSTMPredictor::begin_batch(size_t batch_size,
+                                const std::vector<std::vector<float>>* initial_hidden,
+                                const std::vector<std::vector<float>>* initial_cell) {
+    // Per-batch workspaces: one row per sequence in the batch
+    if (gates_buf.size() < batch_size * 4 * hidden_size) {
+        gates_buf.resize(batch_size * 4 * hidden_size);
+    }
+    batch_h_state.resize(num_layers);
+    batch_c_state.resize(num_layers);
+    for (int layer = 0; layer < num_layers; ++layer) {
+        if (batch_h_state[layer].rows() != batch_size) {
+            batch_h_state[layer].resize(batch_size, hidden_size);
+            batch_c_state[layer].resize(batch_size, hidden_size);
+        }
+    }
+    
+    // Every sequence in the batch starts from zero state, or from the
+    // provided states
+    for (int layer = 0; layer < num_layers; ++layer) {
         for (size_t batch = 0; batch < batch_size; ++batch) {
-            current_batch = batch;  // Set unconditionally
-            
+            float* h_row = batch_h_state[layer].row(batch);
+            float* c_row = batch_c_state[layer].row(batch);
             if (!initial_hidden || !initial_cell) {
-                reset_states();
+                std::fill(h_row, h_row + hidden_size, 0.0f);
+                std::fill(c_row, c_row + hidden_size, 0.0f);
+            } else {
+                std::copy((*initial_hidden)[layer].begin(), (*initial_hidden)[layer].end(), h_row);
+                std::copy((*initial_cell)[layer].begin(), (*initial_cell)[layer].end(), c_row);
             }
+        }
+    }
+}
+
+void LSTMPredictor::run_batch(size_t batch_size, size_t seq_len, LSTMOutput* output) {
+    // Layer 0 projection through weight_ih for the whole window at once
+    const Matrix& projected = project_input(flat_input.data(), batch_size, seq_len, nullptr);
+    
+    // Timestep by timestep, each layer advances the whole batch at once
+    for (size_t t = 0; t < seq_len; ++t) {
+        current_timestep = t;
+        
+        // Each layer reads the hidden states the layer below just wrote
+        for (int layer = 0; layer < num_layers; ++layer) {
+            current_layer = layer;
             
-            for (size_t t = 0; t < seq_len; ++t) {
-                current_timestep = t;
-                
-                std::vector<float> layer_input = x[batch][t];
-                std::vector<std::vector<float>> layer_outputs(num_layers + 1);
-                layer_outputs[0] = layer_input;
-                
-                // Process through LSTM layers
-                for (int layer = 0; layer < num_layers; ++layer) {
-                    current_layer = layer;
-                    
-                    // Get correct input size for this layer
-                    int expected_input_size = (layer == 0) ? input_size : hidden_size;
-                    
-                    // Verify dimensions before forward pass
-                    if (layer_outputs[layer].size() != expected_input_size) {
-                        throw std::runtime_error("Layer input dimension mismatch at layer " + 
-                                               std::to_string(static_cast<long long>(layer)));
-                    }
-                    
-                    layer_outputs[layer + 1] = lstm_cell_forward(
-                        layer_outputs[layer],
-                        h_state[layer],
-                        c_state[layer],
-                        lstm_layers[layer]
-                    );
-                    
+            if (layer == 0) {
+                lstm_cell_forward(
+                    flat_input.data() + t * batch_size * input_size,
+                    input_size,
+                    input_size,
+                    batch_h_state[0].data(),
+                    batch_c_state[0].data(),
+                    batch_h_state[0].stride(),
+                    batch_size,
+                    layers()[0],
+                    nullptr,
+                    projected.row(t * batch_size),
+                    projected.stride()
+                );
+            } else {
+                const Matrix& layer_input = batch_h_state[layer - 1];
+                lstm_cell_forward(
+                    layer_input.data(),
+                    layer_input.cols(),
+                    layer_input.stride(),
+                    batch_h_state[layer].data(),
+                    batch_c_state[layer].data(),
+                    batch_h_state[layer].stride(),
+                    batch_size,
+                    layers()[layer]
+                );
+            }
+        }
+        
+        const Matrix& top = batch_h_state[num_layers - 1];
+        for (size_t batch = 0; output && batch < batch_size; ++batch) {
+            std::copy(top.row(batch), top.row(batch) + hidden_size,
+                      output->sequence_output[batch][t].begin());
+        }
+    }
+}
+
+void LSTMPredictor::share_backbone(LSTMPredictor& owner) {
+    if (owner.input_size != input_size || owner.hidden_size != hidden_size ||
+        owner.num_layers != num_layers) {
+        throw std::invalid_argument("share_backbone: models have different LSTM shapes");
+    }
+    if (owner.backbone == backbone) {
+        return;
+    }
+    backbone = owner.backbone;
+    fc_weight = owner.fc_weight;
+    fc_bias = owner.fc_bias;
+    ++weights_version;
+    tape.clear();
+}
+
+void LSTMPredictor::retie_backbone(LSTMPredictor& owner) {
+    if (!has_backbone_weights_of(owner)) {
+        throw std::invalid_argument("retie_backbone: models have different LSTM weights");
+    }
+    if (owner.backbone == backbone) {
+        return;
+    }
+    backbone = owner.backbone;
+    ++weights_version;
+    tape.clear();
+}
+
+bool LSTMPredictor::has_backbone_weights_of(const LSTMPredictor& owner) const {
+    if (owner.input_size != input_size || owner.hidden_size != hidden_size ||
+        owner.num_layers != num_layers) {
+        return false;
+    }
+    auto same = [](const Matrix& a, const Matrix& b) {
+        for (size_t r = 0; r < a.rows(); ++r) {
+            if (!std::equal(a.row(r), a.row(r) + a.cols(), b.row(r))) {
+                return false;
+            }
+        }
+        return true;
+    };
+    for (int layer = 0; layer < num_layers; ++layer) {
+        const LSTMLayer& a = layers()[layer];
+        const LSTMLayer& b = owner.layers()[layer];
+        if (!same(a.weight_ih, b.weight_ih) || !same(a.weight_hh, b.weight_hh) ||
+            a.bias_ih != b.bias_ih || a.bias_hh != b.bias_hh) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void LSTMPredictor::unshare_backbone() {
+    if (backbone.use_count() > 1) {
+        backbone = std::make_shared<std::vector<LSTMLayer>>(*backbone);
+    }
+}
+
+void LSTMPredictor::infer_tied(const std::vector<LSTMPredictor*>& models, const float* x,
+                               size_t seq_len, float* out) {
+    const size_t batch_size = models.size();
+    if (batch_size == 0) {
+        return;
+    }
+    for (const LSTMPredictor* model : models) {
+        if (model->backbone != backbone || model->num_classes != num_classes) {
+            throw std::invalid_argument("infer_tied: model is not tied to this backbone");
+        }
+    }
+    
+    reset_states();
+    bool was_training = training_mode;
+    training_mode = false;  // never touch the training cache from here
+    
+    begin_batch(batch_size, nullptr, nullptr);
+    // x holds the sequences one after the other, the engine wants row t * batch + b
+    flat_input.resize(seq_len * batch_size * input_size);
+    for (size_t batch = 0; batch < batch_size; ++batch) {
+        for (size_t t = 0; t < seq_len; ++t) {
+            const float* step = x + (batch * seq_len + t) * input_size;
+            std::copy(step, step + input_size, flat_input.begin() + (t * batch_size + batch) * input_size);
+        }
+    }
+    run_batch(batch_size, seq_len, nullptr);
+    
+    training_mode = was_training;
+    
+    // Every model reads the shared hidden state through its own head
+    const Matrix& top = batch_h_state[num_layers - 1];
+    for (size_t batch = 0; batch < batch_size; ++batch) {
+        models[batch]->compute_fc_output(top.row(batch), out + batch * num_classes);
+    }
+}
+
+size_t LSTMPredictor::packed_floats() const {
+    // Blocks start on a cache line
+    const size_t floats = packed_offset(num_layers, false);
+    return (floats + 15) / 16 * 16;
+}
+
+size_t LSTMPredictor::packed_offset(int layer, bool recurrent) const {
+    // Per layer weight_ih, then weight_hh, rows padded as in Matrix
+    const size_t gates = 4 * hidden_size;
+    const size_t hh = gates * Matrix::padded_stride(hidden_size);
+    size_t offset = 0;
+    for (int l = 0; l < layer; ++l) {
+        offset += gates * Matrix::padded_stride(l == 0 ? input_size : hidden_size) + hh;
+    }
+    if (recurrent) {
+        offset += gates * Matrix::padded_stride(layer == 0 ? input_size : hidden_size);
+    }
+    return offset;
+}
+
+void LSTMPredictor::pack_weights(float* block, const std::shared_ptr<void>& owner) {
+    for (int layer = 0; layer < num_layers; ++layer) {
+        for (bool recurrent : {false, true}) {
+            Matrix& w = recurrent ? layers()[layer].weight_hh : layers()[layer].weight_ih;
+            float* dst = block + packed_offset(layer, recurrent);
+            if (w.data() == dst) {
+                continue;
+            }
+            for (size_t r = 0; r < w.rows(); ++r) {
+                std::copy(w.row(r), w.row(r) + w.cols(), dst + r * w.stride());
+            }
+            w.attach(dst, w.rows(), w.cols(), owner);
+        }
+    }
+}
+
+bool LSTMPredictor::is_packed_at(const float* block) const {
+    for (int layer = 0; layer < num_layers; ++layer) {
+        if (layers()[layer].weight_ih.data() != block + packed_offset(layer, false) ||
+            layers()[layer].weight_hh.data() != block + packed_offset(layer, true)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void LSTMPredictor::infer_packed(const std::vector<LSTMPredictor*>& models, const float* base,
+                                 const std::vector<size_t>& slots, const float* x, size_t seq_len,
+                                 float* out) {
+    const size_t count = models.size();
+    if (count == 0) {
+        return;
+    }
+    const size_t block = packed_floats();
+    for (size_t k = 0; k < count; ++k) {
+        const LSTMPredictor& m = *models[k];
+        if (m.input_size != input_size || m.hidden_size != hidden_size ||
+            m.num_layers != num_layers || m.num_classes != num_classes ||
+            m.inference_precision != InferencePrecision::Float32 ||
+            !m.is_packed_at(base + slots[k] * block)) {
+            throw std::invalid_argument("infer_packed: model is not packed at its slot");
+        }
+    }
+    
+    begin_batch(count, nullptr, nullptr);
+    const size_t gate_stride = 4 * hidden_size;
+    float* gates_all = gates_buf.data();
+    float* tanh_c = cell_tanh_buf.data();
+    
+    // Layer 0 input terms (biases included) through each model's own
+    // projection cache, as infer() does
+    packed_projections.resize(count);
+    for (size_t k = 0; k < count; ++k) {
+        packed_projections[k] = &models[k]->project_input(x + k * seq_len * input_size, 1, seq_len, nullptr);
+    }
+    
+    for (size_t t = 0; t < seq_len; ++t) {
+        for (int layer = 0; layer < num_layers; ++layer) {
+            Matrix& h = batch_h_state[layer];
+            Matrix& c = batch_c_state[layer];
+            for (size_t k = 0; k < count; ++k) {
+                float* gates = gates_all + k * gate_stride;
+                if (layer == 0) {
+                    const float* p = packed_projections[k]->row(t);
+                    std::copy(p, p + gate_stride, gates);
+                } else {
+                    models[k]->fill_gate_biases(models[k]->layers()[layer], gates, gate_stride, 1);
                 }
+            }
+            if (layer > 0) {
+                const Matrix& below = batch_h_state[layer - 1];
+                gemv_accumulate_grouped(base + packed_offset(layer, false), gate_stride, hidden_size,
+                                        block, slots.data(), count,
+                                        below.data(), below.stride(), gates_all, gate_stride);
+            }
+            gemv_accumulate_grouped(base + packed_offset(layer, true), gate_stride, hidden_size,
+                                    block, slots.data(), count,
+                                    h.data(), h.stride(), gates_all, gate_stride);
+            
+            for (size_t k = 0; k < count; ++k) {
+                const Activation act = models[k]->activation;
+                float* gates = gates_all + k * gate_stride;
+                float* h_k = h.row(k);
+                float* c_k = c.row(k);
+                apply_sigmoid(gates, gates, 2 * hidden_size, act);
+                apply_tanh(gates + 2 * hidden_size, gates + 2 * hidden_size, hidden_size, act);
+                apply_sigmoid(gates + 3 * hidden_size, gates + 3 * hidden_size, hidden_size, act);
                 
-                output.sequence_output[batch][t] = layer_outputs[num_layers];
+                const float* i_t = gates;
+                const float* f_t = gates + hidden_size;
+                const float* g_t = gates + 2 * hidden_size;
+                const float* o_t = gates + 3 * hidden_size;
+                for (int j = 0; j < hidden_size; ++j) {
+                    c_k[j] = f_t[j] * c_k[j] + i_t[j] * g_t[j];
+                }
+                apply_tanh(c_k, tanh_c, hidden_size, act);
+                for (int j = 0; j < hidden_size; ++j) {
+                    h_k[j] = o_t[j] * tanh_c[j];
+                }
             }
         }
-        
-        output.final_hidden = h_state;
-        output.final_cell = c_state;
-        
-        return output;
-        
-    } catch (const std::exception& e) {
-        throw;
+    }
+    
+    const Matrix& top = batch_h_state[num_layers - 1];
+    for (size_t k = 0; k < count; ++k) {
+        models[k]->compute_fc_output(top.row(k), out + k * num_classes);
     }
 }
 
+const std::vector<float>& LSTMPredictor::infer(const float* x, size_t seq_len) {
+    // Same math as forward() + get_final_prediction() for a single sequence
+    // starting from zero state, but working entirely in preallocated buffers
+    reset_states();
+
+    if (uses_fixed_shape_inference()) {
+        fixed_infer(*this, x, seq_len);
+        return fc_output;
+    }
+
+    bool was_training = training_mode;
+    training_mode = false;  // never touch the training cache from here
+
+    const bool use_int8 = inference_precision == InferencePrecision::Int8;
+    if (use_int8 && (quantized_layers.empty() || quantized_version != weights_version)) {
+        update_quantized_weights();
+    }
+
+    const Matrix& projected = project_input(x, 1, seq_len, use_int8 ? &quantized_layers[0] : nullptr);
+
+    for (size_t t = 0; t < seq_len; ++t) {
+        for (int layer = 0; layer < num_layers; ++layer) {
+            current_layer = layer;
+            const QuantizedLayer* quantized = use_int8 ? &quantized_layers[layer] : nullptr;
+            if (layer == 0) {
+                lstm_cell_forward(x + t * input_size, input_size, input_size,
+                                  h_state[0].data(), c_state[0].data(), hidden_size,
+                                  1, layers()[0], quantized,
+                                  projected.row(t), projected.stride());
+            } else {
+                lstm_cell_forward(h_state[layer - 1].data(), hidden_size, hidden_size,
+                                  h_state[layer].data(), c_state[layer].data(), hidden_size,
+                                  1, layers()[layer], quantized);
+            }
+        }
+    }
+
+    training_mode = was_training;
+
+    const std::vector<float>& last_hidden = h_state[num_layers - 1];
+    for (int i = 0; i < num_classes; ++i) {
+        fc_output[i] = fc_bias[i];
+        for (int j = 0; j < hidden_size; ++j) {
+            fc_output[i] += fc_weight.row(i)[j] * last_hidden[j];
+        }
+    }
+    return fc_output;
+}
+
+size_t LSTMPredictor::inference_weight_bytes() const {
+    size_t bytes = 0;
+    for (const auto& layer : layers()) {
+        for (const Matrix* w : {&layer.weight_ih, &layer.weight_hh}) {
+            if (inference_precision == InferencePrecision::Int8) {
+                bytes += QuantizedMatrix::memory_bytes(w->rows(), w->cols());
+            } else {
+                bytes += w->rows() * w->stride() * sizeof(float);
+            }
+        }
+    }
+    return bytes;
+}
+
+void LSTMPredictor::update_quantized_weights() {
+    quantized_layers.resize(num_layers);
+    for (int layer = 0; layer < num_layers; ++layer) {
+        quantized_layers[layer].weight_ih.quantize(layers()[layer].weight_ih);
+        quantized_layers[layer].weight_hh.quantize(layers()[layer].weight_hh);
+    }
+    quantized_version = weights_version;
+}
+
 // Setter methods for loading trained weights
 void LSTMPredictor::set_lstm_weights(int layer, 
                                    const std::vector<std::vector<float>>& w_ih,
                                    const std::vector<std::vector<float>>& w_hh) {
     if (layer < num_layers) {
-        lstm_layers[layer].weight_ih = w_ih;
-        lstm_layers[layer].weight_hh = w_hh;
+        unshare_backbone();
+        layers()[layer].weight_ih.assign(w_ih);
+        layers()[layer].weight_hh.assign(w_hh);
+        ++weights_version;
     }
 }
 
@@ -318,48 +698,42 @@ void LSTMPredictor::set_lstm_bias(int layer,
                                  const std::vector<float>& b_ih,
                                  const std::vector<float>& b_hh) {
     if (layer < num_layers) {
-        lstm_layers[layer].bias_ih = b_ih;
-        lstm_layers[layer].bias_hh = b_hh;
+        unshare_backbone();
+        layers()[layer].bias_ih = b_ih;
+        layers()[layer].bias_hh = b_hh;
+        ++weights_version;
     }
 }
 
 void LSTMPredictor::set_fc_weights(const std::vector<std::vector<float>>& weights,
                                   const std::vector<float>& bias) {
-    fc_weight = weights;
+    fc_weight.assign(weights);
     fc_bias = bias;
+    ++weights_version;
 }
 
 void LSTMPredictor::backward_linear_layer(
     const std::vector<float>& grad_output,
-    const std::vector<float>& last_hidden,
-    std::vector<std::vector<float>>& weight_grad,
+    const float* last_hidden,
+    Matrix& weight_grad,
     std::vector<float>& bias_grad,
-    std::vector<float>& input_grad) {
+    float* input_grad) {
     
-    // Check dimensions
-    if (grad_output.size() != num_classes) {
-        throw std::invalid_argument(
-            "grad_output size mismatch: " + std::to_string(grad_output.size()) +
-            " != " + std::to_string(num_classes)
-        );
-    }
+    LSTM_DEBUG_CHECK(grad_output.size() == static_cast<size_t>(num_classes),
+                     "grad_output size mismatch in backward_linear_layer");
     
-    if (last_hidden.size() != hidden_size) {
-        throw std::invalid_argument(
-            "last_hidden size mismatch: " + std::to_string(last_hidden.size()) +
-            " != " + std::to_string(hidden_size)
-        );
+    // Weight and bias gradients accumulate, so a mini-batch sums over its samples
+    if (weight_grad.rows() != static_cast<size_t>(num_classes) ||
+        weight_grad.cols() != static_cast<size_t>(hidden_size)) {
+        weight_grad.resize(num_classes, hidden_size);
     }
-    
-    // Initialize gradients with correct dimensions
-    weight_grad.resize(num_classes, std::vector<float>(hidden_size, 0.0f));
-    bias_grad = grad_output;  // Copy gradient directly for bias
-    input_grad.resize(hidden_size, 0.0f);
+    bias_grad.resize(num_classes, 0.0f);
     
     // Compute weight gradients
     for (int i = 0; i < num_classes; ++i) {
+        bias_grad[i] += grad_output[i];
         for (int j = 0; j < hidden_size; ++j) {
-            weight_grad[i][j] = grad_output[i] * last_hidden[j];
+            weight_grad[i][j] += grad_output[i] * last_hidden[j];
         }
     }
     
@@ -373,131 +747,138 @@ void LSTMPredictor::backward_linear_layer(
     }
 }
 
-std::vector<LSTMPredictor::LSTMGradients> LSTMPredictor::backward_lstm_layer(
-    const std::vector<float>& grad_output,
-    const std::vector<std::vector<std::vector<LSTMCacheEntry>>>& cache,
+const std::vector<LSTMPredictor::LSTMGradients>& LSTMPredictor::backward_lstm_layer(
+    const Matrix& grad_output,
+    const ActivationTape& cache,
     float learning_rate) {
     
-    // Add dimension validation
-    if (grad_output.size() != hidden_size) {
-        throw std::runtime_error("grad_output size mismatch in backward_lstm_layer");
-    }
-    
-    // Add cache validation
-    if (cache.size() != num_layers) {
-        throw std::runtime_error("cache layer count mismatch in backward_lstm_layer");
-    }
-    
-    std::vector<LSTMGradients> layer_grads(num_layers);
+    LSTM_DEBUG_CHECK(grad_output.rows() == cache.batch_size,
+                     "grad_output batch size mismatch in backward_lstm_layer");
+    LSTM_DEBUG_CHECK(grad_output.cols() == static_cast<size_t>(hidden_size),
+                     "grad_output size mismatch in backward_lstm_layer");
+    LSTM_DEBUG_CHECK(cache.num_layers == static_cast<size_t>(num_layers),
+                     "cache layer count mismatch in backward_lstm_layer");
     
-    // Initialize gradients for each layer
+    // Gradients accumulate in last_gradients, zeroed in place once sized. The
+    // weight gradients are big enough that malloc would mmap and unmap them
+    // on every training step, page faulting them back in each time
+    std::vector<LSTMGradients>& layer_grads = last_gradients;
+    layer_grads.resize(num_layers);
     for (int layer = 0; layer < num_layers; ++layer) {
         int input_size_layer = (layer == 0) ? input_size : hidden_size;
-        layer_grads[layer].weight_ih_grad.resize(4 * hidden_size, 
-            std::vector<float>(input_size_layer, 0.0f));
-        layer_grads[layer].weight_hh_grad.resize(4 * hidden_size, 
-            std::vector<float>(hidden_size, 0.0f));
-        layer_grads[layer].bias_ih_grad.resize(4 * hidden_size, 0.0f);
-        layer_grads[layer].bias_hh_grad.resize(4 * hidden_size, 0.0f);
-
+        LSTMGradients& grads = layer_grads[layer];
+        if (grads.weight_ih_grad.rows() != static_cast<size_t>(4 * hidden_size) ||
+            grads.weight_ih_grad.cols() != static_cast<size_t>(input_size_layer)) {
+            grads.weight_ih_grad.resize(4 * hidden_size, input_size_layer);
+            grads.weight_hh_grad.resize(4 * hidden_size, hidden_size);
+        } else {
+            grads.weight_ih_grad.fill(0.0f);
+            grads.weight_hh_grad.fill(0.0f);
+        }
+        grads.bias_ih_grad.assign(4 * hidden_size, 0.0f);
+        grads.bias_hh_grad.assign(4 * hidden_size, 0.0f);
     }
     
-    // Initialize dh_next and dc_next for each layer
-    std::vector<std::vector<float>> dh_next(num_layers, std::vector<float>(hidden_size, 0.0f));
-    std::vector<std::vector<float>> dc_next(num_layers, std::vector<float>(hidden_size, 0.0f));
-    
-    // Start from the last layer and move backward
-    for (int layer = num_layers - 1; layer >= 0; --layer) {
-
-        std::vector<float> dh = dh_next[layer];
-        std::vector<float> dc = dc_next[layer];
-        
-        // Add bounds checking before accessing cache
-        if (current_batch >= cache[layer].size()) {
-            throw std::runtime_error("Cache batch index out of bounds");
-        }
-        
-        const auto& layer_cache = cache[layer][current_batch];
-        
-        // If this is the last layer, add grad_output (like dy @ Wy.T in PyTorch)
-        if (layer == num_layers - 1) {
-            for (int h = 0; h < hidden_size; ++h) {
-                dh[h] += grad_output[h];
+    // Gradient of the loss w.r.t. the current layer's output h_t at every
+    // timestep, [t][hidden_size]; filled by the layer above as W_ih^T d_gates
+    const size_t seq_len = cache.seq_len;
+    std::vector<float>& output_grad = backward_bufs.output_grad;
+    std::vector<float>& below_grad = backward_bufs.below_grad;
+    output_grad.resize(seq_len * hidden_size);
+    below_grad.resize(seq_len * hidden_size);
+
+    // Recurrent gradients from the following timestep, and per-timestep work
+    // buffers; all of them are cleared or fully rewritten before use
+    std::vector<float>& dh = backward_bufs.dh;
+    std::vector<float>& dc = backward_bufs.dc;
+    std::vector<float>& d_gates = backward_bufs.d_gates;
+    std::vector<float>& dh_prev = backward_bufs.dh_prev;
+    std::vector<float>& dc_prev = backward_bufs.dc_prev;
+    std::vector<float>& tanh_cell = backward_bufs.tanh_cell;
+
+    // Every sequence of the batch is backpropagated separately; the weight
+    // gradients accumulate over the batch
+    for (size_t batch = 0; batch < cache.batch_size; ++batch) {
+        // Only the last hidden state of the top layer feeds the FC head
+        std::fill(output_grad.begin(), output_grad.end(), 0.0f);
+        std::copy(grad_output.row(batch), grad_output.row(batch) + hidden_size,
+                  output_grad.begin() + (seq_len - 1) * hidden_size);
+
+        // Start from the last layer and move backward
+        for (int layer = num_layers - 1; layer >= 0; --layer) {
+            std::fill(dh.begin(), dh.end(), 0.0f);
+            std::fill(dc.begin(), dc.end(), 0.0f);
+            if (layer > 0) {
+                std::fill(below_grad.begin(), below_grad.end(), 0.0f);
             }
-        }
-
-        // Process each time step in reverse order
-        for (int t = layer_cache.size() - 1; t >= 0; --t) {
-
-            const auto& cache_entry = layer_cache[t];
-            
-            std::vector<float> dh_prev(hidden_size, 0.0f);
-            std::vector<float> dc_prev(hidden_size, 0.0f);
 
-            // Process each hidden unit
-            for (int h = 0; h < hidden_size; ++h) {
-                float tanh_c = tanh_custom(cache_entry.cell_state[h]);
-                float dho = dh[h];
-                
-                // 1. Cell state gradient
-                float dc_t = dho * cache_entry.output_gate[h] * (1.0f - tanh_c * tanh_c);
-                dc_t += dc[h];  // Add gradient from future timestep
+            LSTMGradients& grads = layer_grads[layer];
+            const Matrix& weight_ih = layers()[layer].weight_ih;
+            const Matrix& weight_hh = layers()[layer].weight_hh;
+
+            // Process each time step in reverse order
+            for (int t = static_cast<int>(seq_len) - 1; t >= 0; --t) {
+
+                const size_t row = cache.step(layer, batch, t);
+                const float* input_gate = cache.input_gate.row(row);
+                const float* forget_gate = cache.forget_gate.row(row);
+                const float* cell_gate = cache.cell_gate.row(row);
+                const float* output_gate = cache.output_gate.row(row);
+                const float* cell_state = cache.cell_state.row(row);
+                const float* prev_cell = cache.prev_cell.row(row);
+                const float* from_above = output_grad.data() + t * hidden_size;
+
+                apply_tanh(cell_state, tanh_cell.data(), hidden_size, activation);
+
+                // 1-2. Cell state and gate gradients for every hidden unit, laid out
+                // like the stacked [i,f,g,o] weight rows
+                for (int h = 0; h < hidden_size; ++h) {
+                    float tanh_c = tanh_cell[h];
+                    float dho = dh[h] + from_above[h];
                 
-                // 2. Gate gradients
-                float do_t = dho * tanh_c * cache_entry.output_gate[h] * (1.0f - cache_entry.output_gate[h]);
-                float di_t = dc_t * cache_entry.cell_gate[h] * cache_entry.input_gate[h] * (1.0f - cache_entry.input_gate[h]);
-                float df_t = dc_t * cache_entry.prev_cell[h] * cache_entry.forget_gate[h] * (1.0f - cache_entry.forget_gate[h]);
-                float dg_t = dc_t * cache_entry.input_gate[h] * (1.0f - cache_entry.cell_gate[h] * cache_entry.cell_gate[h]);
+                    float dc_t = dho * output_gate[h] * (1.0f - tanh_c * tanh_c);
+                    dc_t += dc[h];  // Add gradient from future timestep
                 
+                    d_gates[h] = dc_t * cell_gate[h] * input_gate[h] * (1.0f - input_gate[h]);
+                    d_gates[hidden_size + h] = dc_t * prev_cell[h] * forget_gate[h] * (1.0f - forget_gate[h]);
+                    d_gates[2 * hidden_size + h] = dc_t * input_gate[h] * (1.0f - cell_gate[h] * cell_gate[h]);
+                    d_gates[3 * hidden_size + h] = dho * tanh_c * output_gate[h] * (1.0f - output_gate[h]);
 
-                // 3. Accumulate weight gradients
-                int input_size_layer = (layer == 0) ? input_size : hidden_size;
-                for (int j = 0; j < input_size_layer; ++j) {
-                    float input_j = cache_entry.input[j];
-                    layer_grads[layer].weight_ih_grad[h][j] += di_t * input_j;
-                    layer_grads[layer].weight_ih_grad[hidden_size + h][j] += df_t * input_j;
-                    layer_grads[layer].weight_ih_grad[2 * hidden_size + h][j] += dg_t * input_j;
-                    layer_grads[layer].weight_ih_grad[3 * hidden_size + h][j] += do_t * input_j;
+                    // Cell state gradient for previous timestep
+                    dc_prev[h] = dc_t * forget_gate[h];
                 }
-                
-                // 4. Accumulate hidden-hidden weight gradients
-                for (int j = 0; j < hidden_size; ++j) {
-                    float h_prev_j = cache_entry.prev_hidden[j];
-                    layer_grads[layer].weight_hh_grad[h][j] += di_t * h_prev_j;
-                    layer_grads[layer].weight_hh_grad[hidden_size + h][j] += df_t * h_prev_j;
-                    layer_grads[layer].weight_hh_grad[2 * hidden_size + h][j] += dg_t * h_prev_j;
-                    layer_grads[layer].weight_hh_grad[3 * hidden_size + h][j] += do_t * h_prev_j;
-                    
-                    // Accumulate gradients for next timestep's hidden state
-                    dh_prev[j] += di_t * lstm_layers[layer].weight_hh[h][j];
-                    dh_prev[j] += df_t * lstm_layers[layer].weight_hh[hidden_size + h][j];
-                    dh_prev[j] += dg_t * lstm_layers[layer].weight_hh[2 * hidden_size + h][j];
-                    dh_prev[j] += do_t * lstm_layers[layer].weight_hh[3 * hidden_size + h][j];
+
+                // 3-4. Rank-1 updates of the weight gradients
+                ger_accumulate(grads.weight_ih_grad, d_gates.data(), cache.input.row(row));
+                ger_accumulate(grads.weight_hh_grad, d_gates.data(), cache.prev_hidden.row(row));
+
+                // 5. Accumulate bias gradients; both biases enter the gates the same way
+                for (int k = 0; k < 4 * hidden_size; ++k) {
+                    grads.bias_ih_grad[k] += d_gates[k];
+                    grads.bias_hh_grad[k] += d_gates[k];
+                }
+
+                // Gradient for the previous timestep's hidden state: W_hh^T * d_gates
+                std::fill(dh_prev.begin(), dh_prev.end(), 0.0f);
+                gemv_transposed_accumulate(weight_hh, d_gates.data(), dh_prev.data());
+
+                // and for the layer below's output at this timestep: W_ih^T * d_gates
+                if (layer > 0) {
+                    gemv_transposed_accumulate(weight_ih, d_gates.data(), below_grad.data() + t * hidden_size);
                 }
-                
-                // 5. Accumulate bias gradients
-                layer_grads[layer].bias_ih_grad[h] += di_t;
-                layer_grads[layer].bias_ih_grad[hidden_size + h] += df_t;
-                layer_grads[layer].bias_ih_grad[2 * hidden_size + h] += dg_t;
-                layer_grads[layer].bias_ih_grad[3 * hidden_size + h] += do_t;
-                
-                // 6. Cell state gradient for previous timestep
-                dc_prev[h] = dc_t * cache_entry.forget_gate[h];
-            }
             
-            // Update gradients for next timestep
-            dh = dh_prev;
-            dc = dc_prev;
-        }
+                // Update gradients for next timestep
+                dh.swap(dh_prev);
+                dc.swap(dc_prev);
+            }
         
-        // Pass gradients to next layer
-        if (layer > 0) {
-            dh_next[layer - 1] = dh;
-            dc_next[layer - 1] = dc;
+            // The layer below continues with the gradients of its outputs
+            if (layer > 0) {
+                output_grad.swap(below_grad);
+            }
         }
     }
     
-    last_gradients = layer_grads;
     return layer_grads;
 }
 
@@ -507,100 +888,155 @@ void LSTMPredictor::train_step(const std::vector<std::vector<std::vector<float>>
                               const LSTMOutput& lstm_output,
                               float learning_rate) {
     try {
-        // Add detailed dimension checking for each sequence step
-        for (size_t batch = 0; batch < x.size(); ++batch) {
-            for (size_t seq = 0; seq < x[batch].size(); ++seq) {
-                if (x[batch][seq].size() != input_size) {
-                    throw std::runtime_error(
-                        "Input sequence dimension mismatch in train_step: batch " + 
-                        std::to_string(batch) + ", seq " + std::to_string(seq));
-                }
-            }
-        }
+        check_input(x);
+        check_target(x, target);
         
-        // Verify input dimensions
-        if (x.empty() || x[0].empty() || x[0][0].empty()) {
-            throw std::runtime_error("Empty input tensor");
-        }
-        if (x[0][0].size() != input_size) {
-            throw std::runtime_error("Input feature size mismatch");
+        const size_t batch_size = x.size();
+        if (lstm_output.sequence_output.size() != batch_size) {
+            throw std::invalid_argument("LSTM output batch size mismatch");
         }
         
-        // Verify target dimensions
-        if (target.size() != num_classes) {
-            throw std::invalid_argument("Target size mismatch");
+        // Predictions and last hidden states, one row per sequence
+        Matrix predictions(batch_size, num_classes);
+        Matrix last_hidden(batch_size, hidden_size);
+        for (size_t batch = 0; batch < batch_size; ++batch) {
+            const auto& hidden = lstm_output.sequence_output[batch].back();
+            std::copy(hidden.begin(), hidden.end(), last_hidden.row(batch));
+            compute_fc_output(last_hidden.row(batch), predictions.row(batch));
         }
-        
-        // Get final prediction (no forward pass needed)
-        auto output = get_final_prediction(lstm_output);
+        backward_and_update(target, predictions, last_hidden, learning_rate);
 
-        // Compute gradients
-        auto grad_output = compute_mse_loss_gradient(output, target);
-
-        // Extract final hidden state
-        const auto& last_hidden = lstm_output.final_hidden.back();
+    } catch (const std::exception& e) {
+        throw;
+    }
+}
 
-        // Backward pass through linear layer
-        std::vector<std::vector<float>> fc_weight_grad;
-        std::vector<float> fc_bias_grad;
-        std::vector<float> lstm_grad;
-        backward_linear_layer(grad_output, last_hidden, fc_weight_grad, fc_bias_grad, lstm_grad);
+float LSTMPredictor::train_step(const std::vector<std::vector<std::vector<float>>>& x,
+                                const std::vector<float>& target,
+                                float learning_rate,
+                                float stop_above) {
+    check_input(x);
+    check_target(x, target);
+    return train_step_unchecked(x, target, learning_rate, stop_above);
+}
 
-        // Verify FC layer dimensions for SGD
-        if (fc_weight.size() != fc_weight_grad.size() || 
-            (fc_weight.size() > 0 && fc_weight[0].size() != fc_weight_grad[0].size())) {
-            throw std::runtime_error("Dimension mismatch in FC layer gradients");
+float LSTMPredictor::train_step_unchecked(const std::vector<std::vector<std::vector<float>>>& x,
+                                          const std::vector<float>& target,
+                                          float learning_rate,
+                                          float stop_above) {
+#ifdef ADAPAD_DEBUG_CHECKS
+    check_input(x);
+    check_target(x, target);
+#endif
+    // forward_batch leaves the top layer's final hidden states in
+    // batch_h_state, which is all the FC layer and its gradient need
+    forward_batch(x, nullptr, nullptr, nullptr);
+    const size_t batch_size = x.size();
+    const Matrix& last_hidden = batch_h_state[num_layers - 1];
+    if (fc_batch_output.rows() != batch_size) {
+        fc_batch_output.resize(batch_size, num_classes);
+    }
+    
+    float loss = 0.0f;
+    for (size_t batch = 0; batch < batch_size; ++batch) {
+        float* pred = fc_batch_output.row(batch);
+        compute_fc_output(last_hidden.row(batch), pred);
+        for (int i = 0; i < num_classes; ++i) {
+            float diff = pred[i] - target[batch * num_classes + i];
+            loss += diff * diff;
         }
+    }
+    loss /= static_cast<float>(batch_size * num_classes);
+    
+    if (loss > stop_above) {
+        return loss;
+    }
+    backward_and_update(target, fc_batch_output, last_hidden, learning_rate);
+    return loss;
+}
 
-        // Apply SGD updates to FC layer
-        try {
-            apply_sgd_update(fc_weight, fc_weight_grad, learning_rate);
-
-            apply_sgd_update(fc_bias, fc_bias_grad, learning_rate);
-        } catch (const std::exception& e) {
-            throw;
+void LSTMPredictor::backward_and_update(const std::vector<float>& target,
+                                        const Matrix& predictions,
+                                        const Matrix& last_hidden,
+                                        float learning_rate) {
+    // Backward pass through linear layer for every sequence in the batch.
+    // The loss is the mean over the batch, so each sample's gradient is
+    // scaled by 1/batch_size and the FC gradients accumulate.
+    const size_t batch_size = predictions.rows();
+    Matrix& fc_weight_grad = backward_bufs.fc_weight_grad;
+    std::vector<float>& fc_bias_grad = backward_bufs.fc_bias_grad;
+    Matrix& lstm_grad = backward_bufs.lstm_grad;
+    std::vector<float>& grad_output = backward_bufs.loss_grad;
+    fc_weight_grad.fill(0.0f);
+    fc_bias_grad.assign(num_classes, 0.0f);
+    if (lstm_grad.rows() != batch_size) {
+        lstm_grad.resize(batch_size, hidden_size);
+    }
+    for (size_t batch = 0; batch < batch_size; ++batch) {
+        // MSE gradient of this sequence's prediction
+        const float* output = predictions.row(batch);
+        const float* sample_target = target.data() + batch * num_classes;
+        for (int i = 0; i < num_classes; ++i) {
+            grad_output[i] = 2.0f * (output[i] - sample_target[i]) / static_cast<float>(num_classes);
+            if (batch_size > 1) {
+                grad_output[i] /= static_cast<float>(batch_size);
+            }
         }
 
-        // Validate cache before LSTM backward pass
-        if (layer_cache.empty()) {
-            throw std::runtime_error("Empty layer cache");
-        }
+        // Final hidden state of the top layer for this sequence
+        backward_linear_layer(grad_output, last_hidden.row(batch), fc_weight_grad, fc_bias_grad, lstm_grad.row(batch));
+    }
 
-        // Verify lstm_grad dimensions
-        if (lstm_grad.size() != hidden_size) {
-            throw std::runtime_error("Invalid lstm_grad dimensions");
-        }
+    optimizer.begin_update();
+    optimizer.update(0, fc_weight, fc_weight_grad, learning_rate);
+    optimizer.update(1, fc_bias, fc_bias_grad, learning_rate);
+
+    // A shared backbone is frozen, only the FC head learns
+    if (!shares_backbone()) {
+        LSTM_DEBUG_CHECK(!tape.empty(), "Empty layer cache");
+        LSTM_DEBUG_CHECK(lstm_grad.rows() == tape.batch_size, "Invalid lstm_grad dimensions");
 
         // LSTM backward pass
-        auto lstm_grads = backward_lstm_layer(lstm_grad, layer_cache, learning_rate);
+        const auto& lstm_grads = backward_lstm_layer(lstm_grad, tape, learning_rate);
 
         // Apply Optimizer updates to LSTM layers
         for (int layer = 0; layer < num_layers; ++layer) {
-            try {
-                // Verify LSTM layer dimensions before updates
-                if (lstm_layers[layer].weight_ih.size() != lstm_grads[layer].weight_ih_grad.size()) {
-                    throw std::runtime_error("LSTM weight_ih dimension mismatch at layer " + 
-                                           std::to_string(layer));
-                }
-                
-                apply_sgd_update(lstm_layers[layer].weight_ih, lstm_grads[layer].weight_ih_grad, learning_rate);
-
-                apply_sgd_update(lstm_layers[layer].weight_hh, lstm_grads[layer].weight_hh_grad, learning_rate);
-
-                apply_sgd_update(lstm_layers[layer].bias_ih, lstm_grads[layer].bias_ih_grad, learning_rate);
-
-                apply_sgd_update(lstm_layers[layer].bias_hh, lstm_grads[layer].bias_hh_grad, learning_rate);
+            const size_t slot = layer_slot(layer);
+            optimizer.update(slot, layers()[layer].weight_ih, lstm_grads[layer].weight_ih_grad, learning_rate);
+            optimizer.update(slot + 1, layers()[layer].weight_hh, lstm_grads[layer].weight_hh_grad, learning_rate);
+            optimizer.update(slot + 2, layers()[layer].bias_ih, lstm_grads[layer].bias_ih_grad, learning_rate);
+            optimizer.update(slot + 3, layers()[layer].bias_hh, lstm_grads[layer].bias_hh_grad, learning_rate);
+        }
+    }
 
+    clear_temporary_cache();
+    ++weights_version;
+}
 
-            } catch (const std::exception& e) {
-                throw;
+void LSTMPredictor::check_input(const std::vector<std::vector<std::vector<float>>>& x) const {
+    if (x.empty() || x[0].empty()) {
+        throw std::invalid_argument("Empty input tensor");
+    }
+    const size_t seq_len = x[0].size();
+    for (size_t batch = 0; batch < x.size(); ++batch) {
+        if (x[batch].size() != seq_len) {
+            throw std::invalid_argument("Sequence length mismatch in batch " + std::to_string(batch));
+        }
+        for (size_t seq = 0; seq < seq_len; ++seq) {
+            if (x[batch][seq].size() != static_cast<size_t>(input_size)) {
+                throw std::invalid_argument("Input dimension mismatch: batch " + std::to_string(batch) +
+                    ", seq " + std::to_string(seq) + " has " + std::to_string(x[batch][seq].size()) +
+                    " values, model expects " + std::to_string(input_size));
             }
         }
+    }
+}
 
-        clear_temporary_cache();
-
-    } catch (const std::exception& e) {
-        throw;
+void LSTMPredictor::check_target(const std::vector<std::vector<std::vector<float>>>& x,
+                                 const std::vector<float>& target) const {
+    // num_classes values per sequence in the batch
+    if (target.size() != x.size() * num_classes) {
+        throw std::invalid_argument("Target size mismatch");
     }
 }
 
@@ -620,17 +1056,22 @@ float LSTMPredictor::compute_loss(const std::vector<float>& output,
 }
 
 std::vector<float> LSTMPredictor::get_final_prediction(const LSTMOutput& lstm_output) {
+    return get_final_prediction(lstm_output, lstm_output.sequence_output.size() - 1);
+}
+
+std::vector<float> LSTMPredictor::get_final_prediction(const LSTMOutput& lstm_output, size_t batch) {
     std::vector<float> final_output(num_classes, 0.0f);
-    const auto& final_hidden = lstm_output.sequence_output.back().back();
-    
+    compute_fc_output(lstm_output.sequence_output.at(batch).back().data(), final_output.data());
+    return final_output;
+}
+
+void LSTMPredictor::compute_fc_output(const float* hidden, float* out) const {
     for (int i = 0; i < num_classes; ++i) {
-        final_output[i] = fc_bias[i];
+        out[i] = fc_bias[i];
         for (int j = 0; j < hidden_size; ++j) {
-            final_output[i] += fc_weight[i][j] * final_hidden[j];
+            out[i] += fc_weight.row(i)[j] * hidden[j];
         }
     }
-    
-    return final_output;
 }
 
 void LSTMPredictor::initialize_weights() {
@@ -640,64 +1081,71 @@ void LSTMPredictor::initialize_weights() {
     std::mt19937 gen(random_seed);
 
     // Initialize FC layer first
-    fc_weight.resize(num_classes, std::vector<float>(hidden_size));
+    fc_weight.resize(num_classes, hidden_size);
     fc_bias.resize(num_classes);
     
     // Initialize FC weights and bias
     for (int i = 0; i < num_classes; ++i) {
         fc_bias[i] = 0.0f;  // PyTorch default
         for (int j = 0; j < hidden_size; ++j) {
-            fc_weight[i][j] = dist(gen);
+            fc_weight.row(i)[j] = dist(gen);
         }
     }
 
     // Initialize LSTM layers
-    lstm_layers.resize(num_layers);
+    unshare_backbone();
+    layers().resize(num_layers);
     for (int layer = 0; layer < num_layers; ++layer) {
         int input_size_layer = (layer == 0) ? input_size : hidden_size;
         
         // Initialize with PyTorch dimensions
-        lstm_layers[layer].weight_ih.resize(4 * hidden_size, 
-            std::vector<float>(input_size_layer));
-        lstm_layers[layer].weight_hh.resize(4 * hidden_size, 
-            std::vector<float>(hidden_size));
-        lstm_layers[layer].bias_ih.resize(4 * hidden_size);
-        lstm_layers[layer].bias_hh.resize(4 * hidden_size);
+        layers()[layer].weight_ih.resize(4 * hidden_size, input_size_layer);
+        layers()[layer].weight_hh.resize(4 * hidden_size, hidden_size);
+        layers()[layer].bias_ih.resize(4 * hidden_size);
+        layers()[layer].bias_hh.resize(4 * hidden_size);
         
         // Initialize weights and biases
         for (int i = 0; i < 4 * hidden_size; ++i) {
+            float* w_ih = layers()[layer].weight_ih.row(i);
+            float* w_hh = layers()[layer].weight_hh.row(i);
             for (int j = 0; j < input_size_layer; ++j) {
-                lstm_layers[layer].weight_ih[i][j] = dist(gen);
+                w_ih[j] = dist(gen);
             }
             for (int j = 0; j < hidden_size; ++j) {
-                lstm_layers[layer].weight_hh[i][j] = dist(gen);
+                w_hh[j] = dist(gen);
             }
-            lstm_layers[layer].bias_ih[i] = dist(gen);
-            lstm_layers[layer].bias_hh[i] = dist(gen);
+            layers()[layer].bias_ih[i] = dist(gen);
+            layers()[layer].bias_hh[i] = dist(gen);
         }
     }
+    ++weights_version;
 }
 
 
 void LSTMPredictor::set_weights(const std::vector<LSTMLayer>& weights) {
+    unshare_backbone();
     for (size_t layer = 0; layer < weights.size(); ++layer) {
-        // Deep copy weight_ih
-        lstm_layers[layer].weight_ih.resize(weights[layer].weight_ih.size());
-        for (size_t i = 0; i < weights[layer].weight_ih.size(); ++i) {
-            lstm_layers[layer].weight_ih[i] = weights[layer].weight_ih[i];
-        }
-        
-        // Deep copy weight_hh
-        lstm_layers[layer].weight_hh.resize(weights[layer].weight_hh.size());
-        for (size_t i = 0; i < weights[layer].weight_hh.size(); ++i) {
-            lstm_layers[layer].weight_hh[i] = weights[layer].weight_hh[i];
-        }
+        // Deep copy weight matrices (single block copy each)
+        layers()[layer].weight_ih = weights[layer].weight_ih;
+        layers()[layer].weight_hh = weights[layer].weight_hh;
         
         // Deep copy biases
-        lstm_layers[layer].bias_ih = weights[layer].bias_ih;
-        lstm_layers[layer].bias_hh = weights[layer].bias_hh;
+        layers()[layer].bias_ih = weights[layer].bias_ih;
+        layers()[layer].bias_hh = weights[layer].bias_hh;
         
     }
+    ++weights_version;
+}
+
+// Matrices are serialized as (rows, cols) followed by the unpadded row data
+static void save_matrix(std::ofstream& file, const Matrix& m) {
+    size_t rows = m.rows();
+    size_t cols = m.cols();
+    file.write(reinterpret_cast<const char*>(&rows), sizeof(size_t));
+    file.write(reinterpret_cast<const char*>(&cols), sizeof(size_t));
+    for (size_t r = 0; r < rows; ++r) {
+        file.write(reinterpret_cast<const char*>(m.row(r)), cols * sizeof(float));
+    }
 }
 
 void LSTMPredictor::save_weights(std::ofstream& file) {
@@ -705,35 +1153,14 @@ void LSTMPredictor::save_weights(std::ofstream& file) {
         // Save LSTM layer weights
         for (int layer = 0; layer < num_layers; ++layer) {
             // Save weight_ih dimensions and data
-            size_t ih_rows = lstm_layers[layer].weight_ih.size();
-            size_t ih_cols = lstm_layers[layer].weight_ih[0].size();
-            file.write(reinterpret_cast<const char*>(&ih_rows), sizeof(size_t));
-            file.write(reinterpret_cast<const char*>(&ih_cols), sizeof(size_t));
-            
-            for (const auto& row : lstm_layers[layer].weight_ih) {
-                file.write(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(float));
-            }
+            save_matrix(file, layers()[layer].weight_ih);
 
             // Save weight_hh dimensions and data
-            size_t hh_rows = lstm_layers[layer].weight_hh.size();
-            size_t hh_cols = lstm_layers[layer].weight_hh[0].size();
-            file.write(reinterpret_cast<const char*>(&hh_rows), sizeof(size_t));
-            file.write(reinterpret_cast<const char*>(&hh_cols), sizeof(size_t));
-            
-            for (const auto& row : lstm_layers[layer].weight_hh) {
-                file.write(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(float));
-            }
+            save_matrix(file, layers()[layer].weight_hh);
         }
 
         // Save FC layer weights
-        size_t fc_rows = fc_weight.size();
-        size_t fc_cols = fc_weight[0].size();
-        file.write(reinterpret_cast<const char*>(&fc_rows), sizeof(size_t));
-        file.write(reinterpret_cast<const char*>(&fc_cols), sizeof(size_t));
-        
-        for (const auto& row : fc_weight) {
-            file.write(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(float));
-        }
+        save_matrix(file, fc_weight);
     } catch (const std::exception& e) {
         throw std::runtime_error("Error saving weights: " + std::string(e.what()));
     }
@@ -744,15 +1171,15 @@ void LSTMPredictor::save_biases(std::ofstream& file) {
         // Save LSTM layer biases
         for (int layer = 0; layer < num_layers; ++layer) {
             // Save bias_ih
-            size_t ih_size = lstm_layers[layer].bias_ih.size();
+            size_t ih_size = layers()[layer].bias_ih.size();
             file.write(reinterpret_cast<const char*>(&ih_size), sizeof(size_t));
-            file.write(reinterpret_cast<const char*>(lstm_layers[layer].bias_ih.data()), 
+            file.write(reinterpret_cast<const char*>(layers()[layer].bias_ih.data()), 
                       ih_size * sizeof(float));
 
             // Save bias_hh
-            size_t hh_size = lstm_layers[layer].bias_hh.size();
+            size_t hh_size = layers()[layer].bias_hh.size();
             file.write(reinterpret_cast<const char*>(&hh_size), sizeof(size_t));
-            file.write(reinterpret_cast<const char*>(lstm_layers[layer].bias_hh.data()), 
+            file.write(reinterpret_cast<const char*>(layers()[layer].bias_hh.data()), 
                       hh_size * sizeof(float));
         }
 
@@ -765,78 +1192,9 @@ void LSTMPredictor::save_biases(std::ofstream& file) {
     }
 }
 
-void LSTMPredictor::load_weights(std::ifstream& file) {
-    try {
-        // Load LSTM layer weights
-        for (int layer = 0; layer < num_layers; ++layer) {
-            // Load weight_ih
-            size_t ih_rows, ih_cols;
-            file.read(reinterpret_cast<char*>(&ih_rows), sizeof(size_t));
-            file.read(reinterpret_cast<char*>(&ih_cols), sizeof(size_t));
-            
-            lstm_layers[layer].weight_ih.resize(ih_rows, std::vector<float>(ih_cols));
-            for (auto& row : lstm_layers[layer].weight_ih) {
-                file.read(reinterpret_cast<char*>(row.data()), ih_cols * sizeof(float));
-            }
-
-            // Load weight_hh
-            size_t hh_rows, hh_cols;
-            file.read(reinterpret_cast<char*>(&hh_rows), sizeof(size_t));
-            file.read(reinterpret_cast<char*>(&hh_cols), sizeof(size_t));
-            
-            lstm_layers[layer].weight_hh.resize(hh_rows, std::vector<float>(hh_cols));
-            for (auto& row : lstm_layers[layer].weight_hh) {
-                file.read(reinterpret_cast<char*>(row.data()), hh_cols * sizeof(float));
-            }
-        }
-
-        // Load FC layer weights
-        size_t fc_rows, fc_cols;
-        file.read(reinterpret_cast<char*>(&fc_rows), sizeof(size_t));
-        file.read(reinterpret_cast<char*>(&fc_cols), sizeof(size_t));
-        
-        fc_weight.resize(fc_rows, std::vector<float>(fc_cols));
-        for (auto& row : fc_weight) {
-            file.read(reinterpret_cast<char*>(row.data()), fc_cols * sizeof(float));
-        }
-    } catch (const std::exception& e) {
-        throw std::runtime_error("Error loading weights: " + std::string(e.what()));
-    }
-}
-
-void LSTMPredictor::load_biases(std::ifstream& file) {
-    try {
-        // Load LSTM layer biases
-        for (int layer = 0; layer < num_layers; ++layer) {
-            // Load bias_ih
-            size_t ih_size;
-            file.read(reinterpret_cast<char*>(&ih_size), sizeof(size_t));
-            lstm_layers[layer].bias_ih.resize(ih_size);
-            file.read(reinterpret_cast<char*>(lstm_layers[layer].bias_ih.data()), 
-                     ih_size * sizeof(float));
-
-            // Load bias_hh
-            size_t hh_size;
-            file.read(reinterpret_cast<char*>(&hh_size), sizeof(size_t));
-            lstm_layers[layer].bias_hh.resize(hh_size);
-            file.read(reinterpret_cast<char*>(lstm_layers[layer].bias_hh.data()), 
-                     hh_size * sizeof(float));
-        }
-
-        // Load FC layer bias
-        size_t fc_size;
-        file.read(reinterpret_cast<char*>(&fc_size), sizeof(size_t));
-        fc_bias.resize(fc_size);
-        file.read(reinterpret_cast<char*>(fc_bias.data()), fc_size * sizeof(float));
-    } catch (const std::exception& e) {
-        throw std::runtime_error("Error loading biases: " + std::string(e.what()));
-    }
-}
-
 void LSTMPredictor::initialize_layer_cache() {
     // Initialize layer cache with appropriate dimensions
-    layer_cache.clear();
-    layer_cache.resize(num_layers);
+    tape.clear();
     
     // Initialize h_state and c_state
     h_state.clear();
@@ -852,37 +1210,38 @@ void LSTMPredictor::initialize_layer_cache() {
 
 void LSTMPredictor::save_layer_cache(std::ofstream& file) const {
     try {
-        // Save layer cache dimensions
-        size_t num_batches = layer_cache.empty() ? 0 : layer_cache[0].size();
+        // Same layout as the old per-entry cache: for every (layer, batch, t)
+        // nine size-prefixed vectors
+        size_t num_batches = tape.empty() ? 0 : tape.batch_size;
         file.write(reinterpret_cast<const char*>(&num_batches), sizeof(size_t));
         
         if (num_batches > 0) {
-            size_t num_timesteps = layer_cache[0][0].size();
+            size_t num_timesteps = tape.seq_len;
             file.write(reinterpret_cast<const char*>(&num_timesteps), sizeof(size_t));
             
+            auto save_row = [&file](const Matrix& m, size_t row, size_t size) {
+                file.write(reinterpret_cast<const char*>(&size), sizeof(size_t));
+                if (size > 0) {
+                    file.write(reinterpret_cast<const char*>(m.row(row)), 
+                             size * sizeof(float));
+                }
+            };
+            
             // Save each cache entry
-            for (const auto& layer : layer_cache) {
-                for (const auto& batch : layer) {
-                    for (const auto& entry : batch) {
-                        // Save vectors from LSTMCacheEntry
-                        auto save_vector = [&file](const std::vector<float>& vec) {
-                            size_t size = vec.size();
-                            file.write(reinterpret_cast<const char*>(&size), sizeof(size_t));
-                            if (size > 0) {
-                                file.write(reinterpret_cast<const char*>(vec.data()), 
-                                         size * sizeof(float));
-                            }
-                        };
-                        
-                        save_vector(entry.input);
-                        save_vector(entry.prev_hidden);
-                        save_vector(entry.prev_cell);
-                        save_vector(entry.cell_state);
-                        save_vector(entry.input_gate);
-                        save_vector(entry.forget_gate);
-                        save_vector(entry.cell_gate);
-                        save_vector(entry.output_gate);
-                        save_vector(entry.hidden_state);
+            for (size_t layer = 0; layer < tape.num_layers; ++layer) {
+                const size_t input_len = (layer == 0) ? input_size : hidden_size;
+                for (size_t batch = 0; batch < num_batches; ++batch) {
+                    for (size_t t = 0; t < num_timesteps; ++t) {
+                        const size_t row = tape.step(layer, batch, t);
+                        save_row(tape.input, row, input_len);
+                        save_row(tape.prev_hidden, row, hidden_size);
+                        save_row(tape.prev_cell, row, hidden_size);
+                        save_row(tape.cell_state, row, hidden_size);
+                        save_row(tape.input_gate, row, hidden_size);
+                        save_row(tape.forget_gate, row, hidden_size);
+                        save_row(tape.cell_gate, row, hidden_size);
+                        save_row(tape.output_gate, row, hidden_size);
+                        save_row(tape.hidden_state, row, hidden_size);
                     }
                 }
             }
@@ -905,101 +1264,180 @@ void LSTMPredictor::save_layer_cache(std::ofstream& file) const {
     }
 }
 
-void LSTMPredictor::load_layer_cache(std::ifstream& file) {
-    try {
-        // Load layer cache dimensions
-        size_t num_batches;
-        file.read(reinterpret_cast<char*>(&num_batches), sizeof(size_t));
-        
-        if (num_batches > 0) {
-            size_t num_timesteps;
-            file.read(reinterpret_cast<char*>(&num_timesteps), sizeof(size_t));
-            
-            // Resize layer cache
-            layer_cache.resize(num_layers);
-            for (auto& layer : layer_cache) {
-                layer.resize(num_batches);
-                for (auto& batch : layer) {
-                    batch.resize(num_timesteps);
-                }
+void LSTMPredictor::skip_legacy_layer_cache(LegacyModelStream& in) const {
+    const uint64_t num_batches = in.read_size();
+    if (num_batches > 0) {
+        const uint64_t num_timesteps = in.read_size();
+        std::vector<float> row(std::max(input_size, hidden_size));
+        auto skip_row = [&in, &row](size_t expected) {
+            const uint64_t size = in.read_size();
+            if (size != 0 && size != expected) {
+                throw std::runtime_error("cache entry size mismatch: " +
+                    std::to_string(size) + " != " + std::to_string(expected));
             }
-            
-            // Load each cache entry
-            for (auto& layer : layer_cache) {
-                for (auto& batch : layer) {
-                    for (auto& entry : batch) {
-                        // Load vectors into LSTMCacheEntry
-                        auto load_vector = [&file](std::vector<float>& vec) {
-                            size_t size;
-                            file.read(reinterpret_cast<char*>(&size), sizeof(size_t));
-                            vec.resize(size);
-                            if (size > 0) {
-                                file.read(reinterpret_cast<char*>(vec.data()), 
-                                        size * sizeof(float));
-                            }
-                        };
-                        
-                        load_vector(entry.input);
-                        load_vector(entry.prev_hidden);
-                        load_vector(entry.prev_cell);
-                        load_vector(entry.cell_state);
-                        load_vector(entry.input_gate);
-                        load_vector(entry.forget_gate);
-                        load_vector(entry.cell_gate);
-                        load_vector(entry.output_gate);
-                        load_vector(entry.hidden_state);
-                    }
+            in.read_floats(row.data(), size);
+        };
+        // Every entry is at least one size field, which caps the loop below
+        if (num_timesteps == 0 || num_batches > in.remaining() / sizeof(size_t) ||
+            num_timesteps > in.remaining() / sizeof(size_t) / num_batches) {
+            throw std::runtime_error("cache dimensions " + std::to_string(num_batches) + "x" +
+                                     std::to_string(num_timesteps) + " do not fit the file");
+        }
+        for (int layer = 0; layer < num_layers; ++layer) {
+            const size_t input_len = (layer == 0) ? input_size : hidden_size;
+            for (uint64_t entry = 0; entry < num_batches * num_timesteps; ++entry) {
+                skip_row(input_len);
+                for (int k = 0; k < 8; ++k) {
+                    skip_row(hidden_size);
                 }
             }
         }
-        
-        // Load h_state and c_state
-        size_t state_layers;
-        file.read(reinterpret_cast<char*>(&state_layers), sizeof(size_t));
-        h_state.resize(state_layers);
-        c_state.resize(state_layers);
-        for (size_t i = 0; i < state_layers; ++i) {
-            size_t state_size;
-            file.read(reinterpret_cast<char*>(&state_size), sizeof(size_t));
-            h_state[i].resize(state_size);
-            c_state[i].resize(state_size);
-            file.read(reinterpret_cast<char*>(h_state[i].data()), 
-                     state_size * sizeof(float));
-            file.read(reinterpret_cast<char*>(c_state[i].data()), 
-                     state_size * sizeof(float));
+    }
+
+    in.expect_size("state layer count", num_layers);
+    std::vector<float> state(hidden_size);
+    for (int i = 0; i < num_layers; ++i) {
+        in.expect_size("state size", hidden_size);
+        in.read_floats(state.data(), hidden_size);
+        in.read_floats(state.data(), hidden_size);
+    }
+}
+
+LSTMPredictor::LegacyParameters LSTMPredictor::read_legacy_parameters(LegacyModelStream& in) const {
+    auto read_matrix = [&in](const std::string& name, Matrix& m, size_t rows, size_t cols) {
+        in.expect_size(name + " rows", rows);
+        in.expect_size(name + " cols", cols);
+        m.resize(rows, cols);
+        for (size_t r = 0; r < rows; ++r) {
+            in.read_floats(m.row(r), cols);
         }
-        
-    } catch (const std::exception& e) {
-        throw std::runtime_error("Error loading layer cache: " + std::string(e.what()));
+    };
+    auto read_vector = [&in](const std::string& name, std::vector<float>& v, size_t size) {
+        in.expect_size(name + " size", size);
+        v.resize(size);
+        in.read_floats(v.data(), size);
+    };
+
+    const size_t gates = 4 * hidden_size;
+    LegacyParameters params;
+    params.layers.resize(num_layers);
+    // All weights come first, then all biases
+    for (int layer = 0; layer < num_layers; ++layer) {
+        const std::string name = "lstm" + std::to_string(layer) + ".";
+        read_matrix(name + "weight_ih", params.layers[layer].weight_ih,
+                    gates, layer == 0 ? input_size : hidden_size);
+        read_matrix(name + "weight_hh", params.layers[layer].weight_hh, gates, hidden_size);
     }
+    read_matrix("fc.weight", params.fc_weight, num_classes, hidden_size);
+    for (int layer = 0; layer < num_layers; ++layer) {
+        const std::string name = "lstm" + std::to_string(layer) + ".";
+        read_vector(name + "bias_ih", params.layers[layer].bias_ih, gates);
+        read_vector(name + "bias_hh", params.layers[layer].bias_hh, gates);
+    }
+    read_vector("fc.bias", params.fc_bias, num_classes);
+    return params;
 }
 
-void LSTMPredictor::clear_temporary_cache() {
-    // Instead of clearing and deallocating, just reset values to zero
-    for (auto& layer : layer_cache) {
-        for (auto& batch : layer) {
-            for (auto& seq : batch) {
-                // Reset all vectors to zero instead of deallocating
-                std::fill(seq.input.begin(), seq.input.end(), 0.0f);
-                std::fill(seq.prev_hidden.begin(), seq.prev_hidden.end(), 0.0f);
-                std::fill(seq.prev_cell.begin(), seq.prev_cell.end(), 0.0f);
-                std::fill(seq.cell_state.begin(), seq.cell_state.end(), 0.0f);
-                std::fill(seq.input_gate.begin(), seq.input_gate.end(), 0.0f);
-                std::fill(seq.forget_gate.begin(), seq.forget_gate.end(), 0.0f);
-                std::fill(seq.cell_gate.begin(), seq.cell_gate.end(), 0.0f);
-                std::fill(seq.output_gate.begin(), seq.output_gate.end(), 0.0f);
-                std::fill(seq.hidden_state.begin(), seq.hidden_state.end(), 0.0f);
-            }
+void LSTMPredictor::set_legacy_parameters(LegacyParameters&& params) {
+    backbone = std::make_shared<std::vector<LSTMLayer>>(std::move(params.layers));
+    fc_weight = std::move(params.fc_weight);
+    fc_bias = std::move(params.fc_bias);
+    ++weights_version;
+    initialize_layer_cache();
+}
+
+void LSTMPredictor::save_checkpoint(CheckpointWriter& ckpt, const std::string& prefix) const {
+    for (int layer = 0; layer < num_layers; ++layer) {
+        const std::string name = prefix + "lstm" + std::to_string(layer) + ".";
+        ckpt.add_matrix(name + "weight_ih", layers()[layer].weight_ih);
+        ckpt.add_matrix(name + "weight_hh", layers()[layer].weight_hh);
+        ckpt.add_floats(name + "bias_ih", layers()[layer].bias_ih);
+        ckpt.add_floats(name + "bias_hh", layers()[layer].bias_hh);
+        ckpt.add_floats(name + "h_state", h_state[layer]);
+        ckpt.add_floats(name + "c_state", c_state[layer]);
+    }
+    ckpt.add_matrix(prefix + "fc.weight", fc_weight);
+    ckpt.add_floats(prefix + "fc.bias", fc_bias);
+    optimizer.save(ckpt, prefix + "optim.");
+}
+
+void LSTMPredictor::load_checkpoint(const CheckpointReader& ckpt, const std::string& prefix) {
+    auto expect_matrix = [](const std::string& name, const Matrix& m, size_t rows, size_t cols) {
+        if (m.rows() != rows || m.cols() != cols) {
+            throw std::runtime_error(name + " is " + std::to_string(m.rows()) + "x" + 
+                std::to_string(m.cols()) + ", model expects " + 
+                std::to_string(rows) + "x" + std::to_string(cols));
+        }
+    };
+    auto read_vector = [&ckpt](const std::string& name, size_t size) {
+        std::vector<float> v = ckpt.read_floats(name);
+        if (v.size() != size) {
+            throw std::runtime_error(name + " has " + std::to_string(v.size()) + 
+                " values, model expects " + std::to_string(size));
         }
+        return v;
+    };
+    
+    // Read everything into temporaries first so a bad file leaves the model untouched
+    const size_t gates = 4 * hidden_size;
+    std::vector<LSTMLayer> layers(num_layers);
+    std::vector<std::vector<float>> h(num_layers), c(num_layers);
+    for (int layer = 0; layer < num_layers; ++layer) {
+        const std::string name = prefix + "lstm" + std::to_string(layer) + ".";
+        ckpt.view_matrix(name + "weight_ih", layers[layer].weight_ih);
+        expect_matrix(name + "weight_ih", layers[layer].weight_ih, 
+                      gates, layer == 0 ? input_size : hidden_size);
+        ckpt.view_matrix(name + "weight_hh", layers[layer].weight_hh);
+        expect_matrix(name + "weight_hh", layers[layer].weight_hh, gates, hidden_size);
+        layers[layer].bias_ih = read_vector(name + "bias_ih", gates);
+        layers[layer].bias_hh = read_vector(name + "bias_hh", gates);
+        h[layer] = read_vector(name + "h_state", hidden_size);
+        c[layer] = read_vector(name + "c_state", hidden_size);
     }
+    Matrix fc_w;
+    ckpt.view_matrix(prefix + "fc.weight", fc_w);
+    expect_matrix(prefix + "fc.weight", fc_w, num_classes, hidden_size);
+    std::vector<float> fc_b = read_vector(prefix + "fc.bias", num_classes);
+    optimizer.load(ckpt, prefix + "optim.");
+    
+    backbone = std::make_shared<std::vector<LSTMLayer>>(std::move(layers));
+    h_state = std::move(h);
+    c_state = std::move(c);
+    fc_weight = std::move(fc_w);
+    fc_bias = std::move(fc_b);
+    ++weights_version;
     
+    // The tape is rewritten by the next forward pass before backward reads it,
+    // so checkpoints do not carry it (version 1 files still have it, unused)
+    tape.clear();
+}
+
+void LSTMPredictor::ActivationTape::resize(size_t layers, size_t batches, size_t steps,
+                                           size_t input_width, size_t hidden_size) {
+    num_layers = layers;
+    batch_size = batches;
+    seq_len = steps;
+    const size_t rows = layers * batches * steps;
+    input.resize(rows, input_width);
+    prev_hidden.resize(rows, hidden_size);
+    prev_cell.resize(rows, hidden_size);
+    cell_state.resize(rows, hidden_size);
+    input_gate.resize(rows, hidden_size);
+    forget_gate.resize(rows, hidden_size);
+    cell_gate.resize(rows, hidden_size);
+    output_gate.resize(rows, hidden_size);
+    hidden_state.resize(rows, hidden_size);
+}
+
+void LSTMPredictor::clear_temporary_cache() {
+    // Every tape row is rewritten by the next forward pass before backward
+    // reads it, so there is nothing to zero here
     current_cache_size = 0;  // Reset size counter
 }
 
 void LSTMPredictor::clear_training_state() {
     // Clear layer cache (intermediate computations)
-    layer_cache.clear();
-    layer_cache.resize(num_layers);
+    tape.clear();
     
     // Clear gradients used for testing
     last_gradients.clear();
@@ -1010,62 +1448,3 @@ void LSTMPredictor::clear_training_state() {
     
 }
 
-// Could maybe try a decaying learning rate if the model deviates after running for a while
-// Momentum seems to not be needed, as the model focuses on online learning.
-// Decaying learning rate might not be a good solution if the model will eventually encounter concept drift in some form and thereby being counter productive.
-void LSTMPredictor::apply_sgd_update(
-    std::vector<std::vector<float>>& weights,
-    std::vector<std::vector<float>>& grads,
-    float learning_rate) {
-
-    float max_grad = 0.0f;
-    float max_update = 0.0f;
-    int zero_grads = 0;
-    
-    for (size_t i = 0; i < weights.size(); ++i) {
-        for (size_t j = 0; j < weights[i].size(); ++j) {
-            float grad = grads[i][j];
-            
-            // Gradient clipping
-            const float GRAD_CLIP = 1.0f;
-            grad = std::max(std::min(grad, GRAD_CLIP), -GRAD_CLIP);
-            
-            // Simple SGD update
-            float update = learning_rate * grad;
-            weights[i][j] -= update;
-            
-            // Track statistics
-            max_grad = std::max(max_grad, std::abs(grad));
-            max_update = std::max(max_update, std::abs(update));
-            if (std::abs(grad) < 1e-10) zero_grads++;
-        }
-    }
-}
-
-void LSTMPredictor::apply_sgd_update(
-    std::vector<float>& biases,
-    std::vector<float>& grads,
-    float learning_rate) {
-    
-    float max_grad = 0.0f;
-    float max_update = 0.0f;
-    int zero_grads = 0;
-    
-    for (size_t i = 0; i < biases.size(); ++i) {
-        float grad = grads[i];
-        
-        // Optional gradient clipping
-        const float GRAD_CLIP = 1.0f;
-        grad = std::max(std::min(grad, GRAD_CLIP), -GRAD_CLIP);
-        
-        // Simple SGD update
-        float update = learning_rate * grad;
-        biases[i] -= update;
-        
-        // Track statistics
-        max_grad = std::max(max_grad, std::abs(grad));
-        max_update = std::max(max_update, std::abs(update));
-        if (std::abs(grad) < 1e-10) zero_grads++;
-    }
-    
-}
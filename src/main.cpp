@@ -1,22 +1,21 @@
 #include "adapad.hpp"
 #include "config.hpp"
 #include "yaml_handler.hpp"
+#include "thread_pool.hpp"
+#include "csv_reader.hpp"
+#include "stage_stats.hpp"
+#include "timestep_engine.hpp"
 #include <iostream>
 #include <vector>
 #include <fstream>
-#include <sstream>
 #include <chrono>
 #include <string>
 #include <memory>
 #include <sys/resource.h>
 #include <numeric>
+#include <algorithm>
 #include <sys/time.h>
 
-struct DataPoint {
-    float value;
-    bool is_anomaly;
-};
-
 struct SystemStats {
     long voluntary_switches;
     long involuntary_switches;
@@ -24,6 +23,17 @@ struct SystemStats {
     struct timeval system_time;
 };
 
+// Per-model results of one timestep, summed over the model's stages by the
+// workers that ran them
+struct ModelStepStats {
+    double time = 0.0;
+    long memory_delta = 0;
+    double system_time = 0.0;
+    long voluntary_switches = 0;
+    long involuntary_switches = 0;
+    std::string error;
+};
+
 struct CPUStats {
     unsigned long long user;
     unsigned long long nice;
@@ -35,71 +45,6 @@ struct CPUStats {
     unsigned long long steal;
 };
 
-std::vector<DataPoint> read_csv_column(const std::string& filename, int column_index) {
-    std::vector<DataPoint> data;
-    std::ifstream file(filename);
-    std::string line;
-    int line_number = 0;
-    
-    // Skip header
-    std::getline(file, line);
-    line_number++;
-    
-    while (std::getline(file, line)) {
-        line_number++;
-        std::stringstream ss(line);
-        std::string field;
-        
-        // Skip to desired column
-        for (int i = 0; i <= column_index; i++) {
-            if (!getline(ss, field, ',')) {
-                std::cerr << "Warning: Missing column at line " << line_number << std::endl;
-                field = "";  // Ensure field is empty for missing columns
-            }
-        }
-        
-        DataPoint point;
-        // Trim whitespace
-        field.erase(0, field.find_first_not_of(" \t\r\n"));
-        field.erase(field.find_last_not_of(" \t\r\n") + 1);
-        
-        // Check for empty or invalid values
-        if (field.empty() || field == "NA" || field == "NaN" || field == "-" || field == "0.0") {
-            std::cerr << "Warning: Invalid/missing value at line " << line_number 
-                     << ", column " << column_index << ": '" << field 
-                     << "', setting to -999" << std::endl;
-            point.value = -999.0f;
-        } else {
-            try {
-                point.value = std::stof(field);
-            } catch (const std::exception& e) {
-                std::cerr << "Warning: Failed to parse value at line " << line_number 
-                         << ", column " << column_index << ": '" << field 
-                         << "', setting to -999" << std::endl;
-                point.value = -999.0f;
-            }
-        }
-        
-        point.is_anomaly = false;
-        data.push_back(point);
-    }
-    
-    if (data.empty()) {
-        throw std::runtime_error("No data points found in column " + std::to_string(column_index));
-    }
-    
-    // Count valid vs invalid values
-    size_t invalid_count = std::count_if(data.begin(), data.end(), 
-        [](const DataPoint& p) { return p.value == -999.0f; });
-    
-    std::cout << "Column " << column_index << " statistics:" << std::endl;
-    std::cout << "- Total points: " << data.size() << std::endl;
-    std::cout << "- Valid points: " << (data.size() - invalid_count) << std::endl;
-    std::cout << "- Missing/invalid points: " << invalid_count << std::endl;
-    
-    return data;
-}
-
 size_t get_memory_usage() {
     struct rusage rusage;
     getrusage(RUSAGE_SELF, &rusage);
@@ -126,7 +71,12 @@ float get_cpu_temp() {
 
 SystemStats get_system_stats() {
     struct rusage usage;
+#ifdef RUSAGE_THREAD
+    // Per-thread counters, so concurrent models do not see each other's usage
+    getrusage(RUSAGE_THREAD, &usage);
+#else
     getrusage(RUSAGE_SELF, &usage);
+#endif
     return {
         usage.ru_nvcsw,
         usage.ru_nivcsw,
@@ -148,6 +98,24 @@ CPUStats get_cpu_stats() {
     return stats;
 }
 
+// Merges the stage timings of every model and prints them as one line, or
+// rewrites the metrics file when logging.stats_file is set
+void export_stage_stats(const std::vector<std::unique_ptr<AdapAD>>& models, const Config& config) {
+    StageStats total;
+    for (const auto& model : models) {
+        total.merge(model->get_stage_stats());
+    }
+    if (config.stats_file.empty()) {
+        std::cout << total.summary_line() << std::endl;
+        return;
+    }
+    try {
+        total.write_metrics(config.stats_file);
+    } catch (const std::exception& e) {
+        std::cerr << "Warning: " << e.what() << std::endl;
+    }
+}
+
 double calculate_cpu_usage(const CPUStats& start, const CPUStats& end) {
     unsigned long long start_idle = start.idle + start.iowait;
     unsigned long long end_idle = end.idle + end.iowait;
@@ -179,29 +147,15 @@ int main() {
         return 1;
     }
     
-    // Read CSV header to get parameter names and order
-    std::ifstream file(config.data_source_path);
-    if (!file.is_open()) {
-        std::cerr << "Error: Could not open data file: " << config.data_source_path << std::endl;
+    // Rows are streamed from the CSV; the header gives parameter names and order
+    std::unique_ptr<CSVStreamReader> reader;
+    try {
+        reader.reset(new CSVStreamReader(config.data_source_path, config.follow_input, config.follow_poll_ms));
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
-    
-    std::string header;
-    std::getline(file, header);
-    file.close();
-    
-    // Parse header into parameter names
-    std::vector<std::string> csv_parameters;
-    std::stringstream ss(header);
-    std::string param;
-    
-    // Skip timestamp
-    std::getline(ss, param, ',');
-    
-    // Get remaining parameters
-    while (std::getline(ss, param, ',')) {
-        csv_parameters.push_back(param);
-    }
+    const std::vector<std::string>& csv_parameters = reader->columns();
     
     std::cout << "Found " << csv_parameters.size() << " parameters in CSV:" << std::endl;
     for (const auto& param : csv_parameters) {
@@ -213,9 +167,6 @@ int main() {
         return 1;
     }
     
-    // Reserve space for parameters to avoid reallocations
-    csv_parameters.reserve(15);  // Adjust based on expected parameter count
-    
     // Initialize models and measure memory usage
     std::vector<std::unique_ptr<AdapAD>> models;
     size_t initial_memory = get_memory_usage();
@@ -265,27 +216,35 @@ int main() {
     size_t total_memory = get_memory_usage() - initial_memory;
     std::cout << "Total memory usage for all models: " << total_memory / 1024.0 << " MB" << std::endl;
     
-    // Read training data for all models
-    std::vector<std::vector<DataPoint>> all_data;
-    for (size_t i = 0; i < models.size(); ++i) {
-        all_data.push_back(read_csv_column(config.data_source_path, i + 1));
+    // Only the first train_size rows are kept, for training; the rest are
+    // consumed one row at a time in the online phase
+    std::vector<std::vector<float>> training_rows(models.size());
+    std::vector<float> row;
+    while (reader->rows_read() < (size_t)predictor_config.train_size && reader->next_row(row)) {
+        for (size_t i = 0; i < models.size(); ++i) {
+            training_rows[i].push_back(row[i]);
+        }
     }
     
-    // Pre-allocate data vectors
-    all_data.reserve(models.size());
-    for (auto& data : all_data) {
-        data.reserve(4000);  // Adjust based on expected data size
+    if (reader->rows_read() == 0) {
+        std::cerr << "Error: No data rows found in " << config.data_source_path << std::endl;
+        return 1;
     }
     
     // Training phase
     std::cout << "\nStarting training phase..." << std::endl;
     auto train_start = std::chrono::high_resolution_clock::now();
     
+    // Models trained from scratch in shared backbone mode, trained together below
+    std::vector<AdapAD*> shared_group;
+    
     for (size_t i = 0; i < models.size(); ++i) {
         // Get initial data points for lookback
         std::vector<float> initial_data;
-        for (size_t j = 0; j < predictor_config.lookback_len && j < all_data[i].size(); ++j) {
-            initial_data.push_back(all_data[i][j].value);
+        const size_t initial_len = std::min(static_cast<size_t>(predictor_config.lookback_len),
+                                            training_rows[i].size());
+        for (size_t j = 0; j < initial_len; ++j) {
+            initial_data.push_back(training_rows[i][j]);
         }
 
         if (config.load_enabled && models[i]->has_saved_model()) {
@@ -299,14 +258,26 @@ int main() {
             }
         } else {
             train_new_model:
-            std::vector<float> training_data;
-            for (size_t j = 0; j < predictor_config.train_size && j < all_data[i].size(); ++j) {
-                training_data.push_back(all_data[i][j].value);
+            models[i]->set_training_data(training_rows[i]);
+            if (config.shared_backbone) {
+                shared_group.push_back(models[i].get());
+            } else {
+                models[i]->train();
             }
-            models[i]->set_training_data(training_data);
-            models[i]->train();
         }
     }
+    if (!shared_group.empty()) {
+        std::cout << "Training " << shared_group.size() << " models on shared backbones..." << std::endl;
+        AdapAD::train_shared(shared_group);
+    }
+    if (config.shared_backbone) {
+        // Models loaded from checkpoints come back with their own copy of the backbone
+        std::vector<AdapAD*> all;
+        for (const auto& model : models) {
+            all.push_back(model.get());
+        }
+        AdapAD::retie_shared(all);
+    }
     
     auto train_end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> train_time = train_end - train_start;
@@ -316,12 +287,23 @@ int main() {
     std::cout << "\nStarting online learning phase..." << std::endl;
     size_t total_predictions = 0;
     double total_processing_time = 0.0;
-    
-    // Online learning phase - processes sequentially
-    const size_t data_size = all_data[0].size();
+    double total_model_time = 0.0;
+    
+    // Online learning phase - sensors of a timestep run concurrently,
+    // with a barrier before the next timestep starts
+    ThreadPool pool(config.num_threads, config.pin_threads);
+    std::cout << "Processing sensors on " << pool.size() << " thread(s)"
+              << (config.pin_threads ? " (pinned)" : "") << std::endl;
+    
+    std::vector<ModelStepStats> step_stats(models.size());
+    std::vector<AdapAD*> model_ptrs;
+    for (const auto& model : models) {
+        model_ptrs.push_back(model.get());
+    }
+    TimestepEngine engine(model_ptrs);
     size_t prev_memory = get_memory_usage();
     
-    for (size_t t = predictor_config.train_size; t < data_size; ++t) {
+    for (size_t t = predictor_config.train_size; reader->next_row(row); ++t) {
         int freq_before = get_cpu_freq();
         float temp_before = get_cpu_temp();
         auto start_time = std::chrono::high_resolution_clock::now();
@@ -331,52 +313,61 @@ int main() {
                   << " (CPU Freq: " << freq_before/1000 << " MHz"
                   << ", Temp: " << temp_before << "°C)" << std::endl;
         
-        double timestep_total = 0.0;
-        
-        for (size_t i = 0; i < models.size(); ++i) {
+        // Stages of the models run on the pool, with the forward passes of
+        // all models batched in between. Each stage job only touches its own
+        // model and stats slot; output is printed afterwards in sensor order
+        for (ModelStepStats& stats : step_stats) {
+            stats = ModelStepStats();
+        }
+        engine.step(row, pool, [&](size_t i, const std::function<void()>& stage) {
+            ModelStepStats& stats = step_stats[i];
             auto model_start = std::chrono::high_resolution_clock::now();
             auto stats_before = get_system_stats();
             size_t model_memory_before = get_memory_usage();
             
-            try {
-                // Process single new value
-                const float measured_value = all_data[i][t].value;
-                all_data[i][t].is_anomaly = models[i]->is_anomalous(measured_value);
-                models[i]->clean();
-                
+            stage();
+            
+            auto model_end = std::chrono::high_resolution_clock::now();
+            stats.time += std::chrono::duration<double>(model_end - model_start).count();
+            stats.memory_delta += (long)get_memory_usage() - (long)model_memory_before;
+            
+            auto stats_after = get_system_stats();
+            stats.system_time += 
+                (stats_after.system_time.tv_sec - stats_before.system_time.tv_sec) +
+                (stats_after.system_time.tv_usec - stats_before.system_time.tv_usec) / 1e6;
+            stats.voluntary_switches += stats_after.voluntary_switches - stats_before.voluntary_switches;
+            stats.involuntary_switches += stats_after.involuntary_switches - stats_before.involuntary_switches;
+        });
+        for (size_t i = 0; i < models.size(); ++i) {
+            step_stats[i].error = engine.error(i);
+        }
+        
+        double timestep_total = std::chrono::duration<double>(
+            std::chrono::high_resolution_clock::now() - start_time).count();
+        double timestep_model_time = 0.0;
+        
+        for (size_t i = 0; i < models.size(); ++i) {
+            const ModelStepStats& stats = step_stats[i];
+            timestep_model_time += stats.time;
+            
+            if (!stats.error.empty()) {
+                std::cerr << "Error processing " << csv_parameters[i] 
+                          << " at time " << t << ": " << stats.error << std::endl;
+            } else {
                 // Log memory delta for this model
-                size_t model_memory_after = get_memory_usage();
-                long memory_delta = (long)model_memory_after - (long)model_memory_before;
-                
                 std::cout << csv_parameters[i] << ": " 
-                          << "Time=" << std::chrono::duration<double>(
-                             std::chrono::high_resolution_clock::now() - model_start).count() << "s"
-                          << ", MemDelta=" << memory_delta / 1024.0 << "MB";
+                          << "Time=" << stats.time << "s"
+                          << ", MemDelta=" << stats.memory_delta / 1024.0 << "MB";
                 
-                if (memory_delta > 1024 * 100) { // Log warning if memory increase > 100KB
+                if (stats.memory_delta > 1024 * 100) { // Log warning if memory increase > 100KB
                     std::cout << " [WARNING: High memory usage]";
                 }
-                
-            } catch (const std::exception& e) {
-                std::cerr << "Error processing " << csv_parameters[i] 
-                          << " at time " << t << ": " << e.what() << std::endl;
             }
             
-            auto model_end = std::chrono::high_resolution_clock::now();
-            double model_time = std::chrono::duration<double>(
-                model_end - model_start).count();
-            
-            timestep_total += model_time;
-            
             // Enhanced embedded system logging
-            auto stats_after = get_system_stats();
-            double system_time = 
-                (stats_after.system_time.tv_sec - stats_before.system_time.tv_sec) +
-                (stats_after.system_time.tv_usec - stats_before.system_time.tv_usec) / 1e6;
-            
-            std::cout << " (Sys=" << system_time << "s"
-                      << ", CSw=" << (stats_after.voluntary_switches - stats_before.voluntary_switches)
-                      << "v/" << (stats_after.involuntary_switches - stats_before.involuntary_switches)
+            std::cout << " (Sys=" << stats.system_time << "s"
+                      << ", CSw=" << stats.voluntary_switches
+                      << "v/" << stats.involuntary_switches
                       << "i)" << std::endl;
         }
         
@@ -388,7 +379,9 @@ int main() {
         double cpu_usage = calculate_cpu_usage(cpu_stats_before, cpu_stats_after);
         
         std::cout << "\nTimestep Summary:" << std::endl;
-        std::cout << "- Total time: " << timestep_total << "s" << std::endl;
+        std::cout << "- Total time: " << timestep_total << "s"
+                  << " (sum over models: " << timestep_model_time << "s"
+                  << ", batched forward passes: " << engine.batched_seconds() << "s)" << std::endl;
         std::cout << "- Memory: " << current_memory / 1024.0 << "MB (Δ"
                   << (long)(current_memory - prev_memory) / 1024.0 << "MB)" << std::endl;
         std::cout << "- CPU Freq: " << freq_after/1000 << "MHz (Δ"
@@ -401,7 +394,11 @@ int main() {
         prev_memory = current_memory;
         
         total_predictions++;
+        if (config.stats_interval > 0 && total_predictions % config.stats_interval == 0) {
+            export_stage_stats(models, config);
+        }
         total_processing_time += timestep_total;
+        total_model_time += timestep_model_time;
     }
     
     auto total_end_time = std::chrono::high_resolution_clock::now();
@@ -413,9 +410,18 @@ int main() {
     std::cout << "Overall average processing time per time step (all models): " 
               << (total_processing_time / total_predictions) << " seconds" << std::endl;
     std::cout << "Overall average time per model: " 
-              << (total_processing_time / total_predictions / models.size()) 
+              << (total_model_time / total_predictions / models.size()) 
               << " seconds" << std::endl;
     std::cout << "Memory usage: " << get_memory_usage() / 1024.0 << " MB" << std::endl;
+    if (config.stats_interval > 0) {
+        export_stage_stats(models, config);
+    }
+    
+    for (size_t c = 0; c < csv_parameters.size(); ++c) {
+        std::cout << "Column " << c + 1 << " (" << csv_parameters[c] << "): " 
+                  << reader->rows_read() << " points, " 
+                  << reader->invalid_count(c) << " missing/invalid" << std::endl;
+    }
     
     
     return 0;
@@ -2,6 +2,7 @@
 #include <iostream>
 #include <sstream>
 #include <cmath> 
+#include <algorithm>
 
 std::vector<float> compute_mse_loss_gradient(const std::vector<float>& output, const std::vector<float>& target) {
     std::vector<float> gradient(output.size());
@@ -30,3 +31,28 @@ create_sliding_windows(const std::vector<float>& data, int lookback_len, int pre
     
     return {x, y};
 }
+
+std::pair<std::vector<std::vector<float>>, std::vector<float>>
+create_pooled_windows(const std::vector<std::vector<float>>& series, int lookback_len, int prediction_len) {
+    std::vector<std::pair<std::vector<std::vector<float>>, std::vector<float>>> per_series;
+    size_t longest = 0;
+    for (const auto& data : series) {
+        if (data.size() < static_cast<size_t>(lookback_len + prediction_len)) {
+            continue;
+        }
+        per_series.push_back(create_sliding_windows(data, lookback_len, prediction_len));
+        longest = std::max(longest, per_series.back().first.size());
+    }
+    
+    std::vector<std::vector<float>> x;
+    std::vector<float> y;
+    for (size_t i = 0; i < longest; ++i) {
+        for (const auto& windows : per_series) {
+            if (i < windows.first.size()) {
+                x.push_back(windows.first[i]);
+                y.push_back(windows.second[i]);
+            }
+        }
+    }
+    return {x, y};
+}
@@ -27,39 +27,56 @@ NormalDataPredictor::create_sliding_windows(const std::vector<float>& data) {
 }
 
 std::pair<std::vector<std::vector<std::vector<float>>>, std::vector<float>>
-NormalDataPredictor::train(int epoch, float lr, const std::vector<float>& data2learn) {
+NormalDataPredictor::train(int epoch, float lr, const std::vector<float>& data2learn, int batch_size) {
     std::cout << "Starting training with " << data2learn.size() << " samples..." << std::endl;
     auto windows = create_sliding_windows(data2learn);
     std::cout << "Created " << windows.first.size() << " training windows" << std::endl;
+    fit(epoch, lr, windows, batch_size);
     
+    // Convert windows to 3D
+    std::vector<std::vector<std::vector<float>>> x3d;
+    for (const auto& window : windows.first) {
+        std::vector<std::vector<std::vector<float>>> input_tensor(1);
+        input_tensor[0].resize(1);
+        input_tensor[0][0] = window;
+        x3d.push_back(input_tensor[0]);
+    }
+    
+    return {x3d, windows.second};
+}
+
+void NormalDataPredictor::train_backbone(int epoch, float lr, const std::vector<std::vector<float>>& series,
+                                         int batch_size) {
+    auto windows = create_pooled_windows(series, lookback_len, prediction_len);
+    std::cout << "Training shared backbone on " << windows.first.size() << " windows of "
+              << series.size() << " series..." << std::endl;
+    fit(epoch, lr, windows, batch_size);
+}
+
+void NormalDataPredictor::fit(int epoch, float lr,
+                              const std::pair<std::vector<std::vector<float>>, std::vector<float>>& windows,
+                              int batch_size) {
     predictor->train(); 
-    float best_loss = std::numeric_limits<float>::max();
-    int no_improve_count = 0;
+    
+    const size_t num_windows = windows.first.size();
+    const size_t step = static_cast<size_t>(std::max(1, batch_size));
     
     for (int e = 0; e < epoch; ++e) {
         float epoch_loss = 0.0f;
         
-        for (size_t i = 0; i < windows.first.size(); ++i) {
-            std::vector<std::vector<std::vector<float>>> input_tensor(1);
-            input_tensor[0].resize(1);
-            input_tensor[0][0] = windows.first[i];
-            
-            // Forward pass
-            auto output = predictor->forward(input_tensor);
-            auto pred = predictor->get_final_prediction(output);
-            
-            // Calculate loss
-            float sample_loss = 0.0f;
-            std::vector<float> target{windows.second[i]};
-            for (size_t k = 0; k < pred.size(); ++k) {
-                float diff = pred[k] - target[k];
-                sample_loss += diff * diff;
+        // One forward/backward pass per mini-batch of consecutive windows
+        for (size_t start = 0; start < num_windows; start += step) {
+            const size_t count = std::min(step, num_windows - start);
+            std::vector<std::vector<std::vector<float>>> input_tensor(count);
+            std::vector<float> target(count);
+            for (size_t b = 0; b < count; ++b) {
+                input_tensor[b].push_back(windows.first[start + b]);
+                target[b] = windows.second[start + b];
             }
             
-            epoch_loss += sample_loss;
-            
-            // Train step for each sample - now passing the output
-            predictor->train_step(input_tensor, target, output, lr);
+            // Forward, loss and update for the batch in one step; the windows
+            // are lookback_len wide by construction, so no shape checks
+            epoch_loss += predictor->train_step_unchecked(input_tensor, target, lr) * count;
         }
         
         // Report progress
@@ -69,46 +86,25 @@ NormalDataPredictor::train(int epoch, float lr, const std::vector<float>& data2l
                      << ", Average Loss: " << avg_loss << std::endl;
         }
     }
-    
-    // Convert windows to 3D
-    std::vector<std::vector<std::vector<float>>> x3d;
-    for (const auto& window : windows.first) {
-        std::vector<std::vector<std::vector<float>>> input_tensor(1);
-        input_tensor[0].resize(1);
-        input_tensor[0][0] = window;
-        x3d.push_back(input_tensor[0]);
-    }
-    
-    return {x3d, windows.second};
 }
 
 float NormalDataPredictor::predict(const std::vector<std::vector<std::vector<float>>>& observed) {
-    bool was_training = predictor->is_training();  
-    predictor->eval();  
-    
-    // Reshape input to match Python version: (batch=1, features=lookback_len)
+    // Input matches Python's reshape(1, -1): (batch=1, seq=1, features=lookback_len)
     if (observed.size() != 1 || observed[0].size() != 1 || 
         observed[0][0].size() != lookback_len) {
         throw std::runtime_error("Invalid input dimensions for prediction");
     }
     
-    // Flatten the input to match Python's reshape(1, -1)
-    std::vector<std::vector<std::vector<float>>> reshaped_input(1);
-    reshaped_input[0].resize(1);
-    reshaped_input[0][0] = observed[0][0];  
-    
-    auto output = predictor->forward(reshaped_input);
-    auto pred = predictor->get_final_prediction(output);
-    float result = std::max(0.0f, pred[0]);
-    
-    if (was_training) {
-        predictor->train();  
-    }
-    
-    return result;
+    // Inference path works in the predictor's preallocated buffers (no heap traffic)
+    const std::vector<float>& pred = predictor->infer(observed[0][0].data(), 1);
+    return to_prediction(pred[0]);
 }
 
-void NormalDataPredictor::update(int epoch_update, float lr_update,
+float NormalDataPredictor::to_prediction(float output) {
+    return std::max(0.0f, output);
+}
+
+int NormalDataPredictor::update(int epoch_update, float lr_update,
                                const std::vector<std::vector<std::vector<float>>>& past_observations,
                                const std::vector<float>& recent_observation) {
     // Validate input dimensions
@@ -123,27 +119,21 @@ void NormalDataPredictor::update(int epoch_update, float lr_update,
 
     predictor->train();
     
-    std::vector<float> loss_l;  
-    for (int epoch = 0; epoch < epoch_update; ++epoch) {
-        auto output = predictor->forward(past_observations);
-        auto pred = predictor->get_final_prediction(output);
-        
-        // Calculate MSE loss
-        float current_loss = 0.0f;
-        for (size_t i = 0; i < pred.size(); ++i) {
-            float diff = pred[i] - recent_observation[i];
-            current_loss += diff * diff;
-        }
-        current_loss /= static_cast<float>(pred.size());
-        
-        // Early stopping
-        if (!loss_l.empty() && current_loss > loss_l.back()) {  
+    // Early stopping: once the loss rises above the previous epoch's, the
+    // step returns without updating
+    float prev_loss = std::numeric_limits<float>::infinity();
+    int epoch = 0;
+    for (; epoch < epoch_update; ++epoch) {
+        // Same tensors every epoch, only the first step checks their shapes
+        float current_loss = epoch == 0
+            ? predictor->train_step(past_observations, recent_observation, lr_update, prev_loss)
+            : predictor->train_step_unchecked(past_observations, recent_observation, lr_update, prev_loss);
+        if (current_loss > prev_loss) {
             break;
         }
-        
-        loss_l.push_back(current_loss);
-        predictor->train_step(past_observations, recent_observation, output, lr_update);
+        prev_loss = current_loss;
     }
+    return epoch;
 }
 
 void NormalDataPredictor::save_weights(std::ofstream& file) {
@@ -162,30 +152,10 @@ void NormalDataPredictor::save_biases(std::ofstream& file) {
     }
 }
 
-void NormalDataPredictor::load_weights(std::ifstream& file) {
-    if (predictor) {
-        predictor->load_weights(file);
-    } else {
-        throw std::runtime_error("Predictor not initialized");
-    }
-}
-
-void NormalDataPredictor::load_biases(std::ifstream& file) {
-    if (predictor) {
-        predictor->load_biases(file);
-    } else {
-        throw std::runtime_error("Predictor not initialized");
-    }
-}
-
 void NormalDataPredictor::save_layer_cache(std::ofstream& file) const {
     predictor->save_layer_cache(file);
 }
 
-void NormalDataPredictor::load_layer_cache(std::ifstream& file) {
-    predictor->load_layer_cache(file);
-}
-
 void NormalDataPredictor::initialize_layer_cache() {
     if (predictor) {
         predictor->initialize_layer_cache();
@@ -0,0 +1,47 @@
+#include "quantized_matrix.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+InferencePrecision parse_inference_precision(const std::string& name) {
+    if (name == "fp32") return InferencePrecision::Float32;
+    if (name == "int8") return InferencePrecision::Int8;
+    throw std::runtime_error("Unknown inference precision '" + name + "' (expected fp32 or int8)");
+}
+
+const char* inference_precision_name(InferencePrecision precision) {
+    return precision == InferencePrecision::Int8 ? "int8" : "fp32";
+}
+
+void QuantizedMatrix::quantize(const Matrix& w) {
+    if (w.rows() != n_rows || w.cols() != n_cols) {
+        n_rows = w.rows();
+        n_cols = w.cols();
+        row_stride = padded_stride(n_cols);
+        values.assign(n_rows * row_stride, 0);
+        scales.assign(n_rows, 0.0f);
+    }
+    
+    for (size_t r = 0; r < n_rows; ++r) {
+        const float* w_r = w.row(r);
+        float max_abs = 0.0f;
+        for (size_t c = 0; c < n_cols; ++c) {
+            max_abs = std::max(max_abs, std::fabs(w_r[c]));
+        }
+        
+        int8_t* q_r = values.data() + r * row_stride;
+        if (max_abs == 0.0f) {
+            std::fill(q_r, q_r + n_cols, 0);
+            scales[r] = 0.0f;
+            continue;
+        }
+        
+        const float scale = max_abs / 127.0f;
+        const float inv_scale = 127.0f / max_abs;
+        for (size_t c = 0; c < n_cols; ++c) {
+            float q = std::nearbyint(w_r[c] * inv_scale);
+            q_r[c] = static_cast<int8_t>(std::max(-127.0f, std::min(127.0f, q)));
+        }
+        scales[r] = scale;
+    }
+}
@@ -0,0 +1,157 @@
+#include "result_logger.hpp"
+#include <chrono>
+#include <iostream>
+
+ResultLogger::ResultLogger(int flush_interval_ms, size_t records_per_channel)
+    : flush_interval_ms(flush_interval_ms > 0 ? flush_interval_ms : 0),
+      capacity(2),
+      wake_requested(false),
+      stopping(false) {
+    
+    // Power of two so ring positions are a mask of the running counters
+    while (capacity < records_per_channel) {
+        capacity <<= 1;
+    }
+    writer = std::thread(&ResultLogger::writer_loop, this);
+}
+
+ResultLogger::~ResultLogger() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    writer_cv.notify_one();
+    writer.join();
+    
+    std::lock_guard<std::mutex> lock(channels_mutex);
+    drain_all();
+    channels.clear();
+}
+
+ResultLogger::Channel* ResultLogger::open(const std::string& path, const std::string& header) {
+    std::unique_ptr<Channel> channel(new Channel);
+    channel->out.open(path);
+    if (!channel->out.is_open()) {
+        std::cerr << "Warning: Could not open log file " << path << ", results will not be logged" << std::endl;
+    }
+    channel->out << header << "\n";
+    channel->out.flush();
+    channel->ring.reset(new Record[capacity]);
+    channel->head.store(0);
+    channel->tail.store(0);
+    
+    std::lock_guard<std::mutex> lock(channels_mutex);
+    channels.push_back(std::move(channel));
+    return channels.back().get();
+}
+
+void ResultLogger::close(Channel* channel) {
+    std::lock_guard<std::mutex> lock(channels_mutex);
+    for (size_t i = 0; i < channels.size(); ++i) {
+        if (channels[i].get() == channel) {
+            drain(*channel);
+            channels.erase(channels.begin() + i);
+            break;
+        }
+    }
+}
+
+void ResultLogger::push(Channel* channel, const Record& record) {
+    size_t head = channel->head.load(std::memory_order_relaxed);
+    size_t tail = channel->tail.load(std::memory_order_acquire);
+    
+    if (head - tail == capacity) {
+        // Ring is full, hand the writer some work and wait for room
+        std::unique_lock<std::mutex> lock(mutex);
+        wake_requested = true;
+        writer_cv.notify_one();
+        space_cv.wait(lock, [&]() {
+            return head - channel->tail.load(std::memory_order_acquire) < capacity;
+        });
+        tail = channel->tail.load(std::memory_order_acquire);
+    }
+    
+    channel->ring[head & (capacity - 1)] = record;
+    channel->head.store(head + 1, std::memory_order_release);
+    
+    if (flush_interval_ms == 0 || head + 1 - tail == capacity / 2) {
+        wake_writer();
+    }
+}
+
+void ResultLogger::flush() {
+    std::lock_guard<std::mutex> lock(channels_mutex);
+    drain_all();
+}
+
+void ResultLogger::wake_writer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        wake_requested = true;
+    }
+    writer_cv.notify_one();
+}
+
+void ResultLogger::writer_loop() {
+    while (true) {
+        bool stop;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto woken = [this]() { return wake_requested || stopping; };
+            if (flush_interval_ms > 0) {
+                writer_cv.wait_for(lock, std::chrono::milliseconds(flush_interval_ms), woken);
+            } else {
+                writer_cv.wait(lock, woken);
+            }
+            wake_requested = false;
+            stop = stopping;
+        }
+        if (stop) {
+            return;
+        }
+        
+        std::lock_guard<std::mutex> lock(channels_mutex);
+        drain_all();
+    }
+}
+
+void ResultLogger::drain_all() {
+    for (auto& channel : channels) {
+        drain(*channel);
+    }
+    
+    // Release any model that was waiting on a full ring
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+    space_cv.notify_all();
+}
+
+void ResultLogger::drain(Channel& channel) {
+    size_t tail = channel.tail.load(std::memory_order_relaxed);
+    size_t head = channel.head.load(std::memory_order_acquire);
+    if (tail == head) {
+        return;
+    }
+    
+    std::ofstream& out = channel.out;
+    for (; tail != head; ++tail) {
+        const Record& r = channel.ring[tail & (capacity - 1)];
+        out << r.observed << "," << r.predicted;
+        switch (r.kind) {
+            case Record::Result:
+                out << "," << r.low << "," << r.high << ","
+                    << (r.anomalous ? "True" : "False") << ","
+                    << r.error << "," << r.threshold << "\n";
+                break;
+            case Record::Training:
+                out << ",,,,,\n";
+                break;
+            case Record::ErrorPattern:
+                out << ",,,,\n";
+                break;
+        }
+    }
+    out.flush();
+    channel.tail.store(head, std::memory_order_release);
+}
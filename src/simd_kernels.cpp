@@ -0,0 +1,645 @@
+#include "simd_kernels.hpp"
+#include <cstdint>
+#include <cstring>
+
+#if defined(ADAPAD_KERNELS_NEON)
+#include <arm_neon.h>
+#elif defined(ADAPAD_KERNELS_AVX2)
+#include <immintrin.h>
+#elif defined(ADAPAD_KERNELS_SSE)
+#include <emmintrin.h>
+#endif
+
+const char* simd_backend_name() {
+#if defined(ADAPAD_KERNELS_NEON)
+    return "neon";
+#elif defined(ADAPAD_KERNELS_AVX2)
+    return "avx2";
+#elif defined(ADAPAD_KERNELS_SSE)
+    return "sse";
+#else
+    return "scalar";
+#endif
+}
+
+static inline float dot_scalar(const float* w, const float* x, size_t cols) {
+    float sum = 0.0f;
+    for (size_t c = 0; c < cols; ++c) {
+        sum += w[c] * x[c];
+    }
+    return sum;
+}
+
+static inline float dot_q8_scalar(const int8_t* w, const float* x, size_t cols) {
+    float sum = 0.0f;
+    for (size_t c = 0; c < cols; ++c) {
+        sum += w[c] * x[c];
+    }
+    return sum;
+}
+
+void gemv_accumulate_scalar(const Matrix& w, const float* x, float* y) {
+    const size_t rows = w.rows();
+    for (size_t r = 0; r < rows; ++r) {
+        y[r] += dot_scalar(w.row(r), x, w.cols());
+    }
+}
+
+void gemm_accumulate_scalar(const Matrix& w, const float* x, size_t ldx, size_t batch,
+                            float* y, size_t ldy) {
+    for (size_t b = 0; b < batch; ++b) {
+        gemv_accumulate_scalar(w, x + b * ldx, y + b * ldy);
+    }
+}
+
+void gemv_accumulate_grouped_scalar(const float* w, size_t rows, size_t cols, size_t w_step,
+                                    const size_t* slots, size_t count,
+                                    const float* x, size_t ldx, float* y, size_t ldy) {
+    const size_t stride = Matrix::padded_stride(cols);
+    for (size_t k = 0; k < count; ++k) {
+        const float* wk = w + slots[k] * w_step;
+        for (size_t r = 0; r < rows; ++r) {
+            y[k * ldy + r] += dot_scalar(wk + r * stride, x + k * ldx, cols);
+        }
+    }
+}
+
+#if defined(ADAPAD_KERNELS_NEON)
+
+// y[c] += a * x[c]
+static inline void axpy(float a, const float* x, float* y, size_t n) {
+    const float32x4_t av = vdupq_n_f32(a);
+    size_t c = 0;
+    for (; c + 4 <= n; c += 4) {
+        vst1q_f32(y + c, vmlaq_f32(vld1q_f32(y + c), vld1q_f32(x + c), av));
+    }
+    for (; c < n; ++c) {
+        y[c] += a * x[c];
+    }
+}
+
+// y[c] += a0 * x0[c] + a1 * x1[c] + a2 * x2[c] + a3 * x3[c]
+static inline void axpy4(const float* a, const float* x0, const float* x1,
+                         const float* x2, const float* x3, float* y, size_t n) {
+    const float32x4_t a0 = vdupq_n_f32(a[0]);
+    const float32x4_t a1 = vdupq_n_f32(a[1]);
+    const float32x4_t a2 = vdupq_n_f32(a[2]);
+    const float32x4_t a3 = vdupq_n_f32(a[3]);
+    size_t c = 0;
+    for (; c + 4 <= n; c += 4) {
+        float32x4_t acc = vld1q_f32(y + c);
+        acc = vmlaq_f32(acc, vld1q_f32(x0 + c), a0);
+        acc = vmlaq_f32(acc, vld1q_f32(x1 + c), a1);
+        acc = vmlaq_f32(acc, vld1q_f32(x2 + c), a2);
+        acc = vmlaq_f32(acc, vld1q_f32(x3 + c), a3);
+        vst1q_f32(y + c, acc);
+    }
+    for (; c < n; ++c) {
+        y[c] += a[0] * x0[c] + a[1] * x1[c] + a[2] * x2[c] + a[3] * x3[c];
+    }
+}
+
+static inline float hsum(float32x4_t v) {
+    float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+}
+
+// y[0..3] += dot(w0..w3, x); four rows share every load of x
+static inline void dot4(const float* w0, const float* w1, const float* w2, const float* w3,
+                        const float* x, size_t cols, float* y) {
+    const size_t vec_cols = cols & ~size_t(3);
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    float32x4_t acc2 = vdupq_n_f32(0.0f);
+    float32x4_t acc3 = vdupq_n_f32(0.0f);
+    size_t c = 0;
+    for (; c < vec_cols; c += 4) {
+        float32x4_t xv = vld1q_f32(x + c);
+        acc0 = vmlaq_f32(acc0, vld1q_f32(w0 + c), xv);
+        acc1 = vmlaq_f32(acc1, vld1q_f32(w1 + c), xv);
+        acc2 = vmlaq_f32(acc2, vld1q_f32(w2 + c), xv);
+        acc3 = vmlaq_f32(acc3, vld1q_f32(w3 + c), xv);
+    }
+    float s0 = hsum(acc0), s1 = hsum(acc1), s2 = hsum(acc2), s3 = hsum(acc3);
+    for (; c < cols; ++c) {
+        s0 += w0[c] * x[c];
+        s1 += w1[c] * x[c];
+        s2 += w2[c] * x[c];
+        s3 += w3[c] * x[c];
+    }
+    y[0] += s0;
+    y[1] += s1;
+    y[2] += s2;
+    y[3] += s3;
+}
+
+static inline float dot(const float* w, const float* x, size_t cols) {
+    const size_t vec_cols = cols & ~size_t(3);
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    size_t c = 0;
+    for (; c < vec_cols; c += 4) {
+        acc = vmlaq_f32(acc, vld1q_f32(w + c), vld1q_f32(x + c));
+    }
+    float s = hsum(acc);
+    for (; c < cols; ++c) {
+        s += w[c] * x[c];
+    }
+    return s;
+}
+
+// Eight int8 weights widened to two float vectors and multiplied into acc
+static inline float32x4_t mla_q8(float32x4_t acc, const int8_t* w, float32x4_t x_lo, float32x4_t x_hi) {
+    const int16x8_t w16 = vmovl_s8(vld1_s8(w));
+    acc = vmlaq_f32(acc, vcvtq_f32_s32(vmovl_s16(vget_low_s16(w16))), x_lo);
+    return vmlaq_f32(acc, vcvtq_f32_s32(vmovl_s16(vget_high_s16(w16))), x_hi);
+}
+
+// s[0..3] = dot(w0..w3, x) with int8 weights, unscaled
+static inline void dot4_q8(const int8_t* w0, const int8_t* w1, const int8_t* w2, const int8_t* w3,
+                           const float* x, size_t cols, float* s) {
+    const size_t vec_cols = cols & ~size_t(7);
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    float32x4_t acc2 = vdupq_n_f32(0.0f);
+    float32x4_t acc3 = vdupq_n_f32(0.0f);
+    size_t c = 0;
+    for (; c < vec_cols; c += 8) {
+        float32x4_t x_lo = vld1q_f32(x + c);
+        float32x4_t x_hi = vld1q_f32(x + c + 4);
+        acc0 = mla_q8(acc0, w0 + c, x_lo, x_hi);
+        acc1 = mla_q8(acc1, w1 + c, x_lo, x_hi);
+        acc2 = mla_q8(acc2, w2 + c, x_lo, x_hi);
+        acc3 = mla_q8(acc3, w3 + c, x_lo, x_hi);
+    }
+    s[0] = hsum(acc0);
+    s[1] = hsum(acc1);
+    s[2] = hsum(acc2);
+    s[3] = hsum(acc3);
+    for (; c < cols; ++c) {
+        s[0] += w0[c] * x[c];
+        s[1] += w1[c] * x[c];
+        s[2] += w2[c] * x[c];
+        s[3] += w3[c] * x[c];
+    }
+}
+
+static inline float dot_q8(const int8_t* w, const float* x, size_t cols) {
+    const size_t vec_cols = cols & ~size_t(7);
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    size_t c = 0;
+    for (; c < vec_cols; c += 8) {
+        acc = mla_q8(acc, w + c, vld1q_f32(x + c), vld1q_f32(x + c + 4));
+    }
+    float s = hsum(acc);
+    for (; c < cols; ++c) {
+        s += w[c] * x[c];
+    }
+    return s;
+}
+
+#elif defined(ADAPAD_KERNELS_AVX2)
+
+static inline void axpy(float a, const float* x, float* y, size_t n) {
+    const __m256 av = _mm256_set1_ps(a);
+    size_t c = 0;
+    for (; c + 8 <= n; c += 8) {
+        _mm256_storeu_ps(y + c, _mm256_fmadd_ps(_mm256_loadu_ps(x + c), av, _mm256_loadu_ps(y + c)));
+    }
+    for (; c < n; ++c) {
+        y[c] += a * x[c];
+    }
+}
+
+static inline void axpy4(const float* a, const float* x0, const float* x1,
+                         const float* x2, const float* x3, float* y, size_t n) {
+    const __m256 a0 = _mm256_set1_ps(a[0]);
+    const __m256 a1 = _mm256_set1_ps(a[1]);
+    const __m256 a2 = _mm256_set1_ps(a[2]);
+    const __m256 a3 = _mm256_set1_ps(a[3]);
+    size_t c = 0;
+    for (; c + 8 <= n; c += 8) {
+        __m256 acc = _mm256_loadu_ps(y + c);
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(x0 + c), a0, acc);
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(x1 + c), a1, acc);
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(x2 + c), a2, acc);
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(x3 + c), a3, acc);
+        _mm256_storeu_ps(y + c, acc);
+    }
+    for (; c < n; ++c) {
+        y[c] += a[0] * x0[c] + a[1] * x1[c] + a[2] * x2[c] + a[3] * x3[c];
+    }
+}
+
+static inline float hsum(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+    return _mm_cvtss_f32(s);
+}
+
+static inline void dot4(const float* w0, const float* w1, const float* w2, const float* w3,
+                        const float* x, size_t cols, float* y) {
+    const size_t vec_cols = cols & ~size_t(7);
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    size_t c = 0;
+    for (; c < vec_cols; c += 8) {
+        __m256 xv = _mm256_loadu_ps(x + c);
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(w0 + c), xv, acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(w1 + c), xv, acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(w2 + c), xv, acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(w3 + c), xv, acc3);
+    }
+    float s0 = hsum(acc0), s1 = hsum(acc1), s2 = hsum(acc2), s3 = hsum(acc3);
+    for (; c < cols; ++c) {
+        s0 += w0[c] * x[c];
+        s1 += w1[c] * x[c];
+        s2 += w2[c] * x[c];
+        s3 += w3[c] * x[c];
+    }
+    y[0] += s0;
+    y[1] += s1;
+    y[2] += s2;
+    y[3] += s3;
+}
+
+static inline float dot(const float* w, const float* x, size_t cols) {
+    const size_t vec_cols = cols & ~size_t(7);
+    __m256 acc = _mm256_setzero_ps();
+    size_t c = 0;
+    for (; c < vec_cols; c += 8) {
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(w + c), _mm256_loadu_ps(x + c), acc);
+    }
+    float s = hsum(acc);
+    for (; c < cols; ++c) {
+        s += w[c] * x[c];
+    }
+    return s;
+}
+
+// Eight int8 weights sign-extended and converted to float
+static inline __m256 load_q8(const int8_t* w) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(w))));
+}
+
+static inline void dot4_q8(const int8_t* w0, const int8_t* w1, const int8_t* w2, const int8_t* w3,
+                           const float* x, size_t cols, float* s) {
+    const size_t vec_cols = cols & ~size_t(7);
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    size_t c = 0;
+    for (; c < vec_cols; c += 8) {
+        __m256 xv = _mm256_loadu_ps(x + c);
+        acc0 = _mm256_fmadd_ps(load_q8(w0 + c), xv, acc0);
+        acc1 = _mm256_fmadd_ps(load_q8(w1 + c), xv, acc1);
+        acc2 = _mm256_fmadd_ps(load_q8(w2 + c), xv, acc2);
+        acc3 = _mm256_fmadd_ps(load_q8(w3 + c), xv, acc3);
+    }
+    s[0] = hsum(acc0);
+    s[1] = hsum(acc1);
+    s[2] = hsum(acc2);
+    s[3] = hsum(acc3);
+    for (; c < cols; ++c) {
+        s[0] += w0[c] * x[c];
+        s[1] += w1[c] * x[c];
+        s[2] += w2[c] * x[c];
+        s[3] += w3[c] * x[c];
+    }
+}
+
+static inline float dot_q8(const int8_t* w, const float* x, size_t cols) {
+    const size_t vec_cols = cols & ~size_t(7);
+    __m256 acc = _mm256_setzero_ps();
+    size_t c = 0;
+    for (; c < vec_cols; c += 8) {
+        acc = _mm256_fmadd_ps(load_q8(w + c), _mm256_loadu_ps(x + c), acc);
+    }
+    float s = hsum(acc);
+    for (; c < cols; ++c) {
+        s += w[c] * x[c];
+    }
+    return s;
+}
+
+#elif defined(ADAPAD_KERNELS_SSE)
+
+static inline void axpy(float a, const float* x, float* y, size_t n) {
+    const __m128 av = _mm_set1_ps(a);
+    size_t c = 0;
+    for (; c + 4 <= n; c += 4) {
+        _mm_storeu_ps(y + c, _mm_add_ps(_mm_loadu_ps(y + c), _mm_mul_ps(_mm_loadu_ps(x + c), av)));
+    }
+    for (; c < n; ++c) {
+        y[c] += a * x[c];
+    }
+}
+
+static inline void axpy4(const float* a, const float* x0, const float* x1,
+                         const float* x2, const float* x3, float* y, size_t n) {
+    const __m128 a0 = _mm_set1_ps(a[0]);
+    const __m128 a1 = _mm_set1_ps(a[1]);
+    const __m128 a2 = _mm_set1_ps(a[2]);
+    const __m128 a3 = _mm_set1_ps(a[3]);
+    size_t c = 0;
+    for (; c + 4 <= n; c += 4) {
+        __m128 acc = _mm_loadu_ps(y + c);
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x0 + c), a0));
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x1 + c), a1));
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x2 + c), a2));
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x3 + c), a3));
+        _mm_storeu_ps(y + c, acc);
+    }
+    for (; c < n; ++c) {
+        y[c] += a[0] * x0[c] + a[1] * x1[c] + a[2] * x2[c] + a[3] * x3[c];
+    }
+}
+
+static inline float hsum(__m128 v) {
+    __m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+    return _mm_cvtss_f32(s);
+}
+
+// Rows are 16-byte aligned (Matrix::ROW_ALIGN), so weight loads can be aligned
+static inline void dot4(const float* w0, const float* w1, const float* w2, const float* w3,
+                        const float* x, size_t cols, float* y) {
+    const size_t vec_cols = cols & ~size_t(3);
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    __m128 acc2 = _mm_setzero_ps();
+    __m128 acc3 = _mm_setzero_ps();
+    size_t c = 0;
+    for (; c < vec_cols; c += 4) {
+        __m128 xv = _mm_loadu_ps(x + c);
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_load_ps(w0 + c), xv));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_load_ps(w1 + c), xv));
+        acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_load_ps(w2 + c), xv));
+        acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_load_ps(w3 + c), xv));
+    }
+    float s0 = hsum(acc0), s1 = hsum(acc1), s2 = hsum(acc2), s3 = hsum(acc3);
+    for (; c < cols; ++c) {
+        s0 += w0[c] * x[c];
+        s1 += w1[c] * x[c];
+        s2 += w2[c] * x[c];
+        s3 += w3[c] * x[c];
+    }
+    y[0] += s0;
+    y[1] += s1;
+    y[2] += s2;
+    y[3] += s3;
+}
+
+static inline float dot(const float* w, const float* x, size_t cols) {
+    const size_t vec_cols = cols & ~size_t(3);
+    __m128 acc = _mm_setzero_ps();
+    size_t c = 0;
+    for (; c < vec_cols; c += 4) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(w + c), _mm_loadu_ps(x + c)));
+    }
+    float s = hsum(acc);
+    for (; c < cols; ++c) {
+        s += w[c] * x[c];
+    }
+    return s;
+}
+
+// Four int8 weights sign-extended and converted to float (SSE2 has no
+// pmovsx, so the bytes are moved to the top of each lane and shifted down)
+static inline __m128 load_q8(const int8_t* w) {
+    int32_t bits;
+    std::memcpy(&bits, w, sizeof(bits));
+    __m128i v = _mm_cvtsi32_si128(bits);
+    v = _mm_unpacklo_epi8(v, v);
+    v = _mm_unpacklo_epi16(v, v);
+    return _mm_cvtepi32_ps(_mm_srai_epi32(v, 24));
+}
+
+static inline void dot4_q8(const int8_t* w0, const int8_t* w1, const int8_t* w2, const int8_t* w3,
+                           const float* x, size_t cols, float* s) {
+    const size_t vec_cols = cols & ~size_t(3);
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    __m128 acc2 = _mm_setzero_ps();
+    __m128 acc3 = _mm_setzero_ps();
+    size_t c = 0;
+    for (; c < vec_cols; c += 4) {
+        __m128 xv = _mm_loadu_ps(x + c);
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(load_q8(w0 + c), xv));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(load_q8(w1 + c), xv));
+        acc2 = _mm_add_ps(acc2, _mm_mul_ps(load_q8(w2 + c), xv));
+        acc3 = _mm_add_ps(acc3, _mm_mul_ps(load_q8(w3 + c), xv));
+    }
+    s[0] = hsum(acc0);
+    s[1] = hsum(acc1);
+    s[2] = hsum(acc2);
+    s[3] = hsum(acc3);
+    for (; c < cols; ++c) {
+        s[0] += w0[c] * x[c];
+        s[1] += w1[c] * x[c];
+        s[2] += w2[c] * x[c];
+        s[3] += w3[c] * x[c];
+    }
+}
+
+static inline float dot_q8(const int8_t* w, const float* x, size_t cols) {
+    const size_t vec_cols = cols & ~size_t(3);
+    __m128 acc = _mm_setzero_ps();
+    size_t c = 0;
+    for (; c < vec_cols; c += 4) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(load_q8(w + c), _mm_loadu_ps(x + c)));
+    }
+    float s = hsum(acc);
+    for (; c < cols; ++c) {
+        s += w[c] * x[c];
+    }
+    return s;
+}
+
+#else
+
+static inline void axpy(float a, const float* x, float* y, size_t n) {
+    for (size_t c = 0; c < n; ++c) {
+        y[c] += a * x[c];
+    }
+}
+
+static inline void axpy4(const float* a, const float* x0, const float* x1,
+                         const float* x2, const float* x3, float* y, size_t n) {
+    for (size_t c = 0; c < n; ++c) {
+        y[c] += a[0] * x0[c] + a[1] * x1[c] + a[2] * x2[c] + a[3] * x3[c];
+    }
+}
+
+static inline void dot4(const float* w0, const float* w1, const float* w2, const float* w3,
+                        const float* x, size_t cols, float* y) {
+    y[0] += dot_scalar(w0, x, cols);
+    y[1] += dot_scalar(w1, x, cols);
+    y[2] += dot_scalar(w2, x, cols);
+    y[3] += dot_scalar(w3, x, cols);
+}
+
+static inline float dot(const float* w, const float* x, size_t cols) {
+    return dot_scalar(w, x, cols);
+}
+
+static inline void dot4_q8(const int8_t* w0, const int8_t* w1, const int8_t* w2, const int8_t* w3,
+                           const float* x, size_t cols, float* s) {
+    s[0] = dot_q8_scalar(w0, x, cols);
+    s[1] = dot_q8_scalar(w1, x, cols);
+    s[2] = dot_q8_scalar(w2, x, cols);
+    s[3] = dot_q8_scalar(w3, x, cols);
+}
+
+static inline float dot_q8(const int8_t* w, const float* x, size_t cols) {
+    return dot_q8_scalar(w, x, cols);
+}
+
+#endif
+
+// Everything below is shared: the matrix-vector kernels are built on the
+// backend's dot4/dot (dot4_q8/dot_q8 for int8 weights), the outer-product
+// and transposed kernels on axpy/axpy4.
+
+void gemv_accumulate(const Matrix& w, const float* x, float* y) {
+    gemm_accumulate(w, x, 0, 1, y, 0);
+}
+
+void gemm_accumulate(const Matrix& w, const float* x, size_t ldx, size_t batch,
+                     float* y, size_t ldy) {
+    const size_t rows = w.rows();
+    const size_t cols = w.cols();
+    size_t r = 0;
+    // A block of four weight rows stays in L1 while it is applied to every batch entry
+    for (; r + 4 <= rows; r += 4) {
+        const float* w0 = w.row(r);
+        const float* w1 = w.row(r + 1);
+        const float* w2 = w.row(r + 2);
+        const float* w3 = w.row(r + 3);
+        for (size_t b = 0; b < batch; ++b) {
+            dot4(w0, w1, w2, w3, x + b * ldx, cols, y + b * ldy + r);
+        }
+    }
+    for (; r < rows; ++r) {
+        for (size_t b = 0; b < batch; ++b) {
+            y[b * ldy + r] += dot(w.row(r), x + b * ldx, cols);
+        }
+    }
+}
+
+template <size_t Cols>
+void gemv_accumulate_fixed(const Matrix& w, const float* x, float* y) {
+    const size_t rows = w.rows();
+    size_t r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        dot4(w.row(r), w.row(r + 1), w.row(r + 2), w.row(r + 3), x, Cols, y + r);
+    }
+    for (; r < rows; ++r) {
+        y[r] += dot(w.row(r), x, Cols);
+    }
+}
+
+#define ADAPAD_INSTANTIATE_GEMV_FIXED(N) \
+    template void gemv_accumulate_fixed<N>(const Matrix& w, const float* x, float* y);
+ADAPAD_FIXED_GEMV_COLS(ADAPAD_INSTANTIATE_GEMV_FIXED)
+#undef ADAPAD_INSTANTIATE_GEMV_FIXED
+
+// Cols = 0 takes the column count at run time
+template <size_t Cols>
+static void gemv_grouped(const float* w, size_t rows, size_t cols, size_t w_step,
+                         const size_t* slots, size_t count,
+                         const float* x, size_t ldx, float* y, size_t ldy) {
+    const size_t n = Cols ? Cols : cols;
+    const size_t stride = Matrix::padded_stride(n);
+    for (size_t k = 0; k < count; ++k) {
+        const float* wk = w + slots[k] * w_step;
+        const float* xk = x + k * ldx;
+        float* yk = y + k * ldy;
+        size_t r = 0;
+        for (; r + 4 <= rows; r += 4) {
+            const float* w0 = wk + r * stride;
+            dot4(w0, w0 + stride, w0 + 2 * stride, w0 + 3 * stride, xk, n, yk + r);
+        }
+        for (; r < rows; ++r) {
+            yk[r] += dot(wk + r * stride, xk, n);
+        }
+    }
+}
+
+void gemv_accumulate_grouped(const float* w, size_t rows, size_t cols, size_t w_step,
+                             const size_t* slots, size_t count,
+                             const float* x, size_t ldx, float* y, size_t ldy) {
+#define ADAPAD_GROUPED_FIXED_CASE(N) \
+    if (cols == N) { \
+        gemv_grouped<N>(w, rows, cols, w_step, slots, count, x, ldx, y, ldy); \
+        return; \
+    }
+    ADAPAD_FIXED_GEMV_COLS(ADAPAD_GROUPED_FIXED_CASE)
+#undef ADAPAD_GROUPED_FIXED_CASE
+    gemv_grouped<0>(w, rows, cols, w_step, slots, count, x, ldx, y, ldy);
+}
+
+void gemv_accumulate_q8(const QuantizedMatrix& w, const float* x, float* y) {
+    const size_t rows = w.rows();
+    const size_t cols = w.cols();
+    size_t r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        float s[4];
+        dot4_q8(w.row(r), w.row(r + 1), w.row(r + 2), w.row(r + 3), x, cols, s);
+        y[r] += w.scale(r) * s[0];
+        y[r + 1] += w.scale(r + 1) * s[1];
+        y[r + 2] += w.scale(r + 2) * s[2];
+        y[r + 3] += w.scale(r + 3) * s[3];
+    }
+    for (; r < rows; ++r) {
+        y[r] += w.scale(r) * dot_q8(w.row(r), x, cols);
+    }
+}
+
+void ger_accumulate(Matrix& a, const float* x, const float* y) {
+    const size_t rows = a.rows();
+    const size_t cols = a.cols();
+    for (size_t r = 0; r < rows; ++r) {
+        axpy(x[r], y, a.row(r), cols);
+    }
+}
+
+void gemv_transposed_accumulate(const Matrix& w, const float* x, float* y) {
+    const size_t rows = w.rows();
+    const size_t cols = w.cols();
+    size_t r = 0;
+    // Four rows per sweep so y is loaded and stored once per four rows
+    for (; r + 4 <= rows; r += 4) {
+        axpy4(x + r, w.row(r), w.row(r + 1), w.row(r + 2), w.row(r + 3), y, cols);
+    }
+    for (; r < rows; ++r) {
+        axpy(x[r], w.row(r), y, cols);
+    }
+}
+
+void ger_accumulate_scalar(Matrix& a, const float* x, const float* y) {
+    for (size_t r = 0; r < a.rows(); ++r) {
+        float* a_r = a.row(r);
+        for (size_t c = 0; c < a.cols(); ++c) {
+            a_r[c] += x[r] * y[c];
+        }
+    }
+}
+
+void gemv_accumulate_q8_scalar(const QuantizedMatrix& w, const float* x, float* y) {
+    for (size_t r = 0; r < w.rows(); ++r) {
+        y[r] += w.scale(r) * dot_q8_scalar(w.row(r), x, w.cols());
+    }
+}
+
+void gemv_transposed_accumulate_scalar(const Matrix& w, const float* x, float* y) {
+    for (size_t r = 0; r < w.rows(); ++r) {
+        const float* w_r = w.row(r);
+        for (size_t c = 0; c < w.cols(); ++c) {
+            y[c] += w_r[c] * x[r];
+        }
+    }
+}
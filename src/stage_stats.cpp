@@ -0,0 +1,152 @@
+#include "stage_stats.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+// Values below 8 ns get a bucket each; above that, 4 buckets per power of
+// two, indexed by the exponent and the two bits after the leading one
+static int bucket_index(uint64_t ns) {
+    if (ns < 8) {
+        return static_cast<int>(ns);
+    }
+    int e = 63 - __builtin_clzll(ns);
+    int m = static_cast<int>((ns >> (e - 2)) & 3);
+    return std::min((e - 1) * 4 + m, StageStats::NUM_BUCKETS - 1);
+}
+
+// Largest value that falls in the bucket
+static uint64_t bucket_upper(int index) {
+    if (index < 8) {
+        return static_cast<uint64_t>(index);
+    }
+    int e = index / 4 + 1;
+    int m = index % 4;
+    return (static_cast<uint64_t>(5 + m) << (e - 2)) - 1;
+}
+
+void StageStats::Histogram::record(uint64_t ns) {
+    ++count;
+    total_ns += ns;
+    max_ns = std::max(max_ns, ns);
+    ++buckets[bucket_index(ns)];
+}
+
+void StageStats::Histogram::merge(const Histogram& other) {
+    count += other.count;
+    total_ns += other.total_ns;
+    max_ns = std::max(max_ns, other.max_ns);
+    for (int i = 0; i < NUM_BUCKETS; ++i) {
+        buckets[i] += other.buckets[i];
+    }
+}
+
+uint64_t StageStats::Histogram::percentile_ns(double p) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(p / 100.0 * count + 0.5);
+    rank = std::min(std::max<uint64_t>(rank, 1), count);
+    uint64_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            // The last bucket is open ended
+            return i + 1 < NUM_BUCKETS ? std::min(bucket_upper(i), max_ns) : max_ns;
+        }
+    }
+    return max_ns;
+}
+
+void StageStats::merge(const StageStats& other) {
+    for (int s = 0; s < NUM_STAGES; ++s) {
+        stages[s].merge(other.stages[s]);
+        epoch_counts[s] += other.epoch_counts[s];
+    }
+    samples += other.samples;
+    anomalies += other.anomalies;
+}
+
+const char* StageStats::stage_name(Stage stage) {
+    switch (stage) {
+        case Normalize: return "normalize";
+        case Predict: return "predict";
+        case Generate: return "generate";
+        case PredictorUpdate: return "predictor_update";
+        case GeneratorUpdate: return "generator_update";
+        case Logging: return "logging";
+        case Checkpoint: return "checkpoint";
+        default: return "unknown";
+    }
+}
+
+std::string StageStats::summary_line() const {
+    std::ostringstream line;
+    char buf[160];
+    line << "stats samples=" << samples << " anomalies=" << anomalies;
+    for (int s = 0; s < NUM_STAGES; ++s) {
+        const Histogram& h = stages[s];
+        if (h.count == 0) {
+            continue;
+        }
+        std::snprintf(buf, sizeof(buf), " | %s n=%llu mean=%.1fus p50=%.1fus p99=%.1fus max=%.1fus",
+                      stage_name(static_cast<Stage>(s)), static_cast<unsigned long long>(h.count),
+                      h.mean_ns() / 1e3, h.percentile_ns(50) / 1e3, h.percentile_ns(99) / 1e3,
+                      h.max_ns / 1e3);
+        line << buf;
+        if (s == PredictorUpdate || s == GeneratorUpdate) {
+            std::snprintf(buf, sizeof(buf), " epochs=%.2f", static_cast<double>(epoch_counts[s]) / h.count);
+            line << buf;
+        }
+    }
+    return line.str();
+}
+
+void StageStats::write_metrics(const std::string& path) const {
+    const std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Cannot write metrics file " + tmp_path);
+        }
+        out << "# HELP adapad_samples_total Samples processed by is_anomalous\n"
+            << "# TYPE adapad_samples_total counter\n"
+            << "adapad_samples_total " << samples << "\n"
+            << "# HELP adapad_anomalies_total Samples flagged as anomalous\n"
+            << "# TYPE adapad_anomalies_total counter\n"
+            << "adapad_anomalies_total " << anomalies << "\n"
+            << "# HELP adapad_stage_seconds Time spent per stage of is_anomalous\n"
+            << "# TYPE adapad_stage_seconds summary\n";
+        const double quantiles[] = {0.5, 0.9, 0.99};
+        for (int s = 0; s < NUM_STAGES; ++s) {
+            const Histogram& h = stages[s];
+            const std::string label = std::string("stage=\"") + stage_name(static_cast<Stage>(s)) + "\"";
+            for (double q : quantiles) {
+                out << "adapad_stage_seconds{" << label << ",quantile=\"" << q << "\"} "
+                    << h.percentile_ns(q * 100) / 1e9 << "\n";
+            }
+            out << "adapad_stage_seconds_sum{" << label << "} " << h.total_ns / 1e9 << "\n"
+                << "adapad_stage_seconds_count{" << label << "} " << h.count << "\n";
+        }
+        out << "# HELP adapad_stage_max_seconds Slowest call per stage\n"
+            << "# TYPE adapad_stage_max_seconds gauge\n";
+        for (int s = 0; s < NUM_STAGES; ++s) {
+            out << "adapad_stage_max_seconds{stage=\"" << stage_name(static_cast<Stage>(s)) << "\"} "
+                << stages[s].max_ns / 1e9 << "\n";
+        }
+        out << "# HELP adapad_update_epochs_total Training epochs run by online updates\n"
+            << "# TYPE adapad_update_epochs_total counter\n";
+        for (int s = PredictorUpdate; s <= GeneratorUpdate; ++s) {
+            out << "adapad_update_epochs_total{stage=\"" << stage_name(static_cast<Stage>(s)) << "\"} "
+                << epoch_counts[s] << "\n";
+        }
+        if (!out.flush()) {
+            throw std::runtime_error("Cannot write metrics file " + tmp_path);
+        }
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("Cannot replace metrics file " + path);
+    }
+}
@@ -0,0 +1,126 @@
+#include "thread_pool.hpp"
+#include <iostream>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+ThreadPool::ThreadPool(size_t num_threads, bool pin_threads)
+    : current_task(nullptr),
+      task_count(0),
+      next_index(0),
+      active_workers(0),
+      generation(0),
+      stopping(false),
+      pin_threads(pin_threads) {
+    
+    if (num_threads == 0) {
+        num_threads = std::thread::hardware_concurrency();
+        if (num_threads == 0) {
+            num_threads = 1;
+        }
+    }
+
+    if (pin_threads) {
+        pin_current_thread(0);
+    }
+
+    workers.reserve(num_threads - 1);
+    for (size_t i = 1; i < num_threads; ++i) {
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start_cv.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+
+    if (workers.empty()) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current_task = &task;
+        task_count = count;
+        next_index.store(0);
+        active_workers = workers.size();
+        ++generation;
+    }
+    start_cv.notify_all();
+
+    // The caller works through the queue alongside the workers
+    run_tasks();
+
+    // Barrier: wait until every worker has drained the queue
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [this] { return active_workers == 0; });
+    current_task = nullptr;
+}
+
+void ThreadPool::run_tasks() {
+    size_t i;
+    while ((i = next_index.fetch_add(1)) < task_count) {
+        (*current_task)(i);
+    }
+}
+
+void ThreadPool::worker_loop(size_t worker_index) {
+    if (pin_threads) {
+        pin_current_thread(worker_index);
+    }
+
+    size_t seen_generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start_cv.wait(lock, [this, seen_generation] {
+                return stopping || generation != seen_generation;
+            });
+            if (stopping) {
+                return;
+            }
+            seen_generation = generation;
+        }
+
+        run_tasks();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --active_workers;
+        }
+        done_cv.notify_one();
+    }
+}
+
+void ThreadPool::pin_current_thread(size_t core) {
+#ifdef __linux__
+    unsigned int cores = std::thread::hardware_concurrency();
+    if (cores == 0) {
+        return;
+    }
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(core % cores, &cpuset);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) != 0) {
+        std::cerr << "Warning: Could not pin thread to core " << core % cores << std::endl;
+    }
+#else
+    (void)core;
+#endif
+}
@@ -0,0 +1,242 @@
+#include "timestep_engine.hpp"
+#include "adapad.hpp"
+#include "normal_data_predictor.hpp"
+#include "anomalous_threshold_generator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+static uint64_t elapsed_ns(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+const size_t BatchedInference::NOT_PACKED;
+
+void BatchedInference::pack(const std::vector<LSTMPredictor*>& models) {
+    // Models with their own fp32 weights of the first such model's shape
+    candidates.clear();
+    for (LSTMPredictor* model : models) {
+        if (model->shares_backbone() ||
+            model->get_inference_precision() != InferencePrecision::Float32) {
+            continue;
+        }
+        const LSTMPredictor* first = candidates.empty() ? model : candidates[0];
+        if (model->get_input_size() == first->get_input_size() &&
+            model->get_hidden_size() == first->get_hidden_size() &&
+            model->get_num_layers() == first->get_num_layers() &&
+            model->get_num_classes() == first->get_num_classes()) {
+            candidates.push_back(model);
+        }
+    }
+    // A single model has nothing to be grouped with
+    if (candidates.size() < 2) {
+        candidates.clear();
+    }
+    
+    // Usually everything is still in place and nothing is copied
+    bool in_place = candidates == packed_models;
+    const size_t block = candidates.empty() ? 0 : candidates[0]->packed_floats();
+    for (size_t s = 0; in_place && s < candidates.size(); ++s) {
+        in_place = candidates[s]->is_packed_at(packed_weights->data() + s * block);
+    }
+    if (!in_place) {
+        packed_models = candidates;
+        packed_weights.reset();
+        if (!packed_models.empty()) {
+            ++packs;
+            packed_weights = std::make_shared<AlignedVector>(packed_models.size() * block, 0.0f);
+            for (size_t s = 0; s < packed_models.size(); ++s) {
+                packed_models[s]->pack_weights(packed_weights->data() + s * block, packed_weights);
+            }
+        }
+    }
+    
+    packed_slot.assign(models.size(), NOT_PACKED);
+    for (size_t i = 0, s = 0; i < models.size() && s < packed_models.size(); ++i) {
+        if (models[i] == packed_models[s]) {
+            packed_slot[i] = s++;
+        }
+    }
+}
+
+BatchedInference::Group& BatchedInference::new_group() {
+    if (groups.size() <= used_groups) {
+        groups.resize(used_groups + 1);
+    }
+    Group& group = groups[used_groups++];
+    group.packed = false;
+    group.members.clear();
+    group.models.clear();
+    group.slots.clear();
+    return group;
+}
+
+void BatchedInference::regroup(const std::vector<LSTMPredictor*>& models, const std::vector<char>* active,
+                               size_t packed_chunks) {
+    used_groups = 0;
+    group_ids.clear();
+    packed_members.clear();
+    
+    // Tied models by backbone; a model with its own weights is a group of one
+    for (size_t i = 0; i < models.size(); ++i) {
+        if (active && !(*active)[i]) {
+            continue;
+        }
+        if (packed_slot[i] != NOT_PACKED) {
+            packed_members.push_back(i);
+            continue;
+        }
+        const void* id = models[i]->backbone_id();
+        size_t g = std::find(group_ids.begin(), group_ids.end(), id) - group_ids.begin();
+        if (g == group_ids.size()) {
+            group_ids.push_back(id);
+            new_group();
+        }
+        groups[g].members.push_back(i);
+        groups[g].models.push_back(models[i]);
+    }
+    
+    // Packed models in contiguous chunks
+    const size_t chunks = std::min(packed_chunks, packed_members.size());
+    for (size_t c = 0; c < chunks; ++c) {
+        Group& group = new_group();
+        group.packed = true;
+        const size_t begin = packed_members.size() * c / chunks;
+        const size_t end = packed_members.size() * (c + 1) / chunks;
+        for (size_t m = begin; m < end; ++m) {
+            const size_t i = packed_members[m];
+            group.members.push_back(i);
+            group.models.push_back(models[i]);
+            group.slots.push_back(packed_slot[i]);
+        }
+    }
+}
+
+void BatchedInference::run(const std::vector<LSTMPredictor*>& models, const float* x, size_t stride,
+                           size_t seq_len, const std::vector<char>* active, float* out, uint64_t* model_ns,
+                           ThreadPool& pool) {
+    pack(models);
+    regroup(models, active, pool.size());
+    
+    pool.parallel_for(used_groups, [&](size_t g) {
+        Group& group = groups[g];
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        
+        if (group.members.size() == 1) {
+            const size_t i = group.members[0];
+            out[i] = models[i]->infer(x + i * stride, seq_len)[0];
+            model_ns[i] = elapsed_ns(start);
+            return;
+        }
+        
+        // Gather the inputs, one pass over the group, scatter the outputs
+        LSTMPredictor& lead = *group.models[0];
+        const size_t width = seq_len * lead.get_input_size();
+        const size_t classes = lead.get_num_classes();
+        group.x.resize(group.members.size() * width);
+        group.out.resize(group.members.size() * classes);
+        for (size_t b = 0; b < group.members.size(); ++b) {
+            const float* src = x + group.members[b] * stride;
+            std::copy(src, src + width, group.x.begin() + b * width);
+        }
+        if (group.packed) {
+            lead.infer_packed(group.models, packed_weights->data(), group.slots,
+                              group.x.data(), seq_len, group.out.data());
+        } else {
+            lead.infer_tied(group.models, group.x.data(), seq_len, group.out.data());
+        }
+        
+        const uint64_t share = elapsed_ns(start) / group.members.size();
+        for (size_t b = 0; b < group.members.size(); ++b) {
+            out[group.members[b]] = group.out[b * classes];
+            model_ns[group.members[b]] = share;
+        }
+    });
+}
+
+TimestepEngine::TimestepEngine(const std::vector<AdapAD*>& models)
+    : models(models),
+      lookback_len(0),
+      batched_time(0.0) {
+    for (AdapAD* model : models) {
+        predictors.push_back(&model->data_predictor->model());
+        generators.push_back(&model->generator->model());
+    }
+    if (!models.empty()) {
+        lookback_len = predictors[0]->get_input_size();
+    }
+    windows.assign(models.size() * lookback_len, 0.0f);
+    outputs.assign(models.size(), 0.0f);
+    forward_ns.assign(models.size(), 0);
+    active.assign(models.size(), 0);
+    needs_threshold.assign(models.size(), 0);
+    anomalous.assign(models.size(), 0);
+    errors.resize(models.size());
+}
+
+void TimestepEngine::step(const std::vector<float>& values, ThreadPool& pool, const StageRunner& run_stage) {
+    const size_t count = models.size();
+    
+    // Runs one stage of model i unless an earlier stage failed
+    auto stage = [&](size_t i, const std::function<void()>& work) {
+        if (!active[i]) {
+            return;
+        }
+        run_stage(i, [&]() {
+            try {
+                work();
+            } catch (const std::exception& e) {
+                errors[i] = e.what();
+                active[i] = 0;
+            }
+        });
+    };
+    
+    for (size_t i = 0; i < count; ++i) {
+        active[i] = 1;
+        needs_threshold[i] = 0;
+        anomalous[i] = 0;
+        errors[i].clear();
+    }
+    
+    pool.parallel_for(count, [&](size_t i) {
+        stage(i, [&]() {
+            const auto& window = models[i]->begin_sample(values[i])[0][0];
+            std::copy(window.begin(), window.end(), windows.begin() + i * lookback_len);
+        });
+    });
+    
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    predictor_pass.run(predictors, windows.data(), lookback_len, 1, &active,
+                       outputs.data(), forward_ns.data(), pool);
+    batched_time = elapsed_ns(start) * 1e-9;
+    
+    pool.parallel_for(count, [&](size_t i) {
+        stage(i, [&]() {
+            const float predicted = NormalDataPredictor::to_prediction(outputs[i]);
+            const std::vector<float>* past_errors = models[i]->end_prediction(predicted, forward_ns[i]);
+            forward_ns[i] = 0;
+            if (past_errors) {
+                std::copy(past_errors->begin(), past_errors->end(), windows.begin() + i * lookback_len);
+                needs_threshold[i] = 1;
+            }
+        });
+    });
+    
+    start = std::chrono::steady_clock::now();
+    generator_pass.run(generators, windows.data(), lookback_len, 1, &needs_threshold,
+                       outputs.data(), forward_ns.data(), pool);
+    batched_time += elapsed_ns(start) * 1e-9;
+    
+    pool.parallel_for(count, [&](size_t i) {
+        stage(i, [&]() {
+            const float minimal_threshold = models[i]->get_minimal_threshold();
+            const float threshold = needs_threshold[i]
+                ? AnomalousThresholdGenerator::to_threshold(outputs[i], minimal_threshold)
+                : minimal_threshold;
+            anomalous[i] = models[i]->finish_sample(threshold, forward_ns[i]);
+            models[i]->clean();
+        });
+    });
+}
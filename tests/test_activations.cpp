@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include "activations.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+double ref_sigmoid(float x) { return 1.0 / (1.0 + std::exp(-static_cast<double>(x))); }
+double ref_tanh(float x) { return std::tanh(static_cast<double>(x)); }
+
+// Every 997th finite float pattern of both signs plus a dense sweep of the
+// range the gates actually see.
+std::vector<float> sweep_inputs() {
+    std::vector<float> xs;
+    for (uint64_t bits = 0; bits < 0x7f800000u; bits += 997) {
+        uint32_t b = static_cast<uint32_t>(bits);
+        float x;
+        std::memcpy(&x, &b, sizeof(x));
+        xs.push_back(x);
+        xs.push_back(-x);
+    }
+    for (int i = -200000; i <= 200000; ++i) xs.push_back(i * 1e-4f);
+    return xs;
+}
+
+}
+
+TEST(ActivationsTest, FastSigmoidWithinBound) {
+    std::vector<float> xs = sweep_inputs();
+    std::vector<float> out(xs.size());
+    apply_sigmoid(xs.data(), out.data(), xs.size(), Activation::Fast);
+    double worst = 0.0;
+    for (size_t i = 0; i < xs.size(); ++i)
+        worst = std::max(worst, std::fabs(out[i] - ref_sigmoid(xs[i])));
+    EXPECT_LE(worst, FAST_SIGMOID_MAX_ABS_ERROR);
+}
+
+TEST(ActivationsTest, FastTanhWithinBound) {
+    std::vector<float> xs = sweep_inputs();
+    std::vector<float> out(xs.size());
+    apply_tanh(xs.data(), out.data(), xs.size(), Activation::Fast);
+    double worst = 0.0;
+    for (size_t i = 0; i < xs.size(); ++i)
+        worst = std::max(worst, std::fabs(out[i] - ref_tanh(xs[i])));
+    EXPECT_LE(worst, FAST_TANH_MAX_ABS_ERROR);
+}
+
+TEST(ActivationsTest, ExactMatchesLibm) {
+    std::vector<float> xs;
+    for (int i = -1000; i <= 1000; ++i) xs.push_back(i * 0.037f);
+    std::vector<float> sig(xs.size()), th(xs.size());
+    apply_sigmoid(xs.data(), sig.data(), xs.size(), Activation::Exact);
+    apply_tanh(xs.data(), th.data(), xs.size(), Activation::Exact);
+    for (size_t i = 0; i < xs.size(); ++i) {
+        EXPECT_EQ(sig[i], 1.0f / (1.0f + std::exp(-xs[i])));
+        EXPECT_EQ(th[i], std::tanh(xs[i]));
+    }
+}
+
+TEST(ActivationsTest, FastSaturatesAtInfinity) {
+    const float inf = std::numeric_limits<float>::infinity();
+    std::vector<float> xs = {inf, -inf, 1e30f, -1e30f};
+    std::vector<float> sig(xs.size()), th(xs.size());
+    apply_sigmoid(xs.data(), sig.data(), xs.size(), Activation::Fast);
+    apply_tanh(xs.data(), th.data(), xs.size(), Activation::Fast);
+    EXPECT_FLOAT_EQ(sig[0], 1.0f);
+    EXPECT_NEAR(sig[1], 0.0f, FAST_SIGMOID_MAX_ABS_ERROR);
+    EXPECT_FLOAT_EQ(sig[2], 1.0f);
+    EXPECT_NEAR(sig[3], 0.0f, FAST_SIGMOID_MAX_ABS_ERROR);
+    EXPECT_FLOAT_EQ(th[0], 1.0f);
+    EXPECT_FLOAT_EQ(th[1], -1.0f);
+    EXPECT_FLOAT_EQ(th[2], 1.0f);
+    EXPECT_FLOAT_EQ(th[3], -1.0f);
+}
+
+TEST(ActivationsTest, InPlaceMatchesOutOfPlace) {
+    // Odd length so the scalar tail after the SIMD blocks is covered too
+    std::vector<float> xs;
+    for (int i = 0; i < 37; ++i) xs.push_back(-9.0f + i * 0.5f);
+    for (int k = 0; k < 2; ++k) {
+        Activation kind = k ? Activation::Fast : Activation::Exact;
+        std::vector<float> out(xs.size()), inplace = xs;
+        apply_tanh(xs.data(), out.data(), xs.size(), kind);
+        apply_tanh(inplace.data(), inplace.data(), inplace.size(), kind);
+        EXPECT_EQ(out, inplace);
+    }
+}
+
+TEST(ActivationsTest, ParseActivation) {
+    EXPECT_EQ(parse_activation("exact"), Activation::Exact);
+    EXPECT_EQ(parse_activation("fast"), Activation::Fast);
+    EXPECT_STREQ(activation_name(Activation::Fast), "fast");
+    EXPECT_THROW(parse_activation("approx"), std::runtime_error);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
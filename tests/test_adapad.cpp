@@ -0,0 +1,330 @@
+#define TESTING
+#include <gtest/gtest.h>
+#include "adapad.hpp"
+#include "config.hpp"
+#include "checkpoint.hpp"
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <sys/stat.h>
+
+// Range of the Tide_pressure sensor in config.yaml
+static const float LOWER = 713.0f;
+static const float UPPER = 763.0f;
+static const int TRAIN_SIZE = 10;
+
+class AdapADWindowTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Config& config = Config::getInstance();
+        config.log_file_path = "/tmp/adapad_test_logs";
+        config.save_path = "/tmp/adapad_test_states";
+        config.LSTM_size = 8;
+        config.LSTM_size_layer = 1;
+
+        PredictorConfig predictor_config = {};
+        predictor_config.lookback_len = 3;
+        predictor_config.prediction_len = 1;
+        predictor_config.train_size = TRAIN_SIZE;
+        ValueRangeConfig range = {LOWER, UPPER};
+        detector.reset(new AdapAD(predictor_config, range, 0.01f, "window_test"));
+    }
+
+    // The pre-incremental rule: denormalize, compare with the raw bounds
+    static bool old_inside_range(float val) {
+        float normalized = (val - LOWER) / (UPPER - LOWER);
+        float denormalized = normalized * (UPPER - LOWER) + LOWER;
+        return denormalized >= LOWER && denormalized <= UPPER;
+    }
+
+    std::unique_ptr<AdapAD> detector;
+};
+
+TEST_F(AdapADWindowTest, OutOfRangeCountFollowsTheTrainWindow) {
+    // Runs in and out of range, longer than the window, so values with either
+    // verdict enter and leave it
+    std::vector<float> values;
+    for (int i = 0; i < 12; ++i) values.push_back(740.0f);
+    for (int i = 0; i < 8; ++i) values.push_back(800.0f);
+    for (int i = 0; i < 4; ++i) values.push_back(700.0f);
+    for (int i = 0; i < 15; ++i) values.push_back(i % 3 == 0 ? 0.0f : 750.0f);
+    for (int i = 0; i < 12; ++i) values.push_back(720.0f);
+
+    std::deque<float> window;
+    for (size_t i = 0; i < values.size(); ++i) {
+        detector->observe(values[i]);
+        window.push_back(values[i]);
+        if (window.size() > static_cast<size_t>(TRAIN_SIZE)) {
+            window.pop_front();
+        }
+        int expected = 0;
+        for (float v : window) {
+            if (v < LOWER || v > UPPER) ++expected;
+        }
+        ASSERT_EQ(detector->get_out_of_range_count(), expected) << "after value " << i;
+        EXPECT_EQ(detector->default_normal(), expected > TRAIN_SIZE / 2) << "after value " << i;
+    }
+    EXPECT_EQ(detector->get_out_of_range_count(), 0);
+}
+
+TEST_F(AdapADWindowTest, TrainingDataResetsTheCount) {
+    for (int i = 0; i < TRAIN_SIZE; ++i) detector->observe(900.0f);
+    EXPECT_TRUE(detector->default_normal());
+
+    detector->set_training_data({740.0f, 800.0f, 745.0f});
+    EXPECT_EQ(detector->get_out_of_range_count(), 1);
+    EXPECT_FALSE(detector->default_normal());
+}
+
+TEST_F(AdapADWindowTest, RangeCheckAgreesWithTheRawBounds) {
+    const float inf = std::numeric_limits<float>::infinity();
+    std::vector<float> values = {LOWER, UPPER, 738.0f, 0.0f, -1.0f, 1e6f};
+    // A few ulps either side of both bounds
+    for (float bound : {LOWER, UPPER}) {
+        float below = bound, above = bound;
+        for (int i = 0; i < 4; ++i) {
+            below = std::nextafter(below, -inf);
+            above = std::nextafter(above, inf);
+            values.push_back(below);
+            values.push_back(above);
+        }
+    }
+    for (float v : values) {
+        EXPECT_EQ(detector->inside_range(v), v >= LOWER && v <= UPPER) << v;
+        EXPECT_EQ(detector->inside_range(v), old_inside_range(v)) << v;
+    }
+    // NaN (a missing reading) was out of range before and still is
+    EXPECT_FALSE(detector->inside_range(std::nanf("")));
+    EXPECT_FALSE(old_inside_range(std::nanf("")));
+}
+
+// Saves written before the checkpoint container, and files that only look like them
+class AdapADLegacyLoadTest : public AdapADWindowTest {
+protected:
+    void SetUp() override {
+        AdapADWindowTest::SetUp();
+        mkdir(Config::getInstance().save_path.c_str(), 0777);
+        detector->data_predictor->initialize_layer_cache();
+        detector->generator->initialize_layer_cache();
+        original = predictions();
+    }
+
+    std::string model_file(const std::string& timestamp) {
+        return Config::getInstance().save_path + "/window_test_model_" + timestamp + ".bin";
+    }
+
+    // The stream layout the old save_models wrote
+    void write_legacy(const std::string& timestamp, float minimal_threshold) {
+        std::ofstream file(model_file(timestamp), std::ios::binary | std::ios::trunc);
+        const float meta[3] = {minimal_threshold, LOWER, UPPER};
+        file.write(reinterpret_cast<const char*>(meta), sizeof(meta));
+        detector->data_predictor->save_layer_cache(file);
+        detector->generator->save_layer_cache(file);
+        detector->data_predictor->save_weights(file);
+        detector->data_predictor->save_biases(file);
+        detector->generator->save_weights(file);
+        detector->generator->save_biases(file);
+    }
+
+    void overwrite(const std::string& timestamp, std::vector<char> bytes) {
+        std::ofstream file(model_file(timestamp), std::ios::binary | std::ios::trunc);
+        file.write(bytes.data(), bytes.size());
+    }
+
+    std::vector<char> read(const std::string& timestamp) {
+        std::ifstream file(model_file(timestamp), std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    // Changes both models after a file was written from them
+    void perturb() {
+        detector->data_predictor->model().set_fc_weights({std::vector<float>(8, 0.25f)}, {0.5f});
+        detector->generator->model().set_fc_weights({std::vector<float>(8, -0.25f)}, {0.1f});
+        perturbed = predictions();
+        ASSERT_NE(perturbed, original);
+    }
+
+    std::vector<float> predictions() {
+        const float x[3] = {0.2f, 0.4f, 0.6f};
+        return {detector->data_predictor->model().infer(x, 1)[0],
+                detector->generator->model().infer(x, 1)[0]};
+    }
+
+    void expect_rejected(const std::string& timestamp) {
+        EXPECT_THROW(detector->load_models(timestamp, initial), std::runtime_error);
+        EXPECT_EQ(detector->get_minimal_threshold(), 0.01f);
+        EXPECT_EQ(predictions(), perturbed);
+    }
+
+    std::vector<float> original, perturbed;
+    std::vector<float> initial = {740.0f, 741.0f, 742.0f};
+};
+
+TEST_F(AdapADLegacyLoadTest, LoadsLegacyFile) {
+    write_legacy("legacy", 0.05f);
+    perturb();
+    detector->load_models("legacy", initial);
+    EXPECT_EQ(detector->get_minimal_threshold(), 0.05f);
+    EXPECT_EQ(predictions(), original);
+}
+
+TEST_F(AdapADLegacyLoadTest, RejectsTruncatedOrPaddedFile) {
+    write_legacy("legacy", 0.05f);
+    std::vector<char> bytes = read("legacy");
+    perturb();
+
+    overwrite("short", std::vector<char>(bytes.begin(), bytes.end() - 4));
+    expect_rejected("short");
+    std::vector<char> padded = bytes;
+    padded.push_back(0);
+    overwrite("padded", padded);
+    expect_rejected("padded");
+}
+
+TEST_F(AdapADLegacyLoadTest, RejectsWrongSizes) {
+    write_legacy("legacy", 0.05f);
+    std::vector<char> bytes = read("legacy");
+    perturb();
+
+    // The predictor's cache batch count, then its first state size
+    // (3 meta floats, num_batches = 0, state_layers), made huge
+    std::vector<char> corrupt = bytes;
+    const size_t huge = size_t(1) << 40;
+    std::memcpy(&corrupt[3 * sizeof(float)], &huge, sizeof(huge));
+    overwrite("batches", corrupt);
+    expect_rejected("batches");
+    corrupt = bytes;
+    std::memcpy(&corrupt[3 * sizeof(float) + 2 * sizeof(size_t)], &huge, sizeof(huge));
+    overwrite("state", corrupt);
+    expect_rejected("state");
+
+    // Implausible metadata
+    corrupt = bytes;
+    const float nan = std::nanf("");
+    std::memcpy(&corrupt[0], &nan, sizeof(nan));
+    overwrite("meta", corrupt);
+    expect_rejected("meta");
+}
+
+TEST_F(AdapADLegacyLoadTest, RejectsCheckpointWithDamagedMagic) {
+    CheckpointWriter ckpt;
+    const float meta[3] = {0.05f, LOWER, UPPER};
+    ckpt.add_floats("adapad.meta", meta, 3);
+    detector->data_predictor->save_checkpoint(ckpt, "predictor.");
+    detector->generator->save_checkpoint(ckpt, "generator.");
+    ckpt.write(model_file("checkpoint"));
+    perturb();
+
+    std::vector<char> bytes = read("checkpoint");
+    bytes[0] ^= 0x20;
+    overwrite("damaged", bytes);
+    EXPECT_FALSE(CheckpointReader::is_checkpoint(model_file("damaged")));
+    expect_rejected("damaged");
+
+    // Still loads undamaged
+    detector->load_models("checkpoint", initial);
+    EXPECT_EQ(predictions(), original);
+}
+
+// train_shared groups across a save and a restart
+class AdapADSharedBackboneTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Config& config = Config::getInstance();
+        config.log_file_path = "/tmp/adapad_test_logs";
+        config.save_path = "/tmp/adapad_test_states";
+        config.LSTM_size = 8;
+        config.LSTM_size_layer = 1;
+        config.epoch_train = 3;
+        config.lr_train = 0.01f;
+        config.batch_size = 1;
+    }
+
+    static std::vector<std::unique_ptr<AdapAD>> make_group() {
+        PredictorConfig predictor_config = {};
+        predictor_config.lookback_len = 3;
+        predictor_config.prediction_len = 1;
+        predictor_config.train_size = TRAIN_SIZE;
+        ValueRangeConfig range = {LOWER, UPPER};
+        std::vector<std::unique_ptr<AdapAD>> group;
+        for (const char* name : {"shared_a", "shared_b", "shared_c"}) {
+            group.emplace_back(new AdapAD(predictor_config, range, 0.01f, name));
+        }
+        return group;
+    }
+
+    static std::vector<AdapAD*> pointers(const std::vector<std::unique_ptr<AdapAD>>& group) {
+        std::vector<AdapAD*> out;
+        for (const auto& model : group) out.push_back(model.get());
+        return out;
+    }
+
+    static std::vector<float> predictions(AdapAD& model) {
+        const float x[3] = {0.2f, 0.4f, 0.6f};
+        return {model.data_predictor->model().infer(x, 1)[0],
+                model.generator->model().infer(x, 1)[0]};
+    }
+
+    std::vector<float> initial = {740.0f, 741.0f, 742.0f};
+};
+
+TEST_F(AdapADSharedBackboneTest, CheckpointsRestoreTheTies) {
+    std::vector<std::unique_ptr<AdapAD>> trained = make_group();
+    for (size_t m = 0; m < trained.size(); ++m) {
+        std::vector<float> data;
+        for (int i = 0; i < TRAIN_SIZE; ++i) data.push_back(735.0f + 5.0f * m + std::sin(0.5f * i));
+        trained[m]->set_training_data(data);
+    }
+    AdapAD::train_shared(pointers(trained));
+    for (const auto& model : trained) model->save_models();
+    AdapAD::wait_for_saves();
+
+    std::vector<std::unique_ptr<AdapAD>> restored = make_group();
+    for (const auto& model : restored) {
+        model->load_latest_model(initial);
+        EXPECT_FALSE(model->data_predictor->shares_backbone());
+    }
+    AdapAD::retie_shared(pointers(restored));
+
+    for (size_t m = 0; m < restored.size(); ++m) {
+        EXPECT_TRUE(restored[m]->data_predictor->shares_backbone()) << m;
+        EXPECT_TRUE(restored[m]->generator->shares_backbone()) << m;
+        EXPECT_EQ(restored[m]->data_predictor->model().backbone_id(),
+                  restored[0]->data_predictor->model().backbone_id()) << m;
+        EXPECT_EQ(restored[m]->generator->model().backbone_id(),
+                  restored[0]->generator->model().backbone_id()) << m;
+        // Each keeps its own head
+        EXPECT_EQ(predictions(*restored[m]), predictions(*trained[m])) << m;
+    }
+}
+
+TEST_F(AdapADSharedBackboneTest, WithoutTheOwnerModelsStayUntied) {
+    std::vector<std::unique_ptr<AdapAD>> trained = make_group();
+    for (const auto& model : trained) {
+        std::vector<float> data(TRAIN_SIZE, 740.0f);
+        model->set_training_data(data);
+    }
+    AdapAD::train_shared(pointers(trained));
+    for (const auto& model : trained) model->save_models();
+    AdapAD::wait_for_saves();
+
+    std::vector<std::unique_ptr<AdapAD>> restored = make_group();
+    for (const auto& model : restored) model->load_latest_model(initial);
+    // The owner is retrained instead of restored, so its backbone changed
+    restored[0]->data_predictor->model().set_lstm_bias(0, std::vector<float>(32, 0.5f),
+                                                       std::vector<float>(32, 0.5f));
+    AdapAD::retie_shared(pointers(restored));
+    for (const auto& model : restored) {
+        EXPECT_FALSE(model->data_predictor->shares_backbone());
+        EXPECT_FALSE(model->generator->shares_backbone());
+    }
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
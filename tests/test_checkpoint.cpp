@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include "checkpoint.hpp"
+#include "lstm_predictor.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class CheckpointTest : public ::testing::Test {
+protected:
+    const std::string path = "checkpoint_test.bin";
+
+    void TearDown() override {
+        std::remove(path.c_str());
+    }
+
+    std::vector<char> read_file() {
+        std::ifstream in(path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    void write_file(const std::vector<char>& bytes) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), bytes.size());
+    }
+
+    void write_sample() {
+        Matrix m(5, 3);
+        for (size_t r = 0; r < m.rows(); ++r)
+            for (size_t c = 0; c < m.cols(); ++c)
+                m[r][c] = r * 10.0f + c;
+        CheckpointWriter writer;
+        writer.add_floats("meta", std::vector<float>{1.5f, -2.0f});
+        writer.add_matrix("weights", m);
+        writer.write(path);
+    }
+};
+
+TEST_F(CheckpointTest, RoundTrip) {
+    write_sample();
+    ASSERT_TRUE(CheckpointReader::is_checkpoint(path));
+
+    CheckpointReader reader(path);
+    EXPECT_EQ(reader.version(), CHECKPOINT_VERSION);
+    EXPECT_TRUE(reader.has("meta"));
+    EXPECT_FALSE(reader.has("missing"));
+    EXPECT_EQ(reader.read_floats("meta"), std::vector<float>({1.5f, -2.0f}));
+
+    Matrix copy;
+    reader.read_matrix("weights", copy);
+    ASSERT_EQ(copy.rows(), 5u);
+    ASSERT_EQ(copy.cols(), 3u);
+    EXPECT_EQ(copy[4][2], 42.0f);
+    EXPECT_FALSE(copy.is_attached());
+    EXPECT_THROW(reader.read_floats("missing"), std::runtime_error);
+}
+
+TEST_F(CheckpointTest, ViewIsZeroCopyAndPrivate) {
+    write_sample();
+    Matrix view;
+    {
+        CheckpointReader reader(path);
+        reader.view_matrix("weights", view);
+    }
+    // The mapping outlives the reader while the matrix uses it
+    ASSERT_TRUE(view.is_attached());
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(view.data()) % 16, 0u);
+    EXPECT_EQ(view[2][1], 21.0f);
+
+    // Writes stay in this process, the file is unchanged
+    view[2][1] = -1.0f;
+    CheckpointReader again(path);
+    Matrix fresh;
+    again.read_matrix("weights", fresh);
+    EXPECT_EQ(fresh[2][1], 21.0f);
+
+    // Copies own their storage
+    Matrix copy = view;
+    EXPECT_FALSE(copy.is_attached());
+    EXPECT_EQ(copy[2][1], -1.0f);
+}
+
+TEST_F(CheckpointTest, DetectsCorruption) {
+    write_sample();
+    std::vector<char> good = read_file();
+
+    // One flipped bit in a payload, in the section table and in the header
+    for (size_t pos : {good.size() - 70, (size_t)64 + 5, (size_t)9}) {
+        std::vector<char> bad = good;
+        bad[pos] ^= 0x10;
+        write_file(bad);
+        EXPECT_THROW(CheckpointReader reader(path), std::runtime_error) << "byte " << pos;
+    }
+
+    std::vector<char> truncated(good.begin(), good.end() - 64);
+    write_file(truncated);
+    EXPECT_THROW(CheckpointReader reader(path), std::runtime_error);
+}
+
+TEST_F(CheckpointTest, LegacyFilesAreNotCheckpoints) {
+    write_file(std::vector<char>(32, 0));
+    EXPECT_FALSE(CheckpointReader::is_checkpoint(path));
+}
+
+TEST_F(CheckpointTest, LSTMRoundTripPredictsTheSame) {
+    LSTMPredictor saved(1, 3, 16, 2, 3);
+    saved.set_random_seed(5);
+    CheckpointWriter writer;
+    saved.save_checkpoint(writer, "p.");
+    writer.write(path);
+
+    LSTMPredictor loaded(1, 3, 16, 2, 3);
+    loaded.set_random_seed(99);
+    CheckpointReader reader(path);
+    loaded.load_checkpoint(reader, "p.");
+
+    std::vector<float> x = {0.2f, 0.5f, 0.9f};
+    EXPECT_EQ(saved.infer(x.data(), 1)[0], loaded.infer(x.data(), 1)[0]);
+
+    // Training updates the mapped weights in place
+    std::vector<std::vector<std::vector<float>>> batch(1, std::vector<std::vector<float>>(1, x));
+    loaded.train_step(batch, {0.3f}, loaded.forward(batch), 0.1f);
+    EXPECT_NE(saved.infer(x.data(), 1)[0], loaded.infer(x.data(), 1)[0]);
+
+    LSTMPredictor wrong_shape(1, 3, 8, 2, 3);
+    EXPECT_THROW(wrong_shape.load_checkpoint(reader, "p."), std::runtime_error);
+}
+
+TEST_F(CheckpointTest, OlderTapeSectionsAreIgnored) {
+    LSTMPredictor saved(1, 3, 16, 2, 3);
+    saved.set_random_seed(5);
+    CheckpointWriter writer;
+    saved.save_checkpoint(writer, "p.");
+    // Version 1 files also carried the activation tape
+    writer.add_matrix("p.tape.hidden_state", Matrix(2, 16, 0.5f));
+    writer.write(path);
+
+    LSTMPredictor loaded(1, 3, 16, 2, 3);
+    CheckpointReader reader(path);
+    loaded.load_checkpoint(reader, "p.");
+    std::vector<float> x = {0.2f, 0.5f, 0.9f};
+    EXPECT_EQ(saved.infer(x.data(), 1)[0], loaded.infer(x.data(), 1)[0]);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include "checkpoint_saver.hpp"
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class CheckpointSaverTest : public ::testing::Test {
+protected:
+    const std::string path = "checkpoint_saver_test.bin";
+    const std::string tmp_path = "./.checkpoint_saver_test.bin.tmp";
+
+    void TearDown() override {
+        std::remove(path.c_str());
+        std::remove(tmp_path.c_str());
+    }
+
+    static bool exists(const std::string& file) {
+        return std::ifstream(file).good();
+    }
+
+    static CheckpointWriter snapshot(float value) {
+        CheckpointWriter writer;
+        writer.add_floats("value", std::vector<float>{value});
+        return writer;
+    }
+
+    float saved_value() {
+        CheckpointReader reader(path);
+        std::vector<float> value = reader.read_floats("value");
+        return value.at(0);
+    }
+};
+
+TEST_F(CheckpointSaverTest, WriteReplacesFileWithoutLeavingTemp) {
+    snapshot(1.0f).write(path);
+    snapshot(2.0f).write(path);
+    EXPECT_FLOAT_EQ(saved_value(), 2.0f);
+    EXPECT_FALSE(exists(tmp_path));
+}
+
+TEST_F(CheckpointSaverTest, WritesInBackgroundAndRunsCallbackAfterwards) {
+    CheckpointSaver saver;
+    std::atomic<bool> file_was_there(false);
+    saver.submit("model", snapshot(3.0f), path, [&]() {
+        file_was_there = exists(path);
+    });
+    saver.wait_idle();
+    EXPECT_TRUE(file_was_there);
+    EXPECT_FLOAT_EQ(saved_value(), 3.0f);
+    EXPECT_EQ(saver.failed_count(), 0u);
+}
+
+TEST_F(CheckpointSaverTest, LatestSnapshotWins) {
+    CheckpointSaver saver;
+    for (int i = 0; i < 50; ++i) {
+        saver.submit("model", snapshot(static_cast<float>(i)), path);
+    }
+    saver.wait_idle();
+    EXPECT_FLOAT_EQ(saved_value(), 49.0f);
+}
+
+TEST_F(CheckpointSaverTest, PendingJobsAreWrittenOnDestruction) {
+    {
+        CheckpointSaver saver;
+        saver.submit("model", snapshot(4.0f), path);
+    }
+    EXPECT_FLOAT_EQ(saved_value(), 4.0f);
+}
+
+TEST_F(CheckpointSaverTest, FailedWriteIsCountedAndSkipsCallback) {
+    CheckpointSaver saver;
+    bool called = false;
+    saver.submit("model", snapshot(5.0f), "no_such_dir/ckpt.bin", [&]() { called = true; });
+    saver.wait_idle();
+    EXPECT_FALSE(called);
+    EXPECT_EQ(saver.failed_count(), 1u);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
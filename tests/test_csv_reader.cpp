@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include "csv_reader.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CSVStreamReaderTest : public ::testing::Test {
+protected:
+    std::string path;
+
+    void SetUp() override {
+        path = "csv_reader_test_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()) + ".csv";
+    }
+
+    void TearDown() override {
+        std::remove(path.c_str());
+    }
+
+    void write(const std::string& text, bool append = false) {
+        std::ofstream out(path, append ? std::ios::app : std::ios::trunc);
+        out << text;
+    }
+};
+
+TEST_F(CSVStreamReaderTest, ParsesAllColumnsOfEachRow) {
+    write("time,a,b,c\n"
+          "t0,1.5,2.25, -3\r\n"
+          "t1,4,5,6\n");
+    CSVStreamReader reader(path);
+    ASSERT_EQ(reader.columns(), std::vector<std::string>({"a", "b", "c"}));
+
+    std::vector<float> row;
+    ASSERT_TRUE(reader.next_row(row));
+    EXPECT_EQ(row, std::vector<float>({1.5f, 2.25f, -3.0f}));
+    ASSERT_TRUE(reader.next_row(row));
+    EXPECT_EQ(row, std::vector<float>({4.0f, 5.0f, 6.0f}));
+    EXPECT_FALSE(reader.next_row(row));
+    EXPECT_EQ(reader.rows_read(), 2u);
+}
+
+TEST_F(CSVStreamReaderTest, InvalidAndMissingFieldsBecomeMissingValue) {
+    write("time,a,b,c\n"
+          "t0,NA,abc,0.0\n"
+          "t1,7\n");
+    CSVStreamReader reader(path);
+
+    std::vector<float> row;
+    ASSERT_TRUE(reader.next_row(row));
+    EXPECT_EQ(row, std::vector<float>(3, CSVStreamReader::MISSING_VALUE));
+    ASSERT_TRUE(reader.next_row(row));
+    EXPECT_EQ(row, std::vector<float>({7.0f, CSVStreamReader::MISSING_VALUE, CSVStreamReader::MISSING_VALUE}));
+    EXPECT_EQ(reader.invalid_count(0), 1u);
+    EXPECT_EQ(reader.invalid_count(1), 2u);
+    EXPECT_EQ(reader.invalid_count(2), 2u);
+}
+
+TEST_F(CSVStreamReaderTest, LastLineWithoutNewline) {
+    write("time,a\nt0,1\nt1,2");
+    CSVStreamReader reader(path);
+
+    std::vector<float> row;
+    ASSERT_TRUE(reader.next_row(row));
+    ASSERT_TRUE(reader.next_row(row));
+    EXPECT_EQ(row[0], 2.0f);
+    EXPECT_FALSE(reader.next_row(row));
+}
+
+TEST_F(CSVStreamReaderTest, FollowModeWaitsForCompleteRows) {
+    write("time,a\nt0,1\nt1,2");
+    CSVStreamReader reader(path, true, 1);
+
+    std::vector<float> row;
+    ASSERT_TRUE(reader.next_row(row));
+    EXPECT_EQ(row[0], 1.0f);
+
+    // "t1,2" has no newline yet, so the reader must wait and then see "t1,25"
+    std::thread writer([this]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        write("5\nt2,3\n", true);
+    });
+    ASSERT_TRUE(reader.next_row(row));
+    EXPECT_EQ(row[0], 25.0f);
+    ASSERT_TRUE(reader.next_row(row));
+    EXPECT_EQ(row[0], 3.0f);
+    writer.join();
+}
+
+TEST_F(CSVStreamReaderTest, MissingFileThrows) {
+    EXPECT_THROW(CSVStreamReader("does_not_exist.csv"), std::runtime_error);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include "lstm_predictor.hpp"
+#include "fixed_lstm.hpp"
+#include "simd_kernels.hpp"
+#include <cmath>
+#include <random>
+#include <vector>
+
+typedef std::vector<std::vector<std::vector<float>>> Tensor;
+
+// The deployed shape from config.yaml
+static const int LOOKBACK = 3;
+static const int HIDDEN = 100;
+static const int LAYERS = 2;
+
+static std::vector<float> window(int t) {
+    return {0.5f + 0.3f * std::sin(0.1f * t), 0.5f + 0.3f * std::sin(0.1f * t + 0.1f),
+            0.5f + 0.3f * std::sin(0.1f * t + 0.2f)};
+}
+
+TEST(FixedLSTMTest, FactoryOnlyMatchesCompiledShapes) {
+#if !defined(ADAPAD_NO_FIXED_SHAPES)
+    EXPECT_NE(find_fixed_lstm(LOOKBACK, HIDDEN, LAYERS, 1), nullptr);
+#endif
+    EXPECT_EQ(find_fixed_lstm(LOOKBACK, HIDDEN, LAYERS, 2), nullptr);
+    EXPECT_EQ(find_fixed_lstm(4, HIDDEN, LAYERS, 1), nullptr);
+    EXPECT_EQ(find_fixed_lstm(LOOKBACK, 64, LAYERS, 1), nullptr);
+
+    LSTMPredictor other(1, 4, 16, 1, 4);
+    EXPECT_FALSE(other.uses_fixed_shape_inference());
+}
+
+TEST(FixedLSTMTest, FixedGemvMatchesDynamic) {
+    std::mt19937 gen(4);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    for (size_t cols : {size_t(3), size_t(100)}) {
+        Matrix w(402, cols);
+        for (size_t r = 0; r < w.rows(); ++r)
+            for (size_t c = 0; c < cols; ++c) w[r][c] = dist(gen);
+        std::vector<float> x(cols);
+        for (auto& v : x) v = dist(gen);
+
+        std::vector<float> y(w.rows(), 0.25f), y_fixed(w.rows(), 0.25f);
+        gemv_accumulate(w, x.data(), y.data());
+        if (cols == 3) {
+            gemv_accumulate_fixed<3>(w, x.data(), y_fixed.data());
+        } else {
+            gemv_accumulate_fixed<100>(w, x.data(), y_fixed.data());
+        }
+        EXPECT_EQ(y, y_fixed);
+    }
+}
+
+#if !defined(ADAPAD_NO_FIXED_SHAPES)
+TEST(FixedLSTMTest, InferIsBitIdenticalToDynamicPath) {
+    for (Activation act : {Activation::Exact, Activation::Fast}) {
+        LSTMPredictor fixed(1, LOOKBACK, HIDDEN, LAYERS, LOOKBACK);
+        LSTMPredictor dynamic(1, LOOKBACK, HIDDEN, LAYERS, LOOKBACK);
+        fixed.set_random_seed(9);
+        dynamic.set_random_seed(9);
+        fixed.set_activation(act);
+        dynamic.set_activation(act);
+        dynamic.set_fixed_shape_inference(false);
+        ASSERT_TRUE(fixed.uses_fixed_shape_inference());
+        ASSERT_FALSE(dynamic.uses_fixed_shape_inference());
+
+        for (int t = 0; t < 20; ++t) {
+            std::vector<float> x = window(t);
+            EXPECT_EQ(fixed.infer(x.data(), 1)[0], dynamic.infer(x.data(), 1)[0]) << t;
+
+            // Keep training both so the weights move between calls
+            Tensor batch(1, std::vector<std::vector<float>>(1, x));
+            std::vector<float> target = {0.5f + 0.3f * std::sin(0.1f * t + 0.3f)};
+            fixed.train_step(batch, target, 0.05f);
+            dynamic.train_step(batch, target, 0.05f);
+        }
+
+        // Longer sequences go through every layer per timestep
+        std::vector<float> seq;
+        for (int t = 0; t < 4; ++t) {
+            std::vector<float> x = window(t);
+            seq.insert(seq.end(), x.begin(), x.end());
+        }
+        EXPECT_EQ(fixed.infer(seq.data(), 4)[0], dynamic.infer(seq.data(), 4)[0]);
+    }
+}
+
+TEST(FixedLSTMTest, Int8UsesTheDynamicPath) {
+    LSTMPredictor lstm(1, LOOKBACK, HIDDEN, LAYERS, LOOKBACK);
+    LSTMPredictor reference(1, LOOKBACK, HIDDEN, LAYERS, LOOKBACK);
+    lstm.set_random_seed(2);
+    reference.set_random_seed(2);
+    reference.set_fixed_shape_inference(false);
+    lstm.set_inference_precision(InferencePrecision::Int8);
+    reference.set_inference_precision(InferencePrecision::Int8);
+    EXPECT_FALSE(lstm.uses_fixed_shape_inference());
+
+    std::vector<float> x = window(0);
+    EXPECT_EQ(lstm.infer(x.data(), 1)[0], reference.infer(x.data(), 1)[0]);
+}
+#endif
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include "lstm_predictor.hpp"
+#include "normal_data_predictor.hpp"
+#include "anomalous_threshold_generator.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// GCC pairs the malloc/free inside the replaced operators with new/delete
+// at inlined call sites and warns about a mismatch that is not there
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+// Counting allocator hook: every global operator new bumps the counter
+static std::atomic<size_t> allocation_count(0);
+
+void* operator new(std::size_t size) {
+    allocation_count++;
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](std::size_t size) {
+    allocation_count++;
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+class InferenceAllocationTest : public ::testing::Test {
+protected:
+    // Matches the deployed shape in config.yaml
+    static const int lookback_len = 3;
+    static const int hidden_size = 100;
+    static const int num_layers = 2;
+
+    std::vector<std::vector<std::vector<float>>> make_window(float v) {
+        return std::vector<std::vector<std::vector<float>>>(
+            1, std::vector<std::vector<float>>(1, std::vector<float>(lookback_len, v)));
+    }
+};
+
+TEST_F(InferenceAllocationTest, LSTMInferDoesNotAllocate) {
+    LSTMPredictor lstm(1, lookback_len, hidden_size, num_layers, lookback_len);
+    lstm.eval();
+    std::vector<float> x(lookback_len, 0.3f);
+    lstm.infer(x.data(), 1);  // warm-up
+
+    size_t before = allocation_count.load();
+    for (int i = 0; i < 100; ++i) {
+        x[i % lookback_len] = 0.01f * i;
+        lstm.infer(x.data(), 1);
+    }
+    EXPECT_EQ(allocation_count.load() - before, 0u);
+}
+
+TEST_F(InferenceAllocationTest, Int8InferDoesNotAllocateWhenRequantizing) {
+    LSTMPredictor lstm(1, lookback_len, hidden_size, num_layers, lookback_len);
+    lstm.eval();
+    lstm.set_inference_precision(InferencePrecision::Int8);
+    std::vector<float> x(lookback_len, 0.3f);
+    lstm.infer(x.data(), 1);  // warm-up, builds the int8 copies
+
+    auto weights = lstm.get_weights();
+    lstm.set_lstm_bias(0, weights[0].bias_ih, weights[0].bias_hh);  // invalidates them
+
+    size_t before = allocation_count.load();
+    lstm.infer(x.data(), 1);
+    EXPECT_EQ(allocation_count.load() - before, 0u);
+}
+
+TEST_F(InferenceAllocationTest, InferMatchesForward) {
+    LSTMPredictor lstm(1, lookback_len, hidden_size, num_layers, lookback_len);
+    auto input = make_window(0.25f);
+
+    auto output = lstm.forward(input);
+    auto expected = lstm.get_final_prediction(output);
+    const std::vector<float>& actual = lstm.infer(input[0][0].data(), 1);
+
+    ASSERT_EQ(actual.size(), expected.size());
+    EXPECT_FLOAT_EQ(actual[0], expected[0]);
+}
+
+TEST_F(InferenceAllocationTest, PredictAndGenerateDoNotAllocate) {
+    NormalDataPredictor predictor(num_layers, hidden_size, lookback_len, 1);
+    AnomalousThresholdGenerator generator(num_layers, hidden_size, lookback_len, 1);
+    auto window = make_window(0.5f);
+    std::vector<float> errors(lookback_len, 0.01f);
+
+    predictor.predict(window);  // warm-up
+    generator.generate(errors, 0.001f);
+
+    size_t before = allocation_count.load();
+    for (int i = 0; i < 100; ++i) {
+        window[0][0][i % lookback_len] = 0.005f * i;
+        errors[i % lookback_len] = 0.0001f * i;
+        predictor.predict(window);
+        generator.generate(errors, 0.001f);
+    }
+    EXPECT_EQ(allocation_count.load() - before, 0u);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include "lstm_predictor.hpp"
+#include <memory>
+#include <vector>
+
+class InputProjectionTest : public ::testing::Test {
+protected:
+    static const int lookback_len = 3;
+    static const int hidden_size = 32;
+    static const int num_layers = 2;
+
+    typedef std::vector<std::vector<std::vector<float>>> Tensor;
+
+    std::unique_ptr<LSTMPredictor> make_lstm() {
+        std::unique_ptr<LSTMPredictor> lstm(
+            new LSTMPredictor(1, lookback_len, hidden_size, num_layers, lookback_len));
+        lstm->set_random_seed(3);
+        lstm->train();
+        return lstm;
+    }
+
+    static Tensor window(float a, float b, float c) {
+        return Tensor(1, std::vector<std::vector<float>>(1, {a, b, c}));
+    }
+
+    float forward_prediction(LSTMPredictor& lstm, const Tensor& x) {
+        return lstm.get_final_prediction(lstm.forward(x))[0];
+    }
+};
+
+TEST_F(InputProjectionTest, InferThenForwardOnSameWindowReusesProjection) {
+    auto lstm = make_lstm();
+    Tensor x = window(0.2f, 0.4f, 0.3f);
+
+    const size_t before = lstm->input_projections_computed();
+    const float inferred = lstm->infer(x[0][0].data(), 1)[0];
+    EXPECT_EQ(lstm->input_projections_computed(), before + 1);
+
+    EXPECT_FLOAT_EQ(forward_prediction(*lstm, x), inferred);
+    EXPECT_EQ(lstm->input_projections_computed(), before + 1);
+}
+
+TEST_F(InputProjectionTest, WeightUpdateInvalidatesProjection) {
+    Tensor x = window(0.2f, 0.4f, 0.3f);
+    Tensor other = window(0.9f, 0.1f, 0.5f);
+
+    auto cached = make_lstm();
+    cached->train_step(x, {0.6f}, cached->forward(x), 0.05f);
+    const size_t before = cached->input_projections_computed();
+    const float actual = forward_prediction(*cached, x);
+    EXPECT_EQ(cached->input_projections_computed(), before + 1);
+
+    // Same update, but the projection of x is evicted before the second forward
+    auto fresh = make_lstm();
+    fresh->train_step(x, {0.6f}, fresh->forward(x), 0.05f);
+    fresh->forward(other);
+    EXPECT_FLOAT_EQ(actual, forward_prediction(*fresh, x));
+}
+
+TEST_F(InputProjectionTest, ChangedInputOrShapeIsProjectedAgain) {
+    auto lstm = make_lstm();
+    Tensor a = window(0.2f, 0.4f, 0.3f);
+    Tensor b = window(0.2f, 0.4f, 0.31f);
+    Tensor both = {a[0], b[0]};
+
+    const float expected_b = forward_prediction(*make_lstm(), b);
+
+    forward_prediction(*lstm, a);
+    const size_t before = lstm->input_projections_computed();
+    EXPECT_FLOAT_EQ(forward_prediction(*lstm, b), expected_b);
+    auto output = lstm->forward(both);
+    EXPECT_FLOAT_EQ(lstm->get_final_prediction(output, 1)[0], expected_b);
+    EXPECT_EQ(lstm->input_projections_computed(), before + 2);
+}
+
+TEST_F(InputProjectionTest, PrecisionIsPartOfTheKey) {
+    auto lstm = make_lstm();
+    Tensor x = window(0.2f, 0.4f, 0.3f);
+
+    lstm->set_inference_precision(InferencePrecision::Int8);
+    lstm->infer(x[0][0].data(), 1);
+    const size_t before = lstm->input_projections_computed();
+    forward_prediction(*lstm, x);  // forward() is always fp32
+    EXPECT_EQ(lstm->input_projections_computed(), before + 1);
+}
+
+// The deployed shape from config.yaml takes the compile-time specialized
+// inference path, which must fill the same cache
+TEST(InputProjectionDeployedShapeTest, FixedShapeInferFeedsTheUpdate) {
+    LSTMPredictor lstm(1, 3, 100, 2, 3);
+    lstm.set_random_seed(3);
+    lstm.train();
+    if (!lstm.uses_fixed_shape_inference()) {
+        GTEST_SKIP() << "built without fixed shapes";
+    }
+    std::vector<std::vector<std::vector<float>>> x(1, std::vector<std::vector<float>>(1, {0.2f, 0.4f, 0.3f}));
+
+    const size_t before = lstm.input_projections_computed();
+    const float inferred = lstm.infer(x[0][0].data(), 1)[0];
+    EXPECT_EQ(lstm.input_projections_computed(), before + 1);
+
+    // First epoch of an online update: same window, unchanged weights
+    const float loss = lstm.train_step(x, {0.6f}, 0.05f);
+    EXPECT_EQ(lstm.input_projections_computed(), before + 1);
+    EXPECT_FLOAT_EQ(loss, (inferred - 0.6f) * (inferred - 0.6f));
+
+    // The step changed the weights, so the next epoch projects again
+    lstm.train_step(x, {0.6f}, 0.05f);
+    EXPECT_EQ(lstm.input_projections_computed(), before + 2);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
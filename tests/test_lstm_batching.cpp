@@ -0,0 +1,235 @@
+#include <gtest/gtest.h>
+#include "lstm_predictor.hpp"
+#include <cmath>
+#include <random>
+#include <vector>
+
+class LSTMBatchingTest : public ::testing::Test {
+protected:
+    static const int input_size = 3;
+    static const int hidden_size = 16;
+    static const int num_layers = 2;
+    static const int seq_len = 2;
+    static const int batch_size = 4;
+
+    typedef std::vector<std::vector<std::vector<float>>> Tensor;
+
+    std::unique_ptr<LSTMPredictor> make_lstm() {
+        std::unique_ptr<LSTMPredictor> lstm(
+            new LSTMPredictor(1, input_size, hidden_size, num_layers, input_size));
+        lstm->set_random_seed(7);
+        lstm->train();
+        return lstm;
+    }
+
+    Tensor make_batch() {
+        std::mt19937 gen(11);
+        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        Tensor x(batch_size, std::vector<std::vector<float>>(seq_len, std::vector<float>(input_size)));
+        for (auto& seq : x)
+            for (auto& step : seq)
+                for (auto& v : step) v = dist(gen);
+        return x;
+    }
+};
+
+TEST_F(LSTMBatchingTest, BatchedForwardMatchesPerSequence) {
+    auto lstm = make_lstm();
+    Tensor x = make_batch();
+    auto batched = lstm->forward(x);
+
+    for (int b = 0; b < batch_size; ++b) {
+        auto single = lstm->forward(Tensor(1, x[b]));
+        for (int t = 0; t < seq_len; ++t) {
+            for (int h = 0; h < hidden_size; ++h) {
+                EXPECT_FLOAT_EQ(batched.sequence_output[b][t][h], single.sequence_output[0][t][h]);
+            }
+        }
+        EXPECT_FLOAT_EQ(lstm->get_final_prediction(batched, b)[0],
+                        lstm->get_final_prediction(single)[0]);
+    }
+}
+
+TEST_F(LSTMBatchingTest, BatchGradientIsMeanOfSampleGradients) {
+    Tensor x = make_batch();
+    std::vector<float> target = {0.1f, 0.4f, 0.7f, 0.2f};
+
+    // Zero learning rate keeps the weights fixed so every step sees the same model
+    auto batched = make_lstm();
+    batched->train_step(x, target, batched->forward(x), 0.0f);
+    auto batch_grads = batched->get_last_gradients();
+
+    auto single = make_lstm();
+    std::vector<LSTMPredictor::LSTMGradients> sum;
+    for (int b = 0; b < batch_size; ++b) {
+        Tensor xb(1, x[b]);
+        single->train_step(xb, {target[b]}, single->forward(xb), 0.0f);
+        auto grads = single->get_last_gradients();
+        if (sum.empty()) {
+            sum = grads;
+            continue;
+        }
+        for (int layer = 0; layer < num_layers; ++layer) {
+            Matrix& acc = sum[layer].weight_hh_grad;
+            for (size_t r = 0; r < acc.rows(); ++r)
+                for (size_t c = 0; c < acc.cols(); ++c)
+                    acc[r][c] += grads[layer].weight_hh_grad[r][c];
+            Matrix& acc_ih = sum[layer].weight_ih_grad;
+            for (size_t r = 0; r < acc_ih.rows(); ++r)
+                for (size_t c = 0; c < acc_ih.cols(); ++c)
+                    acc_ih[r][c] += grads[layer].weight_ih_grad[r][c];
+        }
+    }
+
+    for (int layer = 0; layer < num_layers; ++layer) {
+        const Matrix& g = batch_grads[layer].weight_hh_grad;
+        for (size_t r = 0; r < g.rows(); ++r)
+            for (size_t c = 0; c < g.cols(); ++c)
+                EXPECT_NEAR(g[r][c], sum[layer].weight_hh_grad[r][c] / batch_size, 1e-6f);
+        const Matrix& g_ih = batch_grads[layer].weight_ih_grad;
+        for (size_t r = 0; r < g_ih.rows(); ++r)
+            for (size_t c = 0; c < g_ih.cols(); ++c)
+                EXPECT_NEAR(g_ih[r][c], sum[layer].weight_ih_grad[r][c] / batch_size, 1e-6f);
+    }
+}
+
+TEST_F(LSTMBatchingTest, TargetMustCoverEveryBatchEntry) {
+    auto lstm = make_lstm();
+    Tensor x = make_batch();
+    EXPECT_THROW(lstm->train_step(x, {0.5f}, lstm->forward(x), 0.01f), std::invalid_argument);
+}
+
+TEST_F(LSTMBatchingTest, FusedStepMatchesForwardThenTrainStep) {
+    Tensor x = make_batch();
+    std::vector<float> target = {0.1f, 0.4f, 0.7f, 0.2f};
+
+    auto separate = make_lstm();
+    auto output = separate->forward(x);
+    float expected_loss = 0.0f;
+    for (int b = 0; b < batch_size; ++b) {
+        float diff = separate->get_final_prediction(output, b)[0] - target[b];
+        expected_loss += diff * diff;
+    }
+    expected_loss /= batch_size;
+    separate->train_step(x, target, output, 0.05f);
+
+    auto fused = make_lstm();
+    EXPECT_FLOAT_EQ(fused->train_step(x, target, 0.05f), expected_loss);
+
+    // Identical updates give identical predictions afterwards
+    auto after_separate = separate->forward(x);
+    auto after_fused = fused->forward(x);
+    for (int b = 0; b < batch_size; ++b) {
+        EXPECT_EQ(separate->get_final_prediction(after_separate, b)[0],
+                  fused->get_final_prediction(after_fused, b)[0]);
+    }
+}
+
+TEST_F(LSTMBatchingTest, FusedStepSkipsUpdateAboveStopLoss) {
+    auto lstm = make_lstm();
+    Tensor x = make_batch();
+    std::vector<float> target = {0.1f, 0.4f, 0.7f, 0.2f};
+
+    const uint64_t version = lstm->get_weights_version();
+    float loss = lstm->train_step(x, target, 0.05f, 0.0f);
+    EXPECT_GT(loss, 0.0f);
+    EXPECT_EQ(lstm->get_weights_version(), version);
+
+    EXPECT_EQ(lstm->train_step(x, target, 0.05f, loss), loss);
+    EXPECT_GT(lstm->get_weights_version(), version);
+}
+
+TEST_F(LSTMBatchingTest, PublicEntryPointsRejectBadShapes) {
+    auto lstm = make_lstm();
+    Tensor ragged = make_batch();
+    ragged[2].pop_back();
+    Tensor wide = make_batch();
+    wide[1][0].push_back(0.0f);
+    std::vector<float> target = {0.1f, 0.4f, 0.7f, 0.2f};
+
+    EXPECT_THROW(lstm->check_input(Tensor()), std::invalid_argument);
+    EXPECT_THROW(lstm->check_input(ragged), std::invalid_argument);
+    EXPECT_THROW(lstm->check_input(wide), std::invalid_argument);
+    EXPECT_NO_THROW(lstm->check_input(make_batch()));
+    EXPECT_THROW(lstm->forward(ragged), std::invalid_argument);
+    EXPECT_THROW(lstm->forward(wide), std::invalid_argument);
+    EXPECT_THROW(lstm->train_step(wide, target, 0.05f), std::invalid_argument);
+    EXPECT_THROW(lstm->train_step(make_batch(), {0.5f}, 0.05f), std::invalid_argument);
+}
+
+TEST_F(LSTMBatchingTest, UncheckedStepMatchesCheckedStep) {
+    Tensor x = make_batch();
+    std::vector<float> target = {0.1f, 0.4f, 0.7f, 0.2f};
+
+    auto checked = make_lstm();
+    auto unchecked = make_lstm();
+    for (int step = 0; step < 3; ++step) {
+        EXPECT_EQ(checked->train_step(x, target, 0.05f),
+                  unchecked->train_step_unchecked(x, target, 0.05f));
+    }
+    auto a = checked->forward(x);
+    auto b = unchecked->forward(x);
+    for (int i = 0; i < batch_size; ++i) {
+        EXPECT_EQ(checked->get_final_prediction(a, i)[0], unchecked->get_final_prediction(b, i)[0]);
+    }
+}
+
+// Central differences of the batch loss against the BPTT gradients, for
+// every LSTM weight of both layers
+TEST_F(LSTMBatchingTest, GradientsMatchFiniteDifferences) {
+    Tensor x = make_batch();
+    std::vector<float> target = {0.1f, 0.4f, 0.7f, 0.2f};
+    auto lstm = make_lstm();
+    lstm->train_step(x, target, 0.0f);
+    const auto grads = lstm->get_last_gradients();
+    const auto weights = lstm->get_weights();
+
+    auto loss_with = [&](const std::vector<LSTMPredictor::LSTMLayer>& w) {
+        lstm->set_weights(w);
+        auto output = lstm->forward(x);
+        double loss = 0.0;
+        for (int b = 0; b < batch_size; ++b) {
+            double diff = lstm->get_final_prediction(output, b)[0] - target[b];
+            loss += diff * diff;
+        }
+        return loss / batch_size;
+    };
+    const float eps = 1e-3f;
+    auto numeric = [&](float& weight, std::vector<LSTMPredictor::LSTMLayer>& w) {
+        const float original = weight;
+        weight = original + eps;
+        const double up = loss_with(w);
+        weight = original - eps;
+        const double down = loss_with(w);
+        weight = original;
+        return static_cast<float>((up - down) / (2.0 * eps));
+    };
+
+    auto w = weights;
+    for (int layer = 0; layer < num_layers; ++layer) {
+        for (int which = 0; which < 2; ++which) {
+            Matrix& m = which == 0 ? w[layer].weight_ih : w[layer].weight_hh;
+            const Matrix& g = which == 0 ? grads[layer].weight_ih_grad : grads[layer].weight_hh_grad;
+            for (size_t r = 0; r < m.rows(); ++r) {
+                for (size_t c = 0; c < m.cols(); ++c) {
+                    EXPECT_NEAR(g[r][c], numeric(m[r][c], w), 1e-4f + 1e-2f * std::fabs(g[r][c]))
+                        << "layer " << layer << (which == 0 ? " weight_ih[" : " weight_hh[")
+                        << r << "][" << c << "]";
+                }
+            }
+        }
+        for (size_t i = 0; i < w[layer].bias_ih.size(); ++i) {
+            const float g = grads[layer].bias_ih_grad[i];
+            EXPECT_NEAR(g, numeric(w[layer].bias_ih[i], w), 1e-4f + 1e-2f * std::fabs(g))
+                << "layer " << layer << " bias_ih[" << i << "]";
+            const float g_hh = grads[layer].bias_hh_grad[i];
+            EXPECT_NEAR(g_hh, numeric(w[layer].bias_hh[i], w), 1e-4f + 1e-2f * std::fabs(g_hh))
+                << "layer " << layer << " bias_hh[" << i << "]";
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+#include "optimizer.hpp"
+#include "checkpoint.hpp"
+#include "lstm_predictor.hpp"
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class OptimizerTest : public ::testing::Test {
+protected:
+    static const int input_size = 3;
+    static const int hidden_size = 8;
+    static const int num_layers = 2;
+    static const int batch_size = 4;
+
+    typedef std::vector<std::vector<std::vector<float>>> Tensor;
+
+    const std::string path = "optimizer_test.bin";
+
+    void TearDown() override {
+        std::remove(path.c_str());
+    }
+
+    static OptimizerConfig config(OptimizerKind kind) {
+        OptimizerConfig cfg;
+        cfg.kind = kind;
+        return cfg;
+    }
+
+    std::unique_ptr<LSTMPredictor> make_lstm(OptimizerKind kind) {
+        std::unique_ptr<LSTMPredictor> lstm(
+            new LSTMPredictor(1, input_size, hidden_size, num_layers, input_size));
+        lstm->set_random_seed(3);
+        lstm->set_optimizer(config(kind));
+        lstm->train();
+        return lstm;
+    }
+
+    Tensor make_batch() {
+        std::mt19937 gen(5);
+        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        Tensor x(batch_size, std::vector<std::vector<float>>(1, std::vector<float>(input_size)));
+        for (auto& seq : x)
+            for (auto& step : seq)
+                for (auto& v : step) v = dist(gen);
+        return x;
+    }
+
+    const std::vector<float> target = {0.2f, 0.9f, 0.4f, 0.6f};
+};
+
+TEST_F(OptimizerTest, SgdIsClippedGradientStep) {
+    Optimizer opt;
+    size_t slot = opt.add_slot("w");
+    std::vector<float> w = {1.0f, 1.0f, 1.0f};
+    std::vector<float> g = {0.5f, 3.0f, -2.0f};
+    opt.begin_update();
+    opt.update(slot, w, g, 0.1f);
+    EXPECT_FLOAT_EQ(w[0], 1.0f - 0.1f * 0.5f);
+    EXPECT_FLOAT_EQ(w[1], 1.0f - 0.1f);
+    EXPECT_FLOAT_EQ(w[2], 1.0f + 0.1f);
+}
+
+TEST_F(OptimizerTest, MomentumAccumulatesVelocity) {
+    Optimizer opt;
+    opt.configure(config(OptimizerKind::Momentum));
+    size_t slot = opt.add_slot("w");
+    std::vector<float> w = {0.0f};
+    std::vector<float> g = {0.5f};
+    opt.begin_update();
+    opt.update(slot, w, g, 0.1f);
+    EXPECT_FLOAT_EQ(w[0], -0.05f);
+    opt.begin_update();
+    opt.update(slot, w, g, 0.1f);
+    EXPECT_FLOAT_EQ(w[0], -0.05f - 0.1f * (0.9f * 0.5f + 0.5f));
+}
+
+TEST_F(OptimizerTest, AdamFirstStepIsLearningRateTimesSign) {
+    Optimizer opt;
+    opt.configure(config(OptimizerKind::Adam));
+    size_t slot = opt.add_slot("w");
+    Matrix w(2, 3);
+    Matrix g(2, 3);
+    g[0][0] = 0.001f;
+    g[1][2] = -5.0f;
+    opt.begin_update();
+    opt.update(slot, w, g, 0.01f);
+    EXPECT_NEAR(w[0][0], -0.01f, 1e-6f);
+    EXPECT_NEAR(w[1][2], 0.01f, 1e-6f);
+    EXPECT_EQ(w[0][1], 0.0f);
+    EXPECT_EQ(opt.step_count(), 1u);
+}
+
+TEST_F(OptimizerTest, ShapeMismatchThrows) {
+    Optimizer opt;
+    size_t slot = opt.add_slot("w");
+    Matrix w(2, 3);
+    Matrix g(3, 2);
+    EXPECT_THROW(opt.update(slot, w, g, 0.1f), std::invalid_argument);
+    EXPECT_THROW(parse_optimizer("rmsprop"), std::runtime_error);
+}
+
+TEST_F(OptimizerTest, AdaptiveRulesReduceLossFasterThanSgd) {
+    Tensor x = make_batch();
+    float final_loss[3];
+    const OptimizerKind kinds[3] = {OptimizerKind::SGD, OptimizerKind::Momentum, OptimizerKind::Adam};
+    for (int k = 0; k < 3; ++k) {
+        auto lstm = make_lstm(kinds[k]);
+        for (int step = 0; step < 100; ++step) {
+            final_loss[k] = lstm->train_step(x, target, 0.01f);
+        }
+    }
+    EXPECT_LT(final_loss[1], final_loss[0]);
+    EXPECT_LT(final_loss[2], final_loss[0]);
+}
+
+TEST_F(OptimizerTest, CheckpointKeepsMoments) {
+    Tensor x = make_batch();
+    auto trained = make_lstm(OptimizerKind::Adam);
+    for (int step = 0; step < 5; ++step) {
+        trained->train_step(x, target, 0.01f);
+    }
+    CheckpointWriter writer;
+    trained->save_checkpoint(writer, "m.");
+    writer.write(path);
+
+    auto restored = make_lstm(OptimizerKind::Adam);
+    restored->load_checkpoint(CheckpointReader(path), "m.");
+    EXPECT_EQ(restored->get_optimizer().step_count(), 5u);
+
+    // Same weights and same moments give the same next step
+    EXPECT_EQ(restored->train_step(x, target, 0.01f), trained->train_step(x, target, 0.01f));
+    EXPECT_EQ(restored->train_step(x, target, 0.01f), trained->train_step(x, target, 0.01f));
+}
+
+TEST_F(OptimizerTest, CheckpointFromOtherRuleStartsFresh) {
+    Tensor x = make_batch();
+    auto trained = make_lstm(OptimizerKind::Adam);
+    trained->train_step(x, target, 0.01f);
+    CheckpointWriter writer;
+    trained->save_checkpoint(writer, "m.");
+    writer.write(path);
+
+    auto restored = make_lstm(OptimizerKind::Momentum);
+    restored->train_step(x, target, 0.01f);
+    restored->load_checkpoint(CheckpointReader(path), "m.");
+    EXPECT_EQ(restored->get_optimizer().step_count(), 0u);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include "lstm_predictor.hpp"
+#include "simd_kernels.hpp"
+#include "csv_reader.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Range of the Tide_pressure sensor in config.yaml
+static const float TIDE_LOWER = 713.0f;
+static const float TIDE_UPPER = 763.0f;
+
+static Matrix random_matrix(size_t rows, size_t cols, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    Matrix m(rows, cols);
+    for (size_t r = 0; r < rows; ++r)
+        for (size_t c = 0; c < cols; ++c)
+            m[r][c] = dist(gen);
+    return m;
+}
+
+TEST(QuantizedMatrixTest, ErrorIsWithinHalfAStepPerRow) {
+    Matrix w = random_matrix(37, 23, 1);
+    for (size_t c = 0; c < w.cols(); ++c) w[5][c] = 0.0f;
+
+    QuantizedMatrix q;
+    q.quantize(w);
+    ASSERT_EQ(q.rows(), w.rows());
+    ASSERT_EQ(q.cols(), w.cols());
+    EXPECT_EQ(q.stride() % 16, 0u);
+
+    for (size_t r = 0; r < w.rows(); ++r) {
+        for (size_t c = 0; c < w.cols(); ++c) {
+            EXPECT_LE(std::fabs(q.dequantized(r, c) - w[r][c]), q.scale(r) * 0.5f + 1e-7f);
+        }
+    }
+    EXPECT_EQ(q.scale(5), 0.0f);
+    EXPECT_EQ(q.dequantized(5, 3), 0.0f);
+}
+
+TEST(QuantizedMatrixTest, KernelMatchesScalarReference) {
+    // Odd column counts exercise the vector tails
+    for (size_t cols : {3, 8, 23, 100}) {
+        Matrix w = random_matrix(402, cols, 2);
+        QuantizedMatrix q;
+        q.quantize(w);
+        std::vector<float> x(cols);
+        for (size_t c = 0; c < cols; ++c) x[c] = std::sin(0.37f * c);
+
+        std::vector<float> y(w.rows(), 0.5f), y_ref(w.rows(), 0.5f), y_float(w.rows(), 0.5f);
+        gemv_accumulate_q8(q, x.data(), y.data());
+        gemv_accumulate_q8_scalar(q, x.data(), y_ref.data());
+        gemv_accumulate(w, x.data(), y_float.data());
+
+        float x_abs = 0.0f;
+        for (float v : x) x_abs += std::fabs(v);
+        for (size_t r = 0; r < w.rows(); ++r) {
+            EXPECT_NEAR(y[r], y_ref[r], 1e-4f);
+            // Each weight is off by at most half a step
+            EXPECT_NEAR(y[r], y_float[r], q.scale(r) * 0.5f * x_abs + 1e-4f);
+        }
+    }
+}
+
+class QuantizedInferenceTest : public ::testing::Test {
+protected:
+    // Deployed shape from config.yaml
+    static const int lookback_len = 3;
+    static const int hidden_size = 100;
+    static const int num_layers = 2;
+
+    std::unique_ptr<LSTMPredictor> make_lstm() {
+        std::unique_ptr<LSTMPredictor> lstm(
+            new LSTMPredictor(1, lookback_len, hidden_size, num_layers, lookback_len));
+        lstm->set_random_seed(42);
+        return lstm;
+    }
+
+    static std::vector<float> load_validation_set() {
+        CSVStreamReader reader("data/Tide_pressure.validation_stage.csv");
+        std::vector<float> values;
+        std::vector<float> row;
+        while (reader.next_row(row)) {
+            values.push_back((row[0] - TIDE_LOWER) / (TIDE_UPPER - TIDE_LOWER));
+        }
+        return values;
+    }
+
+    static void train(LSTMPredictor& lstm, const std::vector<float>& series, size_t windows, int epochs) {
+        lstm.train();
+        for (int e = 0; e < epochs; ++e) {
+            for (size_t i = 0; i < windows; ++i) {
+                std::vector<std::vector<std::vector<float>>> x(
+                    1, std::vector<std::vector<float>>(
+                        1, std::vector<float>(series.begin() + i, series.begin() + i + lookback_len)));
+                lstm.train_step(x, {series[i + lookback_len]}, lstm.forward(x), 0.015f);
+            }
+        }
+        lstm.eval();
+    }
+};
+
+TEST_F(QuantizedInferenceTest, TidePressureValidationMatchesFloat) {
+    std::vector<float> series = load_validation_set();
+    ASSERT_GT(series.size(), 1000u);
+
+    auto lstm = make_lstm();
+    train(*lstm, series, 200, 5);
+
+    double sum_abs = 0.0;
+    float max_abs = 0.0f;
+    size_t count = 0;
+    for (size_t i = 0; i + lookback_len < series.size(); ++i) {
+        lstm->set_inference_precision(InferencePrecision::Float32);
+        const float expected = lstm->infer(&series[i], 1)[0];
+        lstm->set_inference_precision(InferencePrecision::Int8);
+        const float actual = lstm->infer(&series[i], 1)[0];
+        const float diff = std::fabs(actual - expected);
+        sum_abs += diff;
+        max_abs = std::max(max_abs, diff);
+        ++count;
+    }
+
+    // In sensor units: mean below 0.005 hPa, worst case below 0.1 hPa on a 50 hPa range
+    EXPECT_LT(sum_abs / count, 1e-4);
+    EXPECT_LT(max_abs, 2e-3f);
+}
+
+TEST_F(QuantizedInferenceTest, RequantizesAfterEveryUpdate) {
+    std::vector<float> series = load_validation_set();
+    auto lstm = make_lstm();
+    lstm->set_inference_precision(InferencePrecision::Int8);
+    const float* window = &series[500];
+
+    const float before = lstm->infer(window, 1)[0];
+    const uint64_t version = lstm->get_weights_version();
+    train(*lstm, series, 50, 1);
+    EXPECT_GT(lstm->get_weights_version(), version);
+
+    const float after = lstm->infer(window, 1)[0];
+    EXPECT_NE(after, before);
+
+    lstm->set_inference_precision(InferencePrecision::Float32);
+    EXPECT_NEAR(after, lstm->infer(window, 1)[0], 0.005f);
+}
+
+TEST_F(QuantizedInferenceTest, Int8ReadsUnderAThirdOfTheWeightBytes) {
+    auto lstm = make_lstm();
+    const size_t fp32_bytes = lstm->inference_weight_bytes();
+    lstm->set_inference_precision(InferencePrecision::Int8);
+    const size_t int8_bytes = lstm->inference_weight_bytes();
+    // Not a full quarter: int8 rows pad to 16 bytes and carry an fp32 scale
+    EXPECT_LT(int8_bytes * 3, fp32_bytes);
+    EXPECT_GT(int8_bytes * 4, fp32_bytes);
+}
+
+TEST(InferencePrecisionTest, ParsesConfigNames) {
+    EXPECT_EQ(parse_inference_precision("fp32"), InferencePrecision::Float32);
+    EXPECT_EQ(parse_inference_precision("int8"), InferencePrecision::Int8);
+    EXPECT_STREQ(inference_precision_name(InferencePrecision::Int8), "int8");
+    EXPECT_THROW(parse_inference_precision("fp16"), std::runtime_error);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
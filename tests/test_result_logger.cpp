@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include "result_logger.hpp"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+ResultLogger::Record result(float observed, bool anomalous) {
+    ResultLogger::Record r;
+    r.kind = ResultLogger::Record::Result;
+    r.anomalous = anomalous;
+    r.observed = observed;
+    r.predicted = 2.5f;
+    r.low = 2.0f;
+    r.high = 3.0f;
+    r.error = 0.125f;
+    r.threshold = 0.5f;
+    return r;
+}
+
+}
+
+TEST(ResultLoggerTest, KeepsColumnFormat) {
+    const std::string path = "result_logger_format.csv";
+    {
+        ResultLogger logger(1000, 16);
+        ResultLogger::Channel* channel = logger.open(path, "observed,predicted,low,high,anomalous,err,threshold");
+
+        ResultLogger::Record training = {};
+        training.kind = ResultLogger::Record::Training;
+        training.observed = 1.0f;
+        training.predicted = 1.5f;
+        logger.push(channel, training);
+        logger.push(channel, result(713.25f, true));
+        logger.push(channel, result(714.0f, false));
+        logger.close(channel);
+    }
+    EXPECT_EQ(read_file(path),
+              "observed,predicted,low,high,anomalous,err,threshold\n"
+              "1,1.5,,,,,\n"
+              "713.25,2.5,2,3,True,0.125,0.5\n"
+              "714,2.5,2,3,False,0.125,0.5\n");
+    std::remove(path.c_str());
+}
+
+TEST(ResultLoggerTest, FlushWritesBufferedRows) {
+    const std::string path = "result_logger_flush.csv";
+    ResultLogger logger(60000, 16);
+    ResultLogger::Channel* channel = logger.open(path, "h");
+    logger.push(channel, result(1.0f, false));
+    logger.flush();
+    EXPECT_EQ(read_file(path), "h\n1,2.5,2,3,False,0.125,0.5\n");
+    logger.close(channel);
+    std::remove(path.c_str());
+}
+
+TEST(ResultLoggerTest, FullRingWaitsInsteadOfDropping) {
+    // Tiny rings and several producers force the back-pressure path
+    const int producers = 4;
+    const int rows = 2000;
+    std::vector<std::string> paths;
+    {
+        ResultLogger logger(1, 2);
+        std::vector<ResultLogger::Channel*> channels;
+        for (int p = 0; p < producers; ++p) {
+            paths.push_back("result_logger_ring_" + std::to_string(p) + ".csv");
+            channels.push_back(logger.open(paths.back(), "h"));
+        }
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p]() {
+                for (int i = 0; i < rows; ++i) {
+                    logger.push(channels[p], result(static_cast<float>(i), false));
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+    }
+    for (const auto& path : paths) {
+        std::ifstream in(path);
+        std::string line;
+        std::getline(in, line);
+        int expected = 0;
+        while (std::getline(in, line)) {
+            EXPECT_EQ(line.substr(0, line.find(',')), std::to_string(expected));
+            ++expected;
+        }
+        EXPECT_EQ(expected, rows);
+        std::remove(path.c_str());
+    }
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include "ring_buffer.hpp"
+
+TEST(RingBufferTest, KeepsNewestElementsInOrder) {
+    RingBuffer<int> ring(3);
+    for (int i = 1; i <= 2; ++i) ring.push_back(i);
+    EXPECT_EQ(ring.size(), 2u);
+    EXPECT_EQ(ring[0], 1);
+    EXPECT_EQ(ring.back(), 2);
+
+    for (int i = 3; i <= 7; ++i) ring.push_back(i);
+    ASSERT_EQ(ring.size(), 3u);
+    EXPECT_TRUE(ring.full());
+    EXPECT_EQ(ring[0], 5);
+    EXPECT_EQ(ring[1], 6);
+    EXPECT_EQ(ring[2], 7);
+    EXPECT_EQ(ring.from_back(0), 7);
+    EXPECT_EQ(ring.from_back(2), 5);
+}
+
+TEST(RingBufferTest, CapacityNeverGrows) {
+    RingBuffer<float> ring(4);
+    for (int i = 0; i < 100000; ++i) ring.push_back(static_cast<float>(i));
+    EXPECT_EQ(ring.capacity(), 4u);
+    EXPECT_EQ(ring.size(), 4u);
+    EXPECT_EQ(ring[0], 99996.0f);
+}
+
+TEST(RingBufferTest, ClearAndReset) {
+    RingBuffer<int> ring(2);
+    ring.push_back(1);
+    ring.push_back(2);
+    ring.push_back(3);
+    ring.clear();
+    EXPECT_TRUE(ring.empty());
+    ring.push_back(4);
+    EXPECT_EQ(ring[0], 4);
+
+    ring.reset(5);
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(ring.capacity(), 5u);
+
+    // Zero capacity ignores pushes
+    RingBuffer<int> none;
+    none.push_back(1);
+    EXPECT_TRUE(none.empty());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include "lstm_predictor.hpp"
+#include "matrix_utils.hpp"
+#include <cmath>
+#include <memory>
+#include <vector>
+
+typedef std::vector<std::vector<std::vector<float>>> Tensor;
+
+static const int LOOKBACK = 3;
+static const int HIDDEN = 16;
+static const int LAYERS = 2;
+
+static std::vector<float> window(int t, float offset = 0.0f) {
+    return {0.5f + offset + 0.3f * std::sin(0.1f * t), 0.5f + offset + 0.3f * std::sin(0.1f * t + 0.1f),
+            0.5f + offset + 0.3f * std::sin(0.1f * t + 0.2f)};
+}
+
+static std::unique_ptr<LSTMPredictor> make_lstm(unsigned seed) {
+    std::unique_ptr<LSTMPredictor> lstm(new LSTMPredictor(1, LOOKBACK, HIDDEN, LAYERS, LOOKBACK));
+    lstm->set_random_seed(seed);
+    lstm->train();
+    return lstm;
+}
+
+static void fit(LSTMPredictor& lstm, float offset, int steps) {
+    for (int t = 0; t < steps; ++t) {
+        lstm.train_step(Tensor(1, std::vector<std::vector<float>>(1, window(t, offset))),
+                        {0.5f + offset + 0.3f * std::sin(0.1f * t + 0.3f)}, 0.05f);
+    }
+}
+
+TEST(SharedBackboneTest, TiedModelStartsAsTheOwner) {
+    auto owner = make_lstm(1);
+    auto tied = make_lstm(2);
+    const std::vector<float> x = window(5);
+    const float expected = owner->infer(x.data(), 1)[0];
+    EXPECT_NE(tied->infer(x.data(), 1)[0], expected);
+
+    tied->share_backbone(*owner);
+    EXPECT_TRUE(tied->shares_backbone());
+    EXPECT_TRUE(owner->shares_backbone());
+    EXPECT_EQ(tied->infer(x.data(), 1)[0], expected);
+
+    LSTMPredictor other_shape(1, LOOKBACK, 8, LAYERS, LOOKBACK);
+    EXPECT_THROW(other_shape.share_backbone(*owner), std::invalid_argument);
+}
+
+TEST(SharedBackboneTest, TrainingATiedModelOnlyMovesItsHead) {
+    auto owner = make_lstm(1);
+    auto tied = make_lstm(2);
+    tied->share_backbone(*owner);
+    const std::vector<float> x = window(5);
+    const float owner_before = owner->infer(x.data(), 1)[0];
+    const float tied_before = tied->infer(x.data(), 1)[0];
+
+    fit(*tied, 0.1f, 20);
+    EXPECT_NE(tied->infer(x.data(), 1)[0], tied_before);
+    EXPECT_EQ(owner->infer(x.data(), 1)[0], owner_before);
+    EXPECT_EQ(owner->get_weights()[0].weight_hh[0][0], tied->get_weights()[0].weight_hh[0][0]);
+}
+
+TEST(SharedBackboneTest, SettingWeightsUnsharesTheBackbone) {
+    auto owner = make_lstm(1);
+    auto tied = make_lstm(2);
+    tied->share_backbone(*owner);
+    const std::vector<float> x = window(5);
+    const float owner_before = owner->infer(x.data(), 1)[0];
+
+    auto weights = tied->get_weights();
+    weights[0].weight_ih[0][0] += 1.0f;
+    tied->set_weights(weights);
+    EXPECT_FALSE(tied->shares_backbone());
+    EXPECT_FALSE(owner->shares_backbone());
+    EXPECT_EQ(owner->infer(x.data(), 1)[0], owner_before);
+    EXPECT_NE(tied->infer(x.data(), 1)[0], owner_before);
+}
+
+TEST(SharedBackboneTest, BatchedInferenceMatchesEachModel) {
+    const int models = 5;
+    auto owner = make_lstm(1);
+    std::vector<std::unique_ptr<LSTMPredictor>> tied;
+    std::vector<LSTMPredictor*> group;
+    for (int m = 0; m < models; ++m) {
+        tied.push_back(make_lstm(10 + m));
+        tied.back()->share_backbone(*owner);
+        fit(*tied.back(), 0.05f * m, 10 + m);
+        group.push_back(tied.back().get());
+    }
+
+    std::vector<float> x;
+    for (int m = 0; m < models; ++m) {
+        std::vector<float> w = window(3 * m, 0.05f * m);
+        x.insert(x.end(), w.begin(), w.end());
+    }
+    std::vector<float> out(models);
+    owner->infer_tied(group, x.data(), 1, out.data());
+    for (int m = 0; m < models; ++m) {
+        EXPECT_NEAR(out[m], tied[m]->infer(x.data() + m * LOOKBACK, 1)[0], 1e-6f) << "model " << m;
+    }
+
+    auto stranger = make_lstm(3);
+    group.push_back(stranger.get());
+    EXPECT_THROW(owner->infer_tied(group, x.data(), 1, out.data()), std::invalid_argument);
+}
+
+TEST(SharedBackboneTest, PooledWindowsInterleaveTheSeries) {
+    std::vector<std::vector<float>> series = {{0, 1, 2, 3, 4}, {10, 11, 12, 13}, {20}};
+    auto windows = create_pooled_windows(series, 3, 1);
+    ASSERT_EQ(windows.first.size(), 3u);
+    EXPECT_EQ(windows.first[0], std::vector<float>({0, 1, 2}));
+    EXPECT_EQ(windows.second[0], 3.0f);
+    EXPECT_EQ(windows.first[1], std::vector<float>({10, 11, 12}));
+    EXPECT_EQ(windows.second[1], 13.0f);
+    EXPECT_EQ(windows.first[2], std::vector<float>({1, 2, 3}));
+    EXPECT_EQ(windows.second[2], 4.0f);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include "simd_kernels.hpp"
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Column counts around the 4- and 8-float vector widths, so every backend
+// runs its main loop, its tail loop and both together
+static const size_t COLS[] = {1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 100};
+static const size_t ROWS[] = {1, 3, 4, 5, 8, 13, 400};
+
+static Matrix random_matrix(size_t rows, size_t cols, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    Matrix m(rows, cols);
+    for (size_t r = 0; r < rows; ++r)
+        for (size_t c = 0; c < cols; ++c)
+            m[r][c] = dist(gen);
+    return m;
+}
+
+static std::vector<float> random_vector(size_t n, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> v(n);
+    for (float& x : v) x = dist(gen);
+    return v;
+}
+
+// SIMD and scalar sums only differ in summation order
+static void expect_close(const std::vector<float>& actual, const std::vector<float>& expected, size_t terms) {
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); ++i) {
+        EXPECT_NEAR(actual[i], expected[i], 1e-6f * (terms + 1)) << "index " << i;
+    }
+}
+
+TEST(SimdKernelsTest, GemvMatchesScalar) {
+    for (size_t rows : ROWS) {
+        for (size_t cols : COLS) {
+            SCOPED_TRACE(testing::Message() << rows << "x" << cols);
+            Matrix w = random_matrix(rows, cols, 1);
+            std::vector<float> x = random_vector(cols, 2);
+            std::vector<float> y = random_vector(rows, 3);
+            std::vector<float> y_ref = y;
+
+            gemv_accumulate(w, x.data(), y.data());
+            gemv_accumulate_scalar(w, x.data(), y_ref.data());
+            expect_close(y, y_ref, cols);
+        }
+    }
+}
+
+TEST(SimdKernelsTest, GemmMatchesScalar) {
+    const size_t batch = 5;
+    for (size_t rows : ROWS) {
+        for (size_t cols : COLS) {
+            SCOPED_TRACE(testing::Message() << rows << "x" << cols);
+            Matrix w = random_matrix(rows, cols, 4);
+            // Strides wider than the rows, the extra values must stay untouched
+            const size_t ldx = cols + 1;
+            const size_t ldy = rows + 2;
+            std::vector<float> x = random_vector(batch * ldx, 5);
+            std::vector<float> y = random_vector(batch * ldy, 6);
+            std::vector<float> y_ref = y;
+
+            gemm_accumulate(w, x.data(), ldx, batch, y.data(), ldy);
+            gemm_accumulate_scalar(w, x.data(), ldx, batch, y_ref.data(), ldy);
+            expect_close(y, y_ref, cols);
+        }
+    }
+}
+
+TEST(SimdKernelsTest, GerMatchesScalar) {
+    for (size_t rows : ROWS) {
+        for (size_t cols : COLS) {
+            SCOPED_TRACE(testing::Message() << rows << "x" << cols);
+            Matrix a = random_matrix(rows, cols, 7);
+            Matrix a_ref = a;
+            std::vector<float> x = random_vector(rows, 8);
+            std::vector<float> y = random_vector(cols, 9);
+
+            ger_accumulate(a, x.data(), y.data());
+            ger_accumulate_scalar(a_ref, x.data(), y.data());
+            for (size_t r = 0; r < rows; ++r)
+                for (size_t c = 0; c < cols; ++c)
+                    EXPECT_NEAR(a[r][c], a_ref[r][c], 1e-6f) << r << "," << c;
+        }
+    }
+}
+
+TEST(SimdKernelsTest, TransposedGemvMatchesScalar) {
+    for (size_t rows : ROWS) {
+        for (size_t cols : COLS) {
+            SCOPED_TRACE(testing::Message() << rows << "x" << cols);
+            Matrix w = random_matrix(rows, cols, 10);
+            std::vector<float> x = random_vector(rows, 11);
+            std::vector<float> y = random_vector(cols, 12);
+            std::vector<float> y_ref = y;
+
+            gemv_transposed_accumulate(w, x.data(), y.data());
+            gemv_transposed_accumulate_scalar(w, x.data(), y_ref.data());
+            expect_close(y, y_ref, rows);
+        }
+    }
+}
+
+TEST(SimdKernelsTest, GroupedGemvMatchesEachMatrix) {
+    const size_t count = 5;
+    const size_t slots[] = {3, 0, 4, 1};
+    for (size_t rows : ROWS) {
+        for (size_t cols : COLS) {
+            SCOPED_TRACE(testing::Message() << rows << "x" << cols);
+            // Matrices packed one after the other, with a gap between them
+            const size_t block = rows * Matrix::padded_stride(cols) + 8;
+            std::vector<Matrix> w;
+            AlignedVector packed(count * block);
+            for (size_t s = 0; s < count; ++s) {
+                w.push_back(random_matrix(rows, cols, 13 + s));
+                for (size_t r = 0; r < rows; ++r) {
+                    std::copy(w[s].row(r), w[s].row(r) + cols, &packed[s * block + r * w[s].stride()]);
+                }
+            }
+            const size_t ldx = cols + 1;
+            const size_t ldy = rows + 3;
+            std::vector<float> x = random_vector(4 * ldx, 14);
+            std::vector<float> y = random_vector(4 * ldy, 15);
+            std::vector<float> y_ref = y;
+            std::vector<float> y_scalar = y;
+
+            gemv_accumulate_grouped(packed.data(), rows, cols, block, slots, 4,
+                                    x.data(), ldx, y.data(), ldy);
+            gemv_accumulate_grouped_scalar(packed.data(), rows, cols, block, slots, 4,
+                                           x.data(), ldx, y_scalar.data(), ldy);
+            for (size_t k = 0; k < 4; ++k) {
+                gemv_accumulate(w[slots[k]], x.data() + k * ldx, y_ref.data() + k * ldy);
+            }
+            // Bit-identical to one gemv per matrix, padding untouched
+            EXPECT_EQ(y, y_ref);
+            expect_close(y, y_scalar, cols);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
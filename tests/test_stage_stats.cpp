@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include "stage_stats.hpp"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+TEST(StageStatsTest, PercentilesWithinBucketResolution) {
+    StageStats::Histogram h;
+    for (uint64_t ns = 1; ns <= 100000; ++ns) {
+        h.record(ns);
+    }
+    EXPECT_EQ(h.count, 100000u);
+    EXPECT_EQ(h.max_ns, 100000u);
+    EXPECT_DOUBLE_EQ(h.mean_ns(), 50000.5);
+    const double ps[] = {1, 50, 90, 99, 100};
+    for (double p : ps) {
+        const double exact = p / 100.0 * 100000;
+        EXPECT_GE(h.percentile_ns(p), exact) << p;
+        EXPECT_LE(h.percentile_ns(p), exact * 1.25) << p;
+    }
+    EXPECT_EQ(h.percentile_ns(100), 100000u);
+}
+
+TEST(StageStatsTest, SmallAndHugeValues) {
+    StageStats::Histogram h;
+    EXPECT_EQ(h.percentile_ns(50), 0u);
+    h.record(0);
+    h.record(3);
+    h.record(7);
+    EXPECT_EQ(h.percentile_ns(0), 0u);
+    EXPECT_EQ(h.percentile_ns(50), 3u);
+    EXPECT_EQ(h.percentile_ns(100), 7u);
+    h.record(1ull << 50);  // past the last bucket edge
+    EXPECT_EQ(h.percentile_ns(100), 1ull << 50);
+}
+
+TEST(StageStatsTest, MergeAddsCountsAndEpochs) {
+    StageStats a, b;
+    a.record(StageStats::Predict, 1000);
+    a.add_epochs(StageStats::PredictorUpdate, 3);
+    a.count_sample(false);
+    b.record(StageStats::Predict, 3000);
+    b.add_epochs(StageStats::PredictorUpdate, 2);
+    b.count_sample(true);
+    a.merge(b);
+    EXPECT_EQ(a.stage(StageStats::Predict).count, 2u);
+    EXPECT_EQ(a.stage(StageStats::Predict).total_ns, 4000u);
+    EXPECT_EQ(a.stage(StageStats::Predict).max_ns, 3000u);
+    EXPECT_EQ(a.epochs(StageStats::PredictorUpdate), 5u);
+    EXPECT_EQ(a.sample_count(), 2u);
+    EXPECT_EQ(a.anomaly_count(), 1u);
+    a.reset();
+    EXPECT_EQ(a.sample_count(), 0u);
+    EXPECT_EQ(a.stage(StageStats::Predict).count, 0u);
+}
+
+TEST(StageStatsTest, LapChargesEachStage) {
+    StageStats stats;
+    StageStats::Lap lap(stats);
+    lap.mark(StageStats::Normalize);
+    lap.skip();
+    lap.mark(StageStats::Logging);
+    EXPECT_EQ(stats.stage(StageStats::Normalize).count, 1u);
+    EXPECT_EQ(stats.stage(StageStats::Logging).count, 1u);
+    EXPECT_EQ(stats.stage(StageStats::Predict).count, 0u);
+}
+
+TEST(StageStatsTest, SummaryLineListsRecordedStages) {
+    StageStats stats;
+    stats.record(StageStats::PredictorUpdate, 2000);
+    stats.add_epochs(StageStats::PredictorUpdate, 4);
+    stats.count_sample(false);
+    std::string line = stats.summary_line();
+    EXPECT_NE(line.find("samples=1"), std::string::npos);
+    EXPECT_NE(line.find("predictor_update n=1"), std::string::npos);
+    EXPECT_NE(line.find("epochs=4.00"), std::string::npos);
+    EXPECT_EQ(line.find("generate"), std::string::npos);
+}
+
+TEST(StageStatsTest, MetricsFileIsReplacedWhole) {
+    const std::string path = "stage_stats_test.prom";
+    StageStats stats;
+    stats.record(StageStats::Generate, 1500);
+    stats.count_sample(true);
+    stats.write_metrics(path);
+    stats.count_sample(false);
+    stats.write_metrics(path);
+
+    std::ifstream in(path);
+    std::stringstream content;
+    content << in.rdbuf();
+    EXPECT_NE(content.str().find("adapad_samples_total 2\n"), std::string::npos);
+    EXPECT_NE(content.str().find("adapad_anomalies_total 1\n"), std::string::npos);
+    EXPECT_NE(content.str().find("adapad_stage_seconds_count{stage=\"generate\"} 1\n"), std::string::npos);
+    EXPECT_FALSE(std::ifstream(path + ".tmp").good());
+    std::remove(path.c_str());
+
+    EXPECT_THROW(stats.write_metrics("no_such_dir/metrics.prom"), std::runtime_error);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include "timestep_engine.hpp"
+#include "lstm_predictor.hpp"
+#include "thread_pool.hpp"
+#include <cmath>
+#include <memory>
+#include <vector>
+
+static const int LOOKBACK = 3;
+static const int HIDDEN = 16;
+static const int LAYERS = 2;
+
+static std::unique_ptr<LSTMPredictor> make_lstm(unsigned seed) {
+    std::unique_ptr<LSTMPredictor> lstm(new LSTMPredictor(1, LOOKBACK, HIDDEN, LAYERS, LOOKBACK));
+    lstm->set_random_seed(seed);
+    return lstm;
+}
+
+class BatchedInferenceTest : public ::testing::Test {
+protected:
+    // Models 0, 2 and 4 are tied to owner, 1 and 3 have their own weights
+    void SetUp() override {
+        owner = make_lstm(1);
+        for (int m = 0; m < 5; ++m) {
+            lstms.push_back(make_lstm(10 + m));
+            if (m % 2 == 0) {
+                lstms.back()->share_backbone(*owner);
+            }
+            models.push_back(lstms.back().get());
+            for (int k = 0; k < LOOKBACK; ++k) {
+                x.push_back(0.5f + 0.3f * std::sin(0.7f * m + 0.1f * k));
+            }
+        }
+    }
+
+    float expected(size_t m) {
+        return models[m]->infer(x.data() + m * LOOKBACK, 1)[0];
+    }
+
+    std::unique_ptr<LSTMPredictor> owner;
+    std::vector<std::unique_ptr<LSTMPredictor>> lstms;
+    std::vector<LSTMPredictor*> models;
+    std::vector<float> x;
+};
+
+TEST_F(BatchedInferenceTest, MatchesEachModel) {
+    ThreadPool pool(2);
+    BatchedInference batched;
+    std::vector<float> out(models.size());
+    std::vector<uint64_t> model_ns(models.size());
+    batched.run(models, x.data(), LOOKBACK, 1, nullptr, out.data(), model_ns.data(), pool);
+
+    // One group for the tied models, the separate ones packed in one chunk per thread
+    EXPECT_EQ(batched.group_count(), 3u);
+    EXPECT_EQ(batched.packed_count(), 2u);
+    for (size_t m = 0; m < models.size(); ++m) {
+        EXPECT_NEAR(out[m], expected(m), 1e-6f) << "model " << m;
+    }
+
+    ThreadPool single(1);
+    batched.run(models, x.data(), LOOKBACK, 1, nullptr, out.data(), model_ns.data(), single);
+    EXPECT_EQ(batched.group_count(), 2u);
+    // Packed models get the same arithmetic as infer()
+    EXPECT_EQ(out[1], expected(1));
+    EXPECT_EQ(out[3], expected(3));
+}
+
+TEST_F(BatchedInferenceTest, TrainingUpdatesPackedWeightsInPlace) {
+    ThreadPool pool(1);
+    BatchedInference batched;
+    std::vector<float> out(models.size());
+    std::vector<uint64_t> model_ns(models.size());
+    batched.run(models, x.data(), LOOKBACK, 1, nullptr, out.data(), model_ns.data(), pool);
+    EXPECT_EQ(batched.packs_built(), 1u);
+
+    typedef std::vector<std::vector<std::vector<float>>> Tensor;
+    const Tensor window(1, std::vector<std::vector<float>>(1, std::vector<float>(x.begin(), x.begin() + LOOKBACK)));
+    for (int step = 0; step < 3; ++step) {
+        models[1]->train_step(window, {0.9f}, 0.05f);
+        batched.run(models, x.data(), LOOKBACK, 1, nullptr, out.data(), model_ns.data(), pool);
+        EXPECT_EQ(out[1], expected(1));
+    }
+    EXPECT_EQ(batched.packs_built(), 1u);
+
+    // New weights move a model out of the buffer, the next run packs it again
+    models[3]->set_lstm_weights(0, std::vector<std::vector<float>>(4 * HIDDEN, std::vector<float>(LOOKBACK, 0.1f)),
+                                std::vector<std::vector<float>>(4 * HIDDEN, std::vector<float>(HIDDEN, 0.01f)));
+    batched.run(models, x.data(), LOOKBACK, 1, nullptr, out.data(), model_ns.data(), pool);
+    EXPECT_EQ(batched.packs_built(), 2u);
+    EXPECT_EQ(out[3], expected(3));
+    EXPECT_EQ(out[1], expected(1));
+}
+
+TEST(BatchedInferenceShapeTest, PackedMatchesInferAtDeployedShape) {
+    // The deployed shape, where infer() runs the compile-time specialized
+    // engine unless built with FIXED_SHAPES=0
+    std::vector<std::unique_ptr<LSTMPredictor>> lstms;
+    std::vector<LSTMPredictor*> models;
+    std::vector<float> x;
+    for (int m = 0; m < 4; ++m) {
+        lstms.emplace_back(new LSTMPredictor(1, 3, 100, 2, 3));
+        lstms.back()->set_random_seed(20 + m);
+        models.push_back(lstms.back().get());
+        for (int k = 0; k < 3; ++k) x.push_back(0.4f + 0.2f * std::cos(0.9f * m + 0.3f * k));
+    }
+    ThreadPool pool(1);
+    BatchedInference batched;
+    std::vector<float> out(models.size());
+    std::vector<uint64_t> model_ns(models.size());
+    batched.run(models, x.data(), 3, 1, nullptr, out.data(), model_ns.data(), pool);
+    EXPECT_EQ(batched.packed_count(), 4u);
+    for (size_t m = 0; m < models.size(); ++m) {
+        EXPECT_EQ(out[m], models[m]->infer(x.data() + 3 * m, 1)[0]) << "model " << m;
+    }
+}
+
+TEST_F(BatchedInferenceTest, SkipsInactiveModels) {
+    ThreadPool pool(2);
+    BatchedInference batched;
+    std::vector<char> active = {1, 0, 0, 1, 1};
+    std::vector<float> out(models.size(), -1.0f);
+    std::vector<uint64_t> model_ns(models.size());
+    batched.run(models, x.data(), LOOKBACK, 1, &active, out.data(), model_ns.data(), pool);
+
+    EXPECT_EQ(batched.group_count(), 2u);
+    for (size_t m = 0; m < models.size(); ++m) {
+        if (active[m]) {
+            EXPECT_NEAR(out[m], expected(m), 1e-6f) << "model " << m;
+        } else {
+            EXPECT_EQ(out[m], -1.0f) << "model " << m;
+        }
+    }
+
+    // Groups are rebuilt on every run
+    batched.run(models, x.data(), LOOKBACK, 1, nullptr, out.data(), model_ns.data(), pool);
+    EXPECT_EQ(batched.group_count(), 3u);
+    EXPECT_NEAR(out[2], expected(2), 1e-6f);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}